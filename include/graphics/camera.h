@@ -7,6 +7,13 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 
+// how depth is laid out; picked by GraphicsEngine from what the driver supports
+enum class DepthMode {
+    Standard,     // [-1, 1] clip depth, fixed-point buffer
+    ReversedZ,    // [0, 1] clip depth, near at 1, float buffer
+    Logarithmic   // standard projection, log2(w) written in the fragment shader
+};
+
 class Camera {
 public:
     int width, height;
@@ -17,9 +24,11 @@ public:
 
     GLFWwindow* window;
     glm::vec3 position;
+    glm::dvec3 realPosition = glm::dvec3(0.0); // m, floating origin of render space
     glm::mat4 model;
     glm::mat4 view;
     glm::mat4 projection; 
+    DepthMode depthMode = DepthMode::Standard;
 
     Camera(GLFWwindow* window, glm::vec3 position, float orbitSpeed, float panSpeed, float zoomSpeed);
     ~Camera();
@@ -27,6 +36,9 @@ public:
     virtual void update();
     void cleanup();
 
+    // infinite perspective matching depthMode
+    glm::mat4 makePerspective(float fovy, float aspect, float near) const;
+
     virtual void handleMouseMove(GLFWwindow* win, double x, double y);
     virtual void handleMouseButton(GLFWwindow* win, int button, int action, int mods);
     virtual void handleMouseScroll(GLFWwindow* win, double xoffset, double yoffset);
@@ -0,0 +1,65 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "opengl_includes.h"
+#include "graphics/render_target.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+enum class CaptureFormat {
+    PNG,
+    Raw   // tightly packed RGBA8, bottom-up rows flipped to top-down
+};
+
+// Reads rendered frames back through a ring of pixel buffer objects so
+// glReadPixels never stalls, and encodes them on a worker thread as
+// frame_000000.png (or .rgba) in the output directory.
+class FrameCapture {
+public:
+    static constexpr int PBO_COUNT = 3;
+    static constexpr size_t MAX_QUEUED_FRAMES = 8;
+
+    FrameCapture(std::string outputDir, CaptureFormat format);
+    ~FrameCapture();
+
+    // issues an async read of target and hands the oldest finished read to the encoder
+    void capture(const RenderTarget& target);
+    // collects outstanding reads and waits for the encoder to drain
+    void flush();
+    void cleanup();
+
+private:
+    struct Frame {
+        int index;
+        int width, height;
+        std::vector<uint8_t> pixels;
+    };
+
+    std::string outputDir;
+    CaptureFormat format;
+
+    GLuint pbos[PBO_COUNT] = {};
+    size_t pboBytes[PBO_COUNT] = {};
+    int pboWidth[PBO_COUNT] = {}, pboHeight[PBO_COUNT] = {};
+    int pboFrame[PBO_COUNT] = { -1, -1, -1 };
+    int nextPBO = 0;
+    int frameCounter = 0;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queueCV;
+    std::deque<Frame> queue;
+    bool stopping = false;
+    bool busy = false;
+
+    void collect(int pbo);
+    void workerLoop();
+    void writeFrame(const Frame& frame) const;
+};
+
+#endif // FRAME_CAPTURE_H
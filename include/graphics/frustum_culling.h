@@ -0,0 +1,34 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// six normalized planes (a, b, c, d) pointing into the frustum
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Gribb-Hartmann extraction from a combined projection * view matrix
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+};
+
+// Culls bounding spheres against a frustum in SIMD batches of four.
+// Bounds are kept in contiguous SoA arrays that are refilled every frame.
+class FrustumCuller {
+private:
+    std::vector<float> xs, ys, zs, radii;
+    std::vector<uint8_t> visible;
+
+public:
+    void clear();
+    size_t addSphere(const glm::vec3& center, float radius);
+
+    // tests every added sphere, returns the number culled
+    size_t cull(const Frustum& frustum);
+    bool isVisible(size_t index) const;
+    size_t size() const;
+};
+
+#endif // FRUSTUM_CULLING_H
@@ -5,31 +5,102 @@
 #include "graphics/shader.h"
 #include "graphics/camera.h"
 #include "graphics/renderable.h" 
+#include "graphics/sphere_lod.h"
+#include "graphics/mesh_registry.h"
+#include "graphics/texture_streamer.h"
+#include "graphics/virtual_texture.h"
+#include "graphics/star_field.h"
+#include "graphics/frustum_culling.h"
+#include "graphics/instance_buffer.h"
+#include "graphics/render_target.h"
+#include "graphics/orbit_trails.h"
+#include "graphics/frame_capture.h"
+#include "graphics/render_queue.h"
+#include "thread_pool.h"
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <vector>
+
+// per-frame counters shown in the GUI
+struct RenderStats {
+    int drawn = 0;
+    int culled = 0;
+    int binds = 0;   // program + VAO changes after sorting
+};
 
 class GraphicsEngine {
 private:
-    std::unordered_map<int, Renderable*> renderables;
+    std::vector<Renderable*> renderables;          // flat for parallel prepare
+    std::vector<int> renderableIDs;                // parallel to renderables
+    std::unordered_map<int, size_t> renderableIndex;
     std::unordered_map<std::string, std::unique_ptr<Shader>> shaders;
+    std::unique_ptr<SphereLODCache> sphereLODCache;
+    std::unique_ptr<MeshRegistry> meshRegistry;
+    std::unique_ptr<TextureStreamer> textureStreamer;
+    std::unique_ptr<VirtualTextureSystem> virtualTextures;
+    InstanceBuffer instances;
+    std::unique_ptr<OrbitTrails> orbitTrails;
+    std::unique_ptr<StarField> starField;
+
+    DepthMode depthMode = DepthMode::Standard;
+    RenderTarget sceneTarget; // float depth target for reversed-Z and headless output
+    std::unique_ptr<FrameCapture> frameCapture;
+    int viewportWidth = 0, viewportHeight = 0;
+    glm::dvec3 sunPosition = glm::dvec3(0.0); // m, light position for basic.frag
+
+    // per-chunk command list written by one worker during prepare
+    struct PrepareChunk {
+        FrustumCuller culler;
+        RenderQueue queue;
+        int culled = 0;
+    };
+    std::unique_ptr<ThreadPool> workers;
+    std::vector<PrepareChunk> prepareChunks;
+    size_t preparedChunkCount = 0;
+    RenderQueue renderQueue;
+    RenderStats stats;
+
+    void setupDepth();
+    bool usesSceneTarget() const;
+    // worker threads: cull, LOD select and build sort keys, no GL calls
+    void prepareScene(const Camera& cam);
+    // GL thread: merge command lists, sort and replay
+    void submitScene(const Camera& cam);
 
 public:
     GLFWwindow* window;
     std::string title;
+    bool headless;
 
-    GraphicsEngine(std::string title, int initialWidth, int initialHeight);
+    // headless: no display, offscreen context via EGL or OSMesa, frames stay in sceneTarget
+    GraphicsEngine(std::string title, int initialWidth, int initialHeight, bool headless = false);
     ~GraphicsEngine();
 
     void addRenderable(int id, Renderable* r);
     void removeRenderable(int id);
     void clear();
 
+    void setSunPosition(const glm::dvec3& realPosition);
     void renderScene(const Camera& cam); 
     void finishRender();
     void cleanup();
 
+    // write every finished frame to outputDir, read back asynchronously
+    void startCapture(const std::string& outputDir, CaptureFormat format);
+    void stopCapture();
+
     Shader* getShader(const std::string& name); 
+    SphereLODCache* getSphereLODCache();
+    MeshRegistry* getMeshRegistry();
+    TextureStreamer* getTextureStreamer();
+    VirtualTextureSystem* getVirtualTextures();
+    InstanceBuffer& getInstanceBuffer();
+    OrbitTrails* getOrbitTrails();
+    StarField* getStarField();
+    DepthMode getDepthMode() const;
+    int getViewportHeight() const;
+    const RenderStats& getStats() const;
     void handleError(int error, const char* description);
 };
 
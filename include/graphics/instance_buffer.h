@@ -0,0 +1,38 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+// Per-renderable camera-relative offsets (render units), one float3 slot per
+// renderable. Written in a batched pass each frame, uploaded once, then read
+// as instanced vertex attribute 3 by the draw calls.
+class InstanceBuffer {
+public:
+    static constexpr GLuint OFFSET_ATTRIB = 3;
+
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    int allocate();
+    void release(int slot);
+
+    glm::vec3* data();
+    const glm::vec3& get(int slot) const;
+    size_t size() const;
+
+    void upload();
+    // points OFFSET_ATTRIB of the currently bound VAO at the given slot
+    void bindAttribute(int slot) const;
+    void cleanup();
+
+private:
+    GLuint VBO = 0;
+    size_t gpuCapacity = 0;
+    std::vector<glm::vec3> offsets;
+    std::vector<int> freeSlots;
+};
+
+#endif // INSTANCE_BUFFER_H
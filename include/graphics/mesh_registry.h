@@ -0,0 +1,49 @@
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include "opengl_includes.h"
+#include "graphics/vertex_format.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+// fills CPU geometry; only called when the key is not resident yet
+using MeshBuilder = std::function<void(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)>;
+
+// GPU meshes shared by key and reference counted. CPU geometry only lives
+// for the duration of the upload, so each object keeps just a handle.
+class MeshRegistry {
+public:
+    static constexpr int INVALID_HANDLE = -1;
+
+    MeshRegistry();
+    ~MeshRegistry();
+
+    // handle for key in format, building and uploading it on first use; adds a reference
+    int acquire(const std::string& key, const MeshBuilder& build, VertexFormat format = VertexFormat::Compact);
+    // drops a reference, freeing the GL buffers with the last one
+    void release(int handle);
+
+    GLuint getVAO(int handle) const;
+    GLsizei getIndexCount(int handle) const;
+    size_t size() const;      // resident meshes
+    void cleanup();
+
+private:
+    struct Entry {
+        std::string key;  // includes the vertex format
+        GLuint VAO = 0, VBO = 0, EBO = 0;
+        GLsizei indexCount = 0;
+        int refCount = 0;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> freeHandles;
+    std::unordered_map<std::string, int> handleByKey;
+
+    bool valid(int handle) const;
+};
+
+#endif // MESH_REGISTRY_H
@@ -0,0 +1,81 @@
+#ifndef ORBIT_TRAILS_H
+#define ORBIT_TRAILS_H
+
+#include "opengl_includes.h"
+#include "graphics/shader.h"
+#include "graphics/camera.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+// Orbit trails for every body, streamed through one GPU buffer.
+//
+// Each body owns a fixed segment of 2 * samplesPerBody vertices. Every sample
+// is written twice (at i and i + samplesPerBody) so the newest samples always
+// form one contiguous range, and all trails draw with a single glMultiDrawArrays.
+// With buffer storage the segment buffer is persistently mapped and guarded by
+// per-frame fences; otherwise samples go through glBufferSubData.
+//
+// Samples are floats relative to a per-trail anchor held in doubles. Each
+// frame the anchors are made camera-relative on the CPU and read per vertex
+// from a buffer texture, so no large world coordinates reach the GPU. A trail
+// is rebased onto its newest sample once that strays REBASE_DISTANCE away.
+class OrbitTrails {
+public:
+    static constexpr int FRAMES_IN_FLIGHT = 3;
+    static constexpr double REBASE_DISTANCE = 1000.0; // render units, float steps ~60 m out here
+
+    bool decimate = true;           // skip samples on low-curvature stretches
+    float minTurnAngle = 0.005f;    // rad, turn needed before a sample is kept
+    int maxSkipped = 64;            // samples skipped in a row before one is forced
+
+    OrbitTrails(uint32_t samplesPerBody = 2048);
+    ~OrbitTrails();
+
+    void addTrail(int id);
+    void removeTrail(int id);
+    void clear();
+
+    // position in m (world space, not camera-relative)
+    void push(int id, const glm::dvec3& realPos);
+    void draw(const Camera& cam, const Shader& shader);
+    void cleanup();
+
+private:
+    struct Trail {
+        int slot = 0;
+        uint32_t head = 0;     // next write index in [0, samplesPerBody)
+        uint32_t count = 0;
+        glm::dvec3 anchor;              // m, what the stored samples are relative to
+        glm::dvec3 last, prev;          // m, last two kept samples
+        int skipped = 0;
+        std::vector<glm::dvec3> samples; // m, mirrors the ring for rebasing
+    };
+
+    uint32_t samplesPerBody;
+    int slotCapacity = 0;
+    bool persistent = false;
+
+    GLuint VAO = 0, VBO = 0;
+    GLuint anchorBuffer = 0, anchorTexture = 0;
+    std::vector<glm::vec4> anchors; // per slot, camera-relative render units
+    glm::vec3* mapped = nullptr;
+    std::array<GLsync, FRAMES_IN_FLIGHT> fences = {};
+    int frameIndex = 0;
+    bool frameWaited = false;
+
+    std::unordered_map<int, Trail> trails;
+    std::vector<int> freeSlots;
+    std::vector<GLint> drawFirsts;
+    std::vector<GLsizei> drawCounts;
+
+    void allocate(int slots);
+    void waitForFrame();
+    void waitForAllFrames();
+    void write(const Trail& trail, const glm::dvec3& p);
+    void rebase(Trail& trail, const glm::dvec3& anchor);
+};
+
+#endif // ORBIT_TRAILS_H
@@ -0,0 +1,69 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "opengl_includes.h"
+#include "graphics/instance_buffer.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+enum class RenderPass : uint8_t {
+    Opaque = 0,
+    Transparent = 1
+};
+
+// everything needed to replay one indexed draw
+struct DrawPacket {
+    uint64_t key;
+    GLuint program;
+    GLuint VAO;
+    GLsizei indexCount;
+    int instanceSlot;
+    const glm::mat4* model;
+    glm::vec3 color;
+    GLuint texture;      // 0 draws flat color
+    GLuint pageTable;    // virtual texture page table, takes precedence over texture
+    float sunVisibility; // lit share of the solar disc, from the shadow tracer
+    bool emissive;       // self-lit, skips shading
+};
+
+// Per-frame list of draw packets, radix-sorted on a 64-bit key and replayed
+// with redundant program/VAO/uniform changes skipped.
+//
+// key layout, high to low bits:
+//   pass 4 | shader 12 | material 16 | mesh 16 | depth 16
+class RenderQueue {
+public:
+    static uint64_t makeKey(RenderPass pass, GLuint program, uint32_t material, GLuint mesh, float viewDepth);
+    // 5-6-5 quantized color, used as the material id
+    static uint32_t colorMaterial(const glm::vec3& color);
+    // textured draws group by texture name instead
+    static uint32_t textureMaterial(GLuint texture);
+
+    void clear();
+    void submit(const DrawPacket& packet);
+    // move in packets built by another (per-thread) queue
+    void append(const RenderQueue& other);
+    void sort();
+    // returns the number of program and VAO binds issued
+    int execute(const glm::mat4& view, const glm::mat4& projection, const InstanceBuffer& instances);
+    size_t size() const;
+    // unsorted; for extra passes over the same draws
+    const std::vector<DrawPacket>& getPackets() const;
+
+private:
+    struct ProgramUniforms {
+        GLuint program;
+        GLint model, view, projection, color, useTexture, useVirtualTexture, sunVisibility, emissive;
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<uint64_t> keys, keysScratch;
+    std::vector<uint32_t> order, orderScratch;
+    std::vector<ProgramUniforms> uniformCache;
+
+    const ProgramUniforms& uniformsFor(GLuint program);
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,23 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include "opengl_includes.h"
+
+// Offscreen framebuffer with an RGBA8 color and a 32-bit float depth attachment.
+// Storage is reallocated only when the requested size changes.
+class RenderTarget {
+public:
+    GLuint FBO = 0, colorRBO = 0, depthRBO = 0;
+    int width = 0, height = 0;
+
+    RenderTarget();
+    ~RenderTarget();
+
+    void resize(int width, int height);
+    void bind() const;
+    // copies color into the default framebuffer and rebinds it
+    void blitToDefault() const;
+    void cleanup();
+};
+
+#endif // RENDER_TARGET_H
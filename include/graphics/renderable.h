@@ -3,40 +3,57 @@
 
 #include "glm/ext/vector_float3.hpp"
 #include "opengl_includes.h"
+#include "graphics/vertex_format.h"
+#include "graphics/mesh_registry.h"
+#include <string>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include <memory>
 #include <cstdint>
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec2 uv;   
-};
-
 class GraphicsEngine;
+class RenderQueue;
 
 class Renderable {
 protected:
     std::weak_ptr<GraphicsEngine> gEng;
-    GLuint VAO, VBO, EBO;
-    glm::mat4 model;
+    int mesh;                // MeshRegistry handle, shared between identical meshes
+    GLuint VAO;              // cached from the registry
+    glm::mat4 model;         // local rotation/scale; translation comes from the instance buffer
+    int instanceSlot;
     GLsizei indexCount;
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    int texture;             // TextureStreamer handle, flat color until resident
+    int virtualTexture;      // VirtualTextureSystem handle, preferred over texture
+    float sunVisibility;     // lit share of the solar disc
+    bool emissive;           // light sources draw unshaded
+    
+    // GL name to draw with this frame, 0 while still streaming
+    GLuint residentTexture() const;
+    GLuint residentPageTable() const;
     
-    void setupMesh(const std::vector<Vertex>& vertices,
-                   const std::vector<uint32_t>& indices);
+    void setupMesh(const std::string& key, const MeshBuilder& build,
+                   VertexFormat format = VertexFormat::Compact);
 
 public:
     Renderable(std::weak_ptr<GraphicsEngine> gEng);
     virtual ~Renderable();
 
-    virtual void draw(const glm::mat4& view, const glm::mat4& projection);
+    // push this frame's draw packets; nothing is drawn until the queue executes
+    virtual void submit(RenderQueue& queue, const glm::mat4& view, const glm::mat4& projection);
+    // model-space bounding sphere radius about the origin, used for culling
+    virtual float getBoundingRadius() const;
 
     void setModel(const glm::mat4& model);
     glm::mat4& getModel();
+    void setTexture(const std::string& path);
+    // directory of tiles written by VirtualTextureSystem::bake
+    void setVirtualTexture(const std::string& dir);
+    // sunlight from the shadow tracer, applied in basic.frag
+    void setSunVisibility(float visibility);
+    void setEmissive(bool emissive);
+    void setInstanceSlot(int slot);
+    int getInstanceSlot() const;
 };
 
 class Cube : public Renderable {
@@ -46,19 +63,21 @@ private:
 public:
     Cube(std::weak_ptr<GraphicsEngine> gEng, glm::vec3 color);
 
-    void draw(const glm::mat4& view, const glm::mat4& projection) override;
+    void submit(RenderQueue& queue, const glm::mat4& view, const glm::mat4& projection) override;
+    float getBoundingRadius() const override;
 };
 
+// tessellation is picked per draw from the shared SphereLODCache
 class Sphere : public Renderable {
 private:
     float radius;
     glm::vec3 color;
 
 public:
-    Sphere(std::weak_ptr<GraphicsEngine> gEng, glm::vec3 color, double realRadius, 
-           int sectorCount = 36, int stackCount = 18);
+    Sphere(std::weak_ptr<GraphicsEngine> gEng, glm::vec3 color, double realRadius);
     
-    void draw(const glm::mat4& view, const glm::mat4& projection) override;
+    void submit(RenderQueue& queue, const glm::mat4& view, const glm::mat4& projection) override;
+    float getBoundingRadius() const override;
 };
 
 #endif // RENDERABLE_H
@@ -6,12 +6,14 @@
 #include "opengl_includes.h"
 #include <glm/glm.hpp>
 #include <string>
+#include <cstdint>
 
 class Shader {
 public:
     unsigned int ID;
    
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // defines ("#define NAME\n" lines) go in after the #version line of both stages
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
     Shader();
     ~Shader();
    
@@ -30,6 +32,11 @@ public:
 
 private:
     void checkCompileErrors(GLuint shader, std::string type);
+
+    // linked program binaries cached on disk, keyed on sources + driver string
+    static uint64_t hashSource(const std::string& text);
+    bool loadCachedBinary(const std::string& name, uint64_t key);
+    void storeCachedBinary(const std::string& name, uint64_t key);
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef SPHERE_LOD_H
+#define SPHERE_LOD_H
+
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <array>
+
+// GPU buffers of one shared unit-sphere tessellation
+struct SphereMesh {
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLsizei indexCount = 0;
+};
+
+// Unit UV-sphere tessellations shared by every Sphere, one per LOD level.
+// Levels are built lazily on first use and picked per draw from the
+// screen-space silhouette error of the body's projected radius.
+class SphereLODCache {
+public:
+    static constexpr int LEVEL_COUNT = 6;
+    static constexpr int SECTOR_COUNTS[LEVEL_COUNT] = { 8, 16, 32, 64, 128, 256 };
+
+    float maxPixelError = 0.5f; // allowed silhouette deviation, px
+
+    SphereLODCache();
+    ~SphereLODCache();
+
+    // coarsest level whose silhouette error stays under maxPixelError
+    int selectLevel(float radius, const glm::vec3& eyeCenter, const glm::mat4& projection, int viewportHeight) const;
+    const SphereMesh& getMesh(int level);
+    // builds every level up front so getMesh never touches GL off the context thread
+    void buildAll();
+    void cleanup();
+
+private:
+    std::array<SphereMesh, LEVEL_COUNT> meshes;
+
+    void build(int level);
+};
+
+#endif // SPHERE_LOD_H
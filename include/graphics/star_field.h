@@ -0,0 +1,42 @@
+#ifndef STAR_FIELD_H
+#define STAR_FIELD_H
+
+#include "opengl_includes.h"
+#include "graphics/camera.h"
+#include "graphics/shader.h"
+#include <string>
+#include <cstdint>
+
+// one catalog entry as stored on disk and in the vertex buffer
+struct StarRecord {
+    int16_t dir[3];       // snorm16 unit vector, ecliptic frame
+    int16_t magnitude;    // apparent visual magnitude, thousandths
+    uint8_t color[4];     // RGBA8 from the B-V color index
+};
+
+// Background stars at infinity. The binary catalog is memory-mapped and
+// handed straight to a static vertex buffer at load, then drawn as points
+// sized by magnitude in a single draw call; per frame only the camera
+// uniforms change.
+class StarField {
+public:
+    float limitingMagnitude = 6.5f;   // fainter stars are skipped
+    float pointScale = 4.0f;          // px diameter of a magnitude 0 star
+
+    StarField();
+    ~StarField();
+
+    // offline: CSV with ra (hours), dec (deg), mag and ci columns (HYG layout) to binary
+    static bool convertCatalog(const std::string& csvPath, const std::string& outPath);
+
+    bool load(const std::string& path);
+    void draw(const Camera& cam, const Shader& shader) const;
+    uint32_t size() const;
+    void cleanup();
+
+private:
+    GLuint VAO = 0, VBO = 0;
+    uint32_t count = 0;
+};
+
+#endif // STAR_FIELD_H
@@ -0,0 +1,108 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "opengl_includes.h"
+#include "thread_pool.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+// Loads textures without stalling the render loop. Images are decoded,
+// mipmapped and (when S3TC is available) BC1-compressed on a dedicated
+// decode pool, and the result is cached on disk so later runs skip straight
+// to upload. Uploads go through an orphaned PBO under a per-frame byte
+// budget, smallest mip first, so a texture becomes usable at low resolution
+// and sharpens as the larger levels arrive.
+class TextureStreamer {
+public:
+    static constexpr int INVALID_HANDLE = -1;
+
+    size_t uploadBudget = 16u << 20; // bytes handed to GL per update()
+
+    explicit TextureStreamer(unsigned decodeThreads = 2);
+    ~TextureStreamer();
+
+    // handle for path, queueing a load on first use; adds a reference
+    int acquire(const std::string& path);
+    void release(int handle);
+    // GL name once at least one mip level is resident, 0 until then
+    GLuint getTexture(int handle) const;
+    bool isComplete(int handle) const;
+
+    // GL thread, once per frame: spends up to uploadBudget on pending levels
+    void update();
+    void cleanup();
+
+private:
+    enum class Format : uint32_t {
+        RGBA8 = 0,
+        BC1 = 1
+    };
+
+    struct Level {
+        int width, height;
+        std::vector<uint8_t> data;
+    };
+
+    struct Image {
+        Format format;
+        std::vector<Level> levels; // 0 is full resolution
+    };
+
+    struct Entry {
+        std::string path;
+        GLuint texture = 0;
+        int refCount = 0;
+        int residentLevel = -1;   // smallest level index uploaded so far (GL base level)
+        bool complete = false;
+        bool failed = false;
+        uint64_t generation = 0;  // distinguishes reuses of a handle from stale decodes
+    };
+
+    // decoded image waiting for, or part way through, upload
+    struct Upload {
+        int handle;
+        uint64_t generation;
+        std::unique_ptr<Image> image; // null if decoding failed
+        int level = 0;                // counts down to 0
+        int row = 0;                  // next texel row of level (multiple of 4 for BC1)
+        bool allocated = false;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> freeHandles;
+    std::unordered_map<std::string, int> handleByPath;
+
+    uint64_t nextGeneration = 0;
+    bool compress;
+    GLuint pbo = 0;
+    std::deque<Upload> uploads;   // GL thread only
+
+    // written by decode tasks, drained by update()
+    std::mutex mutex;
+    std::condition_variable idleCV;
+    std::deque<Upload> decoded;
+    std::unique_ptr<ThreadPool> decodePool;
+    int pendingDecodes = 0;
+    bool stopping = false;
+
+    bool valid(int handle) const;
+    void decode(int handle, uint64_t generation, const std::string& path);
+    std::unique_ptr<Image> loadImage(const std::string& path) const;
+    // sends one band of the front upload, at least one row; returns bytes sent
+    size_t uploadBand(size_t budget);
+
+    static std::string cachePath(const std::string& path, Format format);
+    static bool readCache(const std::string& file, Format format, Image& image);
+    static void writeCache(const std::string& file, const Image& image);
+    static void buildMips(Image& image);
+    void compressBC1(Image& image) const;
+};
+
+#endif // TEXTURE_STREAMER_H
@@ -0,0 +1,42 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// authoring layout; every mesh is built in this form on the CPU
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;   
+};
+
+// GPU-side vertex layouts; meshes are authored as Vertex and packed on upload
+enum class VertexFormat {
+    Full,              // 32 B: float3 pos, float3 normal, float2 uv
+    Compact,           // 20 B: float3 pos, 2_10_10_10 normal, half2 uv
+    CompactQuantized   // 16 B: snorm16x4 pos, 2_10_10_10 normal, half2 uv; pos must lie in [-1, 1]
+};
+
+struct VertexAttribDesc {
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+struct VertexFormatDesc {
+    size_t stride;
+    VertexAttribDesc pos, normal, uv;
+};
+
+const VertexFormatDesc& describeVertexFormat(VertexFormat format);
+// interleaved bytes ready for glBufferData
+std::vector<uint8_t> packVertices(const std::vector<Vertex>& vertices, VertexFormat format);
+// attribute pointers 0-2 for the VAO and ARRAY_BUFFER currently bound
+void applyVertexFormat(VertexFormat format);
+
+#endif // VERTEX_FORMAT_H
@@ -0,0 +1,138 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include "opengl_includes.h"
+#include "graphics/shader.h"
+#include "graphics/render_queue.h"
+#include "graphics/instance_buffer.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// Virtual-textured planet surfaces. Each body's equirectangular map is a
+// quadtree of bordered tiles on disk (<dir>/<level>/<x>_<y>.rgba, level 0
+// finest, the top level 2x1 tiles), written once by bake(). A low-resolution
+// feedback pass reports which tiles and mips are on screen; those are loaded
+// on worker threads into one physical atlas shared by every body and evicted
+// least-recently-used, so residency is bounded by the atlas whatever the
+// number of textured bodies. Per-body page tables map each virtual tile to
+// its atlas slot, or to its nearest resident ancestor while it streams in.
+class VirtualTextureSystem {
+public:
+    static constexpr int INVALID_HANDLE = -1;
+    static constexpr int TILE_SIZE = 128;       // payload texels per side
+    static constexpr int TILE_BORDER = 1;       // apron for bilinear filtering
+    static constexpr int TILE_STRIDE = TILE_SIZE + 2 * TILE_BORDER;
+    static constexpr int FEEDBACK_DIVISOR = 8;  // feedback resolution relative to the viewport
+
+    int uploadsPerFrame = 16;   // tiles copied into the atlas per update()
+    int maxPendingLoads = 64;   // tile reads in flight
+
+    explicit VirtualTextureSystem(int atlasSlotsPerSide = 32, unsigned loaderThreads = 2);
+    ~VirtualTextureSystem();
+
+    // offline: splits an equirectangular image into a tile pyramid under dir
+    static bool bake(const std::string& imagePath, const std::string& dir);
+
+    // handle for a baked tile directory; adds a reference
+    int acquire(const std::string& dir);
+    void release(int handle);
+    // page table GL name once the top level is resident, 0 until then
+    GLuint getPageTable(int handle) const;
+
+    // sampler units and atlas constants for shaders that read virtual textures
+    void configureShader(const Shader& shader) const;
+    // GL thread, once per frame: read back feedback, upload loaded tiles, refresh page tables
+    void update();
+    // draws the packets that carry a page table into the feedback target
+    void renderFeedback(const RenderQueue& queue, const Shader& feedbackShader, const glm::mat4& view,
+                        const glm::mat4& projection, const InstanceBuffer& instances, int viewportWidth, int viewportHeight);
+    size_t residentTiles() const;
+    void cleanup();
+
+private:
+    static constexpr int FEEDBACK_BUFFERS = 2;
+
+    struct VirtualTexture {
+        std::string dir;
+        int refCount = 0;
+        uint64_t generation = 0;
+        int levelCount = 0;              // level levelCount - 1 is 2x1 tiles
+        int tilesX = 0, tilesY = 0;      // at level 0
+        GLuint pageTable = 0;
+        std::vector<std::vector<uint32_t>> entries; // per level: slot x, slot y, mapped level, valid
+        std::vector<bool> dirty;
+    };
+
+    struct Slot {
+        uint64_t key = 0;
+        bool used = false;
+        bool pinned = false;             // top level tiles are never evicted
+        uint64_t lastUsed = 0;
+        std::list<int>::iterator lru;
+    };
+
+    struct LoadedTile {
+        uint64_t key;
+        uint64_t generation;
+        std::vector<uint8_t> texels;     // empty if the tile file is missing
+    };
+
+    std::vector<VirtualTexture> textures;
+    std::vector<int> freeHandles;
+    std::unordered_map<std::string, int> handleByDir;
+    uint64_t nextGeneration = 0;
+
+    // physical cache
+    int atlasSlots;
+    GLuint atlas = 0;
+    std::vector<Slot> slots;
+    std::vector<int> freeSlots;
+    std::list<int> lru;                  // front = most recently used
+    std::unordered_map<uint64_t, int> slotByKey;
+    std::unordered_set<uint64_t> pending, missing;
+    std::deque<LoadedTile> ready;        // loaded, waiting for an atlas upload
+    uint64_t frame = 0;
+
+    // feedback target and async readback ring
+    GLuint feedbackFBO = 0, feedbackColor = 0, feedbackDepth = 0;
+    int feedbackWidth = 0, feedbackHeight = 0;
+    GLuint feedbackPBOs[FEEDBACK_BUFFERS] = {};
+    GLsync feedbackFences[FEEDBACK_BUFFERS] = {};
+    int feedbackSize[FEEDBACK_BUFFERS][2] = {};
+    int nextFeedback = 0;
+
+    // loader threads push here
+    std::mutex mutex;
+    std::deque<LoadedTile> loaded;
+    std::unique_ptr<ThreadPool> loaderPool;
+
+    static uint64_t tileKey(int handle, int level, int x, int y);
+    static void unpackKey(uint64_t key, int& handle, int& level, int& x, int& y);
+    bool valid(int handle) const;
+    bool readInfo(VirtualTexture& vt) const;
+    void createPageTable(VirtualTexture& vt);
+
+    void request(uint64_t key);
+    void touch(int slot);
+    void readFeedback();
+    int allocateSlot();
+    void evict(int slot);
+    // false when every slot holds a tile seen this frame
+    bool insert(const LoadedTile& tile);
+    // writes entry over the tile's subtree: on insert where nothing finer is
+    // mapped, on evict where the evicted tile was mapped
+    void mapTile(VirtualTexture& vt, int level, int x, int y, uint32_t entry, bool inserting);
+    void requestTopLevel(int handle);
+    void resizeFeedback(int width, int height);
+};
+
+#endif // VIRTUAL_TEXTURE_H
@@ -1,4 +1,6 @@
 #include "opengl_includes.h"
+#include "graphics/graphics_engine.h"
+#include "physics/drift_monitor.h"
 
 class GUI {
 public:
@@ -10,7 +12,7 @@ public:
     ~GUI();
 
     void newFrame();
-    void drawElements();
+    void drawElements(const RenderStats& renderStats, DriftMonitor& drift);
     void render();
     void cleanup();
 };
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file; pages are faulted in on demand
+// instead of being read up front.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+    const uint8_t* ptr = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+#endif // MAPPED_FILE_H
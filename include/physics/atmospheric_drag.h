@@ -0,0 +1,70 @@
+#ifndef ATMOSPHERIC_DRAG_H
+#define ATMOSPHERIC_DRAG_H
+
+#include "physics/force_model.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Drag from the atmospheres of selected bodies on bodies registered with
+// setBody. Density models, exponential or tabulated, are resampled once
+// into a uniform table of log density and per-cell slopes, so a lookup is
+// one index, one multiply-add and an exp. The air turns with its body.
+// Participants below the top of an atmosphere are packed into SoA arrays
+// each step and evaluated two at a time in SIMD lanes. They are treated as
+// test particles; the body feels no reaction.
+class AtmosphericDrag : public ForceModel {
+public:
+    static constexpr double TABLE_STEP = 1000.0;      // m between log-density samples
+    static constexpr double DRAG_COEFFICIENT = 2.2;   // Cd of a typical satellite
+
+    const char* name() const override;
+    void evaluate(BodyBatch& batch, ThreadPool& workers) override;
+
+    // rho0 exp(-h / scaleHeight) (kg/m^3) up to maxAltitude (m) above radius
+    void setExponential(int centralID, double radius, double rho0, double scaleHeight, double maxAltitude);
+    // densities (kg/m^3) at increasing altitudes (m), exponential between
+    // samples and zero above the last
+    bool setTable(int centralID, double radius, const std::vector<double>& altitudes, const std::vector<double>& densities);
+    // the air co-rotates about spinAxis (simulation frame) at rate rad/s
+    void setRotation(int centralID, const glm::dvec3& spinAxis, double rate);
+    void removeAtmosphere(int centralID);
+
+    // ballistic coefficient m / (Cd A) in kg/m^2; lower drags harder
+    void setBody(int id, double ballisticCoefficient);
+    void removeBody(int id);
+    size_t bodyCount() const;
+    static double ballisticCoefficient(double mass, double area, double dragCoefficient = DRAG_COEFFICIENT);
+
+    // density (kg/m^3) at altitude above centralID from the resampled table
+    double density(int centralID, double altitude) const;
+
+private:
+    struct Atmosphere {
+        double radius = 0.0;               // m, altitude zero
+        double top = 0.0;                  // m of altitude, no air above
+        glm::dvec3 omega = glm::dvec3(0.0); // rad/s, spin vector
+        // log density at i TABLE_STEP and the change to the next sample
+        std::vector<double> logRho, slope;
+    };
+
+    std::unordered_map<int, Atmosphere> atmospheres;
+    std::unordered_map<int, double> ballistic;
+
+    // per-atmosphere scratch: body-centered states padded to a SIMD pair
+    size_t count = 0;
+    std::vector<int> batchIndex;
+    std::vector<double> px, py, pz, pvx, pvy, pvz;
+    std::vector<double> invBallistic;   // Cd A / m, 0 in the pad lane
+    std::vector<double> outX, outY, outZ;
+
+    // fills the table from log density at any altitude
+    template <typename LogDensity>
+    static void resample(Atmosphere& atmosphere, double top, LogDensity logDensity);
+    void pack(const BodyBatch& batch, int central, const Atmosphere& atmosphere);
+    // participants [begin, end), begin even; writes outX/Y/Z
+    void kernel(const Atmosphere& atmosphere, size_t begin, size_t end);
+};
+
+#endif // ATMOSPHERIC_DRAG_H
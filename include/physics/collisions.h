@@ -0,0 +1,88 @@
+#ifndef COLLISIONS_H
+#define COLLISIONS_H
+
+#include "physics/spatial_hash.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class PhysObj;
+
+// what happens to two overlapping bodies; a pair takes the later of its
+// two bodies' responses, so a body set to merge swallows bouncing ones
+enum class CollisionResponse {
+    Flag,    // reported only
+    Bounce,  // impulse along the line of centers, then pushed apart
+    Merge    // the lighter body is absorbed, conserving mass and momentum
+};
+
+// one overlap found in a step, as resolved
+struct Contact {
+    int idA, idB;              // idA < idB
+    glm::dvec3 normal;         // unit, from A toward B
+    double depth;              // m of overlap
+    double closingSpeed;       // m/s along the normal, > 0 when approaching
+    CollisionResponse response;
+};
+
+// Overlap tests between the spheres of every body with a radius, at the
+// positions of each step. Bodies up to LARGE_RADIUS_FACTOR times the median
+// radius go into a SpatialHash with cells one largest diameter wide, so each
+// is tested against its own cell and the 13 neighbors ahead of it; the few
+// larger bodies are tested against everything. Detection is split over the
+// pool and responses are applied in id order, so a run is deterministic.
+// Bodies moving more than a diameter per step can pass through each other.
+class CollisionSystem {
+public:
+    static constexpr double LARGE_RADIUS_FACTOR = 8.0;
+
+    bool enabled = true;
+    CollisionResponse defaultResponse = CollisionResponse::Merge;
+    double restitution = 1.0; // of bounces: 1 elastic, 0 the bodies move on together
+
+    // overrides defaultResponse for one body
+    void setResponse(int id, CollisionResponse response);
+    void clearResponse(int id);
+
+    // resolves every overlapping pair among physObjs. Bodies absorbed by
+    // merges are erased from physObjs and their ids appended to absorbed;
+    // other bodies and their ids are untouched
+    void update(std::unordered_map<int, PhysObj*>& physObjs, ThreadPool& workers, std::vector<int>& absorbed);
+    // every pair resolved by the last update
+    const std::vector<Contact>& getContacts() const;
+
+    // detection over rings of particles around a planet, up to particles
+    static void benchmark(int particles);
+
+private:
+    // a small body in the hash, with its sphere so tests stay in the table
+    struct Cell {
+        uint64_t key;
+        glm::dvec3 center;
+        double radius;
+        uint32_t index;  // into the gathered bodies
+    };
+
+    std::unordered_map<int, CollisionResponse> responses;
+
+    // gathered bodies with a radius
+    std::vector<int> ids;
+    std::vector<PhysObj*> objs;
+    std::vector<glm::dvec3> centers;
+    std::vector<double> radii;
+    std::vector<uint32_t> small, large;
+    std::vector<Cell> cells;
+    SpatialHash<Cell> hash;
+    // overlapping index pairs, per chunk, then all of them in order
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> chunkPairs;
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::vector<Contact> contacts;
+
+    void gather(const std::unordered_map<int, PhysObj*>& physObjs);
+    void detect(ThreadPool& workers);
+    CollisionResponse responseOf(int id) const;
+};
+
+#endif // COLLISIONS_H
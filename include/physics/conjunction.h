@@ -0,0 +1,114 @@
+#ifndef CONJUNCTION_H
+#define CONJUNCTION_H
+
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class PhysObj;
+
+// one close approach found by ConjunctionScreener
+struct Conjunction {
+    int idA, idB;           // idA < idB
+    double tca;             // s of simulated time at closest approach
+    double missDistance;    // m
+    double relativeSpeed;   // m/s
+};
+
+// Close-approach screening over the trajectories of registered bodies.
+// States are sampled from their PhysObjs as the engine moves them and kept
+// for a window of samples; each sample interval is one time bin, with the
+// motion inside it a cubic Hermite curve. A full window goes through:
+//   1. an apogee/perigee band sieve that drops bodies no other band comes near,
+//   2. per bin, a spatial hash of each body's swept box (the Bezier hull of
+//      its curve), giving the pairs whose boxes come within the distance,
+//   3. the apogee/perigee and orbit-path filters on those pairs, from
+//      osculating elements about the central body at the start of the bin,
+//   4. TCA refinement: the roots of the quintic d/dt |r|^2 of the relative
+//      curve in the bin, kept when the miss distance is under the threshold.
+// Bins are split over the pool.
+class ConjunctionScreener {
+public:
+    // slack for osculating elements straying from the true path: over a bin
+    // for the pair filters, and over a whole window (J2 short-period terms,
+    // tens of km in LEO) for the band sieve
+    static constexpr double FILTER_MARGIN = 2e3;  // m
+    static constexpr double SIEVE_MARGIN = 50e3;  // m
+
+    struct Stats {
+        size_t windows = 0;
+        size_t boxPairs = 0;        // pairs out of the hash, per bin
+        size_t bandPairs = 0;       // passing apogee/perigee
+        size_t pathPairs = 0;       // passing the orbit-path filter
+        size_t conjunctions = 0;
+        double screenedTime = 0.0;  // s of simulated time screened
+        double computeTime = 0.0;   // s of wall clock spent screening
+        size_t longBins = 0;        // bins stretched past sampleInterval by late samples
+    };
+
+    // distance (m) to report under; sampleInterval (s) between states
+    explicit ConjunctionScreener(double distance, double sampleInterval = 60.0, int binsPerWindow = 30);
+    ~ConjunctionScreener();
+
+    // the body the element filters are taken about, and its mu (m^3/s^2);
+    // without one every pair goes straight to refinement
+    void setCentral(const PhysObj* body, double mu);
+    // bodies added mid-window join at the next window
+    void addObject(int id, const PhysObj* obj);
+    void removeObject(int id);
+    size_t objectCount() const;
+
+    // record every body once sampleInterval has passed since the last sample;
+    // a full window is screened on the spot. Returns the conjunctions it found.
+    // Bins much longer than sampleInterval no longer bound the paths between
+    // samples, so callers stepping further than that should bring the bodies
+    // to each nextSampleTime() and sample there first
+    size_t sample(double time, ThreadPool& workers);
+    // infinity until the first sample
+    double nextSampleTime() const;
+
+    // every conjunction found so far, in window order and by TCA within one
+    const std::vector<Conjunction>& getConjunctions() const;
+    const Stats& getStats() const;
+    double conjunctionsPerComputeHour() const;
+    void printStats() const;
+
+    // screens a synthetic SGP4 catalog over hours of simulated time
+    static void benchmark(int objects, double hours, double distance);
+
+    struct Orbit;   // filter quantities of one body, conjunction.cpp
+    struct Scratch; // per-chunk hash and output buffers, conjunction.cpp
+
+private:
+    double distance;
+    double sampleInterval;
+    int binsPerWindow;
+    const PhysObj* central = nullptr;
+    double mu = 0.0;
+    std::unordered_map<int, const PhysObj*> objects;
+
+    // the current window: bodies in slot order, nullptr once removed,
+    // and their states relative to the central body, [sample * slots + slot]
+    std::vector<int> slotIDs;
+    std::vector<const PhysObj*> slotObjs;
+    std::vector<double> times;
+    std::vector<glm::dvec3> positions, velocities;
+
+    std::vector<uint32_t> screened;   // slots left after the band sieve
+    std::vector<Scratch> scratch;
+    std::vector<Conjunction> conjunctions;
+    Stats stats;
+
+    void startWindow();
+    void record(double time);
+    size_t screen(ThreadPool& workers);
+    // fills screened with the slots that pass the band sieve
+    void sieve();
+    void screenBin(size_t bin, double cell, Scratch& out) const;
+    bool filterPair(uint32_t a, uint32_t b, Scratch& out) const;
+    void refinePair(uint32_t a, uint32_t b, size_t bin, Scratch& out) const;
+};
+
+#endif // CONJUNCTION_H
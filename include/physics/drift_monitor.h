@@ -0,0 +1,65 @@
+#ifndef DRIFT_MONITOR_H
+#define DRIFT_MONITOR_H
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+
+// what point-mass gravity conserves, summed over the integrated bodies after
+// a step. Force models (harmonics, drag, radiation pressure) act from
+// outside the system, so their work shows up as drift too
+struct ConservedTotals {
+    double time = 0.0;                   // s
+    size_t bodies = 0;
+    double kinetic = 0.0;                // J
+    double potential = 0.0;              // J, pairwise, softened as the forces are
+    glm::dvec3 momentum{ 0.0 };          // kg m/s
+    glm::dvec3 angularMomentum{ 0.0 };   // kg m^2/s, about the origin
+    // sums of magnitudes, the scale drift is measured against when the
+    // totals themselves are near zero
+    double momentumScale = 0.0;
+    double angularMomentumScale = 0.0;
+
+    double energy() const { return kinetic + potential; }
+};
+
+// Relative drift of energy, momentum and angular momentum from the totals
+// the monitor started at, with rolling histories for the GUI. Starts over
+// whenever bodies are added, removed or merged. With throttling on, the
+// sim speed is halved each step that drifts by more than tolerance and
+// eases back once steps are clean again.
+class DriftMonitor {
+public:
+    static constexpr int HISTORY = 240;
+
+    struct Series {
+        const char* name;
+        std::array<float, HISTORY> history = {}; // relative drift since the start
+        int head = 0;                            // next write index
+        double drift = 0.0;                      // latest
+        double stepDrift = 0.0;                  // over the last step alone
+    };
+
+    bool throttle = false;
+    double tolerance = 1e-10; // of drift in one step
+
+    void record(const ConservedTotals& totals);
+    void reset();
+
+    const Series& energy() const;
+    const Series& momentum() const;
+    const Series& angularMomentum() const;
+    // factor in (0, 1] to scale the requested sim speed by; 1 without throttling
+    float speedScale() const;
+    void printStats() const;
+
+private:
+    bool started = false;
+    ConservedTotals initial, previous;
+    Series series[3] = { { "energy" }, { "momentum" }, { "angular momentum" } };
+    float scale = 1.0f;
+
+    void push(Series& s, double drift, double stepDrift);
+};
+
+#endif // DRIFT_MONITOR_H
@@ -0,0 +1,103 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <glm/glm.hpp>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class PhysObj;
+
+// the bodies an event reads, in the order it was registered with, at one
+// time inside a step
+struct EventState {
+    double time = 0.0;            // s of simulated time
+    std::vector<glm::dvec3> pos;  // m
+    std::vector<glm::dvec3> vel;  // m/s
+};
+
+enum class EventDirection {
+    Any,
+    Rising,   // the function goes from negative to non-negative
+    Falling   // the function goes from positive to non-positive
+};
+
+// one zero crossing, refined to within EventDetector::TIME_TOLERANCE
+struct EventHit {
+    int eventID;
+    bool rising;
+    EventState state;  // the bodies at the crossing
+};
+
+using EventFunction = std::function<double(const EventState&)>;
+using EventCallback = std::function<void(const EventHit&)>;
+
+// Zero crossings of scalar functions of body states, located without
+// touching the step. Each step the states of every event's bodies are kept
+// from before it; afterwards the function is sampled along a quintic
+// Hermite curve matching both ends' positions, velocities and accelerations.
+// The curve agrees with the integrator only at the ends; in between it is a
+// smooth fit, not the Verlet update. Each sign change is refined with
+// Brent's method on that curve. Crossings are reported in time order
+// once the step is done. An event whose bodies are not all integrated by
+// the engine is skipped.
+class EventDetector {
+public:
+    static constexpr double TIME_TOLERANCE = 1e-6;  // s
+    static constexpr int MAX_ITERATIONS = 64;
+
+    // samples of each function per step; crossings closer together than a
+    // sample apart can cancel out
+    int samplesPerStep = 4;
+
+    // returns the event's id; onHit runs after the step that crosses
+    int addEvent(const std::vector<int>& bodies, EventFunction function,
+                 EventDirection direction = EventDirection::Any, EventCallback onHit = nullptr);
+    void removeEvent(int eventID);
+    // drops every event reading a body
+    void removeBody(int id);
+    // drops every event and the last step's hits
+    void clear();
+    size_t eventCount() const;
+
+    // states of every event's bodies before a step
+    void beginStep(double time, const std::unordered_map<int, PhysObj*>& physObjs);
+    // brackets and refines crossings over the step just taken
+    void endStep(double time, const std::unordered_map<int, PhysObj*>& physObjs);
+    // crossings of the last step, by time
+    const std::vector<EventHit>& getHits() const;
+
+    // rises through zero at each closest approach of bodies {a, b} (periapsis
+    // when a is the central body) and falls at each farthest
+    static EventFunction approach();
+    // rises through zero as bodies {a, b} move apart past distance (m), as
+    // when b leaves a's sphere of influence
+    static EventFunction separation(double distance);
+    // falls through zero as body {a} enters the penumbra cast by {b} of
+    // occluderRadius from the light of {c} of sunRadius (m), rises on leaving
+    static EventFunction penumbra(double occluderRadius, double sunRadius);
+
+private:
+    struct Event {
+        int id;
+        std::vector<int> bodies;
+        EventFunction function;
+        EventDirection direction;
+        EventCallback onHit;
+        // the step's start, when every body was present
+        bool started = false;
+        EventState start;
+        std::vector<glm::dvec3> acc;
+        double value = 0.0;
+    };
+
+    int nextID = 0;
+    std::vector<Event> events;
+    std::vector<EventHit> hits;
+
+    // bodies of an event along the step's curve at time
+    void interpolate(const Event& event, const EventState& end, const std::vector<glm::dvec3>& endAcc,
+                     double time, EventState& out) const;
+};
+
+#endif // EVENTS_H
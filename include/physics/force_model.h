@@ -0,0 +1,46 @@
+#ifndef FORCE_MODEL_H
+#define FORCE_MODEL_H
+
+#include "thread_pool.h"
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+
+class PhysObj;
+
+// SoA snapshot of every body, gathered once per force evaluation so models
+// stream over contiguous arrays instead of chasing PhysObj pointers
+struct BodyBatch {
+    std::vector<int> ids;
+    std::vector<PhysObj*> objs;
+    std::vector<double> x, y, z;     // m
+    std::vector<double> vx, vy, vz;  // m/s
+    std::vector<double> mass;        // kg
+    std::vector<double> radius;      // m
+    std::vector<double> ax, ay, az;  // m/s^2, summed over every model
+    double time = 0.0;               // s of simulated time at these states
+
+    void gather(const std::unordered_map<int, PhysObj*>& physObjs);
+    // adds the summed acceleration into each body's acc_new
+    void scatter() const;
+    // batch index of id, -1 if absent
+    int find(int id) const;
+    size_t size() const;
+
+private:
+    std::unordered_map<int, int> indexByID;
+};
+
+// A perturbing acceleration evaluated after point-mass gravity. Models add
+// into batch.ax/ay/az and split their own work over the pool; each chunk
+// must write disjoint bodies.
+class ForceModel {
+public:
+    bool enabled = true;
+
+    virtual ~ForceModel() = default;
+    virtual const char* name() const = 0;
+    virtual void evaluate(BodyBatch& batch, ThreadPool& workers) = 0;
+};
+
+#endif // FORCE_MODEL_H
@@ -1,8 +1,16 @@
 #ifndef PHYSICS_ENGINE_H
 #define PHYSICS_ENGINE_H
 
+#include "physics/solar_irradiance.h"
+#include "physics/force_model.h"
+#include "physics/collisions.h"
+#include "physics/events.h"
+#include "physics/drift_monitor.h"
+#include "thread_pool.h"
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <string>
 #include <glm/glm.hpp>
 
 class PhysObj {
@@ -12,10 +20,13 @@ public:
     glm::dvec3 acc;      // m/s^2
     glm::dvec3 acc_new;  // m/s^2
     double mass;         // kg
+    double radius;       // m, 0 for point bodies
+    Illumination illumination; // written by SolarIrradiance each step
 
     PhysObj(glm::dvec3 pos = glm::dvec3(0.0),
             glm::dvec3 vel = glm::dvec3(0.0),
-            double mass = 1.0);
+            double mass = 1.0,
+            double radius = 0.0);
 
     virtual ~PhysObj() = default;
 
@@ -24,18 +35,75 @@ public:
     void integrateVel(double dT);
 };
 
+// how point-mass gravity is eased at close range, for collisionless runs
+// where bodies stand for parcels of a cloud rather than solid objects
+enum class Softening {
+    None,     // exact 1/r^2, pairs closer than 1e-4 m skipped
+    Plummer,  // 1/(r^2 + eps^2), the pull of a Plummer sphere of scale eps
+    Spline    // cubic-spline mass of radius 2.8 eps (as in GADGET), exact 1/r^2 beyond it
+};
+
 class PhysicsEngine {
 private:
     std::unordered_map<int, PhysObj*> physObjs;
+    std::unordered_map<int, PhysObj*> kinematicObjs; // moved by their owner, never integrated
+    std::unique_ptr<SolarIrradiance> irradiance;
+    std::vector<std::unique_ptr<ForceModel>> forceModels;
+    std::unique_ptr<CollisionSystem> collisions;
+    std::vector<int> absorbed; // merged away since the last takeAbsorbed
+    std::unique_ptr<EventDetector> events;
+    ConservedTotals totals; // after the last step
+    std::unique_ptr<DriftMonitor> drift;
+    BodyBatch batch;
+    Softening softening = Softening::None;
+    std::unordered_map<int, int> speciesOf;          // bodies not listed are species 0
+    std::unordered_map<int, double> softeningLengths; // m, by species
+    // bodies of the pairwise pass and their softening lengths
+    std::vector<PhysObj*> pairObjs;
+    std::vector<double> pairSoftening;
+    std::unique_ptr<ThreadPool> workers;
+    double time = 0.0; // s simulated since start
+
+    // perturbations on top of point-mass gravity, summed into acc_new
+    void applyForceModels();
 
 public:
     PhysicsEngine();
     ~PhysicsEngine();
 
     void addPhysObj(int id, PhysObj*);
+    // body whose state is written from outside (e.g. SGP4); skips integration and the force pass
+    void addKinematicObj(int id, PhysObj*);
     void removePhysObj(int id);
     void clear();
 
+    // body that emits light, and its luminosity (W)
+    void setSun(int id, double luminosity);
+    // shadow-trace sunlight onto every body at its current position
+    void updateIllumination();
+    SolarIrradiance* getIrradiance();
+    CollisionSystem* getCollisions();
+    // ids of bodies merged into others since the last call. They are
+    // already out of the engine; their owners free them. Other ids stay valid
+    std::vector<int> takeAbsorbed();
+    EventDetector* getEvents();
+    const ConservedTotals& getTotals() const;
+    DriftMonitor* getDriftMonitor();
+    double getTime() const;
+    ThreadPool& getWorkers();
+
+    // models run in the order added; returns the model for configuration
+    ForceModel* addForceModel(std::unique_ptr<ForceModel> model);
+    ForceModel* getForceModel(const std::string& name);
+
+    // softening kernel for every pair; a pair uses the larger of its two
+    // bodies' lengths, and pairs with a length of 0 stay exact
+    void setSoftening(Softening kernel);
+    Softening getSoftening() const;
+    // softening length (m) of a species, and the species of a body
+    void setSofteningLength(int species, double length);
+    void setSpecies(int id, int species);
+
     void computeForces();
     void updateAll(float dT);
 };
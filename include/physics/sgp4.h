@@ -0,0 +1,86 @@
+#ifndef SGP4_H
+#define SGP4_H
+
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// mean elements of one object from a two-line element set
+struct TwoLineElements {
+    std::string name;
+    int catalogNumber = 0;
+    double epoch = 0.0;          // Julian date, UTC
+    double bstar = 0.0;          // 1/earth radii
+    double inclination = 0.0;    // rad
+    double raan = 0.0;           // rad
+    double eccentricity = 0.0;
+    double argPerigee = 0.0;     // rad
+    double meanAnomaly = 0.0;    // rad
+    double meanMotion = 0.0;     // rad/min
+
+    // fixed-column TLE lines; false on a malformed line or a bad checksum
+    static bool parse(const std::string& line1, const std::string& line2, TwoLineElements& out);
+};
+
+// SGP4/SDP4 (Vallado et al. 2006, WGS-72, improved mode) over a whole TLE
+// catalog. Near-Earth objects, most of any catalog, keep their initialized
+// constants in SoA arrays and go through SGP4 two at a time in SIMD lanes.
+// Deep-space objects (periods of 225 min and up) take the scalar SDP4 path
+// with lunar-solar and resonance terms. Both are split over the pool.
+class Sgp4Catalog {
+public:
+    static constexpr double EARTH_RADIUS = 6378.135;  // km, WGS-72
+    static constexpr double MU = 398600.8;            // km^3/s^2, WGS-72
+
+    struct Record; // initialized SGP4/SDP4 state of one object, sgp4.cpp
+
+    Sgp4Catalog();
+    ~Sgp4Catalog();
+
+    // TLE file with or without name lines; returns the objects added
+    size_t load(const std::string& path);
+    // false when the elements cannot be propagated
+    bool add(const TwoLineElements& elements);
+    size_t size() const;
+    const TwoLineElements& getElements(size_t i) const;
+
+    // every object at jd (UTC Julian date), TEME frame
+    void propagate(double jd, ThreadPool& workers);
+    glm::dvec3 getPosition(size_t i) const;  // m
+    glm::dvec3 getVelocity(size_t i) const;  // m/s
+    // 0, or the SGP4 error code of the last propagation; 6 is decayed
+    int getStatus(size_t i) const;
+
+    // one object through the scalar path: km and km/s, minutes from its epoch
+    int propagate(size_t i, double minutes, glm::dvec3& position, glm::dvec3& velocity);
+
+    // objects with random elements in a LEO-heavy mix, epochs up to 5 days before epoch
+    void addSynthetic(size_t objects, double epoch, unsigned seed = 7);
+
+    static double julianDate(std::chrono::system_clock::time_point time);
+    // ms per catalog propagation for synthetic catalogs up to objects
+    static void benchmark(int objects);
+
+private:
+    std::vector<TwoLineElements> elements;
+    std::vector<Record> records;
+
+    // near-Earth constants, one row of stride doubles per field, padded to a SIMD pair
+    bool packed = false;
+    size_t stride = 0;
+    std::vector<double> nearEarth;
+    std::vector<size_t> nearIndex, deepIndex;
+
+    // results in catalog order
+    std::vector<double> px, py, pz, pvx, pvy, pvz;
+    std::vector<int> status;
+
+    void pack();
+    // near-Earth slots [begin, end), begin even
+    void nearEarthKernel(size_t begin, size_t end, double jd);
+    void store(size_t i, const glm::dvec3& position, const glm::dvec3& velocity, int code);
+};
+
+#endif // SGP4_H
@@ -0,0 +1,159 @@
+#ifndef PHYSICS_SIMD_H
+#define PHYSICS_SIMD_H
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHYSICS_SSE2
+#endif
+
+// Two doubles processed together, so long batched force kernels read like
+// their scalar formulas. SSE2 when available, otherwise a plain pair.
+// Comparisons return all-ones / all-zeros lane masks for select().
+struct Double2 {
+#ifdef PHYSICS_SSE2
+    __m128d v;
+
+    Double2() = default;
+    Double2(__m128d v) : v(v) {}
+    Double2(double x) : v(_mm_set1_pd(x)) {}
+
+    static Double2 load(const double* p) { return _mm_loadu_pd(p); }
+    void store(double* p) const { _mm_storeu_pd(p, v); }
+    // bit i set when lane i of a mask is true
+    int mask() const { return _mm_movemask_pd(v); }
+#else
+    double v[2];
+
+    Double2() = default;
+    Double2(double x) : v{ x, x } {}
+    Double2(double a, double b) : v{ a, b } {}
+
+    static Double2 load(const double* p) { return Double2(p[0], p[1]); }
+    void store(double* p) const { p[0] = v[0]; p[1] = v[1]; }
+    int mask() const { return int(std::signbit(v[0])) | int(std::signbit(v[1])) << 1; }
+#endif
+};
+
+#ifdef PHYSICS_SSE2
+inline Double2 operator+(Double2 a, Double2 b) { return _mm_add_pd(a.v, b.v); }
+inline Double2 operator-(Double2 a, Double2 b) { return _mm_sub_pd(a.v, b.v); }
+inline Double2 operator*(Double2 a, Double2 b) { return _mm_mul_pd(a.v, b.v); }
+inline Double2 operator/(Double2 a, Double2 b) { return _mm_div_pd(a.v, b.v); }
+inline Double2 operator-(Double2 a) { return _mm_xor_pd(a.v, _mm_set1_pd(-0.0)); }
+inline Double2 operator<(Double2 a, Double2 b) { return _mm_cmplt_pd(a.v, b.v); }
+inline Double2 operator>(Double2 a, Double2 b) { return _mm_cmpgt_pd(a.v, b.v); }
+inline Double2 operator<=(Double2 a, Double2 b) { return _mm_cmple_pd(a.v, b.v); }
+inline Double2 operator>=(Double2 a, Double2 b) { return _mm_cmpge_pd(a.v, b.v); }
+inline Double2 operator&(Double2 a, Double2 b) { return _mm_and_pd(a.v, b.v); }
+inline Double2 operator|(Double2 a, Double2 b) { return _mm_or_pd(a.v, b.v); }
+inline Double2 sqrt(Double2 a) { return _mm_sqrt_pd(a.v); }
+inline Double2 min(Double2 a, Double2 b) { return _mm_min_pd(a.v, b.v); }
+inline Double2 max(Double2 a, Double2 b) { return _mm_max_pd(a.v, b.v); }
+inline Double2 abs(Double2 a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+// nearest integer, |a| < 2^31
+inline Double2 rint(Double2 a) { return _mm_cvtepi32_pd(_mm_cvtpd_epi32(a.v)); }
+// lanes of a where mask is set, b elsewhere
+inline Double2 select(Double2 mask, Double2 a, Double2 b) {
+    return _mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v));
+}
+// e^x to a couple of ulp (Cephes): x = k ln2 + r, a Pade form in r, then the
+// exponent bits of 2^k. Inputs are clamped to the normal double range.
+inline Double2 exp(Double2 x) {
+    x = _mm_min_pd(_mm_max_pd(x.v, _mm_set1_pd(-708.0)), _mm_set1_pd(709.0));
+    __m128i k = _mm_cvtpd_epi32(_mm_mul_pd(x.v, _mm_set1_pd(1.4426950408889634074)));
+    __m128d kd = _mm_cvtepi32_pd(k);
+    __m128d r = _mm_sub_pd(_mm_sub_pd(x.v, _mm_mul_pd(kd, _mm_set1_pd(6.93145751953125e-1))),
+                           _mm_mul_pd(kd, _mm_set1_pd(1.42860682030941723212e-6)));
+    __m128d r2 = _mm_mul_pd(r, r);
+    __m128d p = _mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(1.26177193074810590878e-4), r2),
+                                                 _mm_set1_pd(3.02994407707441961300e-2)), r2),
+                           _mm_set1_pd(9.99999999999999999910e-1));
+    __m128d q = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(3.00198505138664455042e-6), r2), _mm_set1_pd(2.52448340349684104192e-3));
+    q = _mm_add_pd(_mm_mul_pd(q, r2), _mm_set1_pd(2.27265548208155028766e-1));
+    q = _mm_add_pd(_mm_mul_pd(q, r2), _mm_set1_pd(2.0));
+    p = _mm_mul_pd(p, r);
+    __m128d e = _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(2.0), _mm_div_pd(p, _mm_sub_pd(q, p))));
+    __m128i bits = _mm_slli_epi64(_mm_unpacklo_epi32(_mm_add_epi32(k, _mm_set1_epi32(1023)), _mm_setzero_si128()), 52);
+    return _mm_mul_pd(e, _mm_castsi128_pd(bits));
+}
+// sin and cos together (Cephes polynomials), |x| up to about 1e6: x = k pi/2 + r
+// with a three-part pi/2, both series in r, then the quadrant picks and signs
+inline void sincos(Double2 x, Double2& s, Double2& c) {
+    __m128i k = _mm_cvtpd_epi32(_mm_mul_pd(x.v, _mm_set1_pd(0.63661977236758134308)));
+    __m128d kd = _mm_cvtepi32_pd(k);
+    __m128d r = _mm_sub_pd(x.v, _mm_mul_pd(kd, _mm_set1_pd(1.57079632673412561417e+00)));
+    r = _mm_sub_pd(r, _mm_mul_pd(kd, _mm_set1_pd(6.07710050630396597660e-11)));
+    r = _mm_sub_pd(r, _mm_mul_pd(kd, _mm_set1_pd(2.02226624879595063154e-21)));
+    __m128d z = _mm_mul_pd(r, r);
+
+    __m128d ps = _mm_set1_pd(1.58962301576546568060e-10);
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-2.50507477628578072866e-8));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(2.75573136213857245213e-6));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.98412698295895385996e-4));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(8.33333333332211858878e-3));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.66666666666666307295e-1));
+    __m128d sr = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+    __m128d pc = _mm_set1_pd(-1.13585365213876817300e-11);
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(2.08757008419747316778e-9));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-2.75573141792967388112e-7));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(2.48015872888517045348e-5));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-1.38888888888730564116e-3));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(4.16666666666665929218e-2));
+    __m128d cr = _mm_add_pd(_mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(0.5), z)),
+                            _mm_mul_pd(_mm_mul_pd(z, z), pc));
+
+    // per-lane quadrant bits widened to 64-bit masks
+    __m128i q = _mm_shuffle_epi32(k, _MM_SHUFFLE(1, 1, 0, 0));
+    __m128d odd = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128d sinNeg = _mm_castsi128_pd(_mm_slli_epi64(_mm_srli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 1), 63));
+    __m128i q1 = _mm_add_epi32(q, _mm_set1_epi32(1));
+    __m128d cosNeg = _mm_castsi128_pd(_mm_slli_epi64(_mm_srli_epi32(_mm_and_si128(q1, _mm_set1_epi32(2)), 1), 63));
+    s = _mm_xor_pd(_mm_or_pd(_mm_and_pd(odd, cr), _mm_andnot_pd(odd, sr)), sinNeg);
+    c = _mm_xor_pd(_mm_or_pd(_mm_and_pd(odd, sr), _mm_andnot_pd(odd, cr)), cosNeg);
+}
+#else
+#define DOUBLE2_LANEWISE(expr) Double2 r; for (int i = 0; i < 2; ++i) r.v[i] = (expr); return r
+inline Double2 operator+(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] + b.v[i]); }
+inline Double2 operator-(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] - b.v[i]); }
+inline Double2 operator*(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] * b.v[i]); }
+inline Double2 operator/(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] / b.v[i]); }
+inline Double2 operator-(Double2 a) { DOUBLE2_LANEWISE(-a.v[i]); }
+inline Double2 operator<(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] < b.v[i] ? -0.0 : 0.0); }
+inline Double2 operator>(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] > b.v[i] ? -0.0 : 0.0); }
+inline Double2 operator<=(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] <= b.v[i] ? -0.0 : 0.0); }
+inline Double2 operator>=(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] >= b.v[i] ? -0.0 : 0.0); }
+inline Double2 operator&(Double2 a, Double2 b) { DOUBLE2_LANEWISE(std::signbit(a.v[i]) && std::signbit(b.v[i]) ? -0.0 : 0.0); }
+inline Double2 operator|(Double2 a, Double2 b) { DOUBLE2_LANEWISE(std::signbit(a.v[i]) || std::signbit(b.v[i]) ? -0.0 : 0.0); }
+inline Double2 sqrt(Double2 a) { DOUBLE2_LANEWISE(std::sqrt(a.v[i])); }
+inline Double2 min(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+inline Double2 max(Double2 a, Double2 b) { DOUBLE2_LANEWISE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+inline Double2 abs(Double2 a) { DOUBLE2_LANEWISE(std::fabs(a.v[i])); }
+inline Double2 rint(Double2 a) { DOUBLE2_LANEWISE(std::rint(a.v[i])); }
+inline Double2 select(Double2 mask, Double2 a, Double2 b) { DOUBLE2_LANEWISE(std::signbit(mask.v[i]) ? a.v[i] : b.v[i]); }
+inline Double2 exp(Double2 a) { DOUBLE2_LANEWISE(std::exp(a.v[i])); }
+inline void sincos(Double2 x, Double2& s, Double2& c) {
+    for (int i = 0; i < 2; ++i) {
+        s.v[i] = std::sin(x.v[i]);
+        c.v[i] = std::cos(x.v[i]);
+    }
+}
+#undef DOUBLE2_LANEWISE
+#endif
+
+inline Double2& operator+=(Double2& a, Double2 b) { return a = a + b; }
+inline Double2& operator-=(Double2& a, Double2 b) { return a = a - b; }
+inline Double2& operator*=(Double2& a, Double2 b) { return a = a * b; }
+
+// hint that the cache line at p is needed soon
+inline void prefetch(const void* p) {
+#ifdef PHYSICS_SSE2
+    _mm_prefetch((const char*) p, _MM_HINT_T0);
+#else
+    (void) p;
+#endif
+}
+
+#endif // PHYSICS_SIMD_H
@@ -0,0 +1,56 @@
+#ifndef SOLAR_IRRADIANCE_H
+#define SOLAR_IRRADIANCE_H
+
+#include "physics/sphere_bvh.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+class PhysObj;
+
+// sunlight reaching one body, refreshed every physics step
+struct Illumination {
+    glm::dvec3 sunDir = glm::dvec3(0.0); // unit vector toward the Sun's center
+    double irradiance = 0.0;             // W/m^2 after shadowing
+    float litFraction = 1.0f;            // visible share of the solar disc, averaged over samples
+    float umbra = 0.0f;                  // share of samples that see none of the disc
+    float penumbra = 0.0f;               // share that see part of it
+};
+
+// Traces shadow rays from sample points on every body toward points spread
+// over the solar disc, against a SphereBVH of all bodies but the Sun. Bodies
+// with a radius are sampled at the subsolar point and a ring around it;
+// point bodies at their center. Each sample's rays go out as packets of four.
+class SolarIrradiance {
+public:
+    static constexpr int DISC_SAMPLES = 16; // per surface sample, a multiple of the packet size
+    static constexpr int RING_SAMPLES = 6;  // around the subsolar point
+    static constexpr double RING_ANGLE = 1.0471975511965976; // 60 deg from the subsolar point
+
+    SolarIrradiance();
+
+    // the emitting body and its luminosity (W)
+    void setSun(int id, double luminosity);
+    int getSun() const;
+    // rebuilds or refits the BVH, then writes every body's Illumination
+    void update(const std::unordered_map<int, PhysObj*>& physObjs, ThreadPool& workers);
+    const SphereBVH& getBVH() const;
+
+private:
+    int sunID = -1;
+    double luminosity = 0.0;
+    glm::vec2 disc[DISC_SAMPLES];       // unit-disc sample offsets
+
+    // every body but the Sun, in BVH index order
+    std::vector<PhysObj*> bodies;
+    std::vector<glm::dvec3> centers;
+    std::vector<double> radii;
+    SphereBVH bvh;
+
+    // fraction of the disc seen from point, ignoring body skip
+    float discVisibility(const glm::dvec3& point, const glm::dvec3& sunPos, double sunRadius, int skip) const;
+    void shade(int index, const glm::dvec3& sunPos, double sunRadius) const;
+};
+
+#endif // SOLAR_IRRADIANCE_H
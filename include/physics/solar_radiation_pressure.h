@@ -0,0 +1,79 @@
+#ifndef SOLAR_RADIATION_PRESSURE_H
+#define SOLAR_RADIATION_PRESSURE_H
+
+#include "physics/force_model.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+enum class SrpShape {
+    Cannonball,  // sphere of cross-section area, coefficient Cr
+    FlatPlate    // one plate with an inertially fixed normal
+};
+
+struct SrpProperties {
+    SrpShape shape = SrpShape::Cannonball;
+    double area = 0.0;           // m^2
+    double reflectivity = 1.3;   // Cr, cannonball only: 1 absorbs, 2 mirrors
+    double specular = 0.0;       // plate only: specular and diffuse reflected shares
+    double diffuse = 0.0;
+    glm::dvec3 normal = glm::dvec3(0.0, 0.0, 1.0); // plate only, either face may be lit
+};
+
+enum class ShadowModel {
+    None,
+    Conical,  // penumbra from the apparent Sun and occluder discs
+    Traced    // PhysObj::illumination from SolarIrradiance
+};
+
+// Solar radiation pressure on bodies registered with setBody. Participants
+// are packed into SoA arrays each step and evaluated two at a time in SSE2
+// doubles. Shadowing tests every occluder (a body at least
+// minOccluderRadius in size) against the whole batch with a vectorized
+// cone screen; only the few bodies near a shadow take the scalar
+// disc-overlap path.
+class SolarRadiationPressure : public ForceModel {
+public:
+    static constexpr double SPEED_OF_LIGHT = 299792458.0; // m/s
+
+    ShadowModel shadows = ShadowModel::Conical;
+    double minOccluderRadius = 1e3; // m, smaller bodies cast no shadow
+
+    SolarRadiationPressure(int sunID, double luminosity);
+
+    const char* name() const override;
+    void evaluate(BodyBatch& batch, ThreadPool& workers) override;
+
+    void setBody(int id, const SrpProperties& properties);
+    void removeBody(int id);
+    size_t bodyCount() const;
+
+private:
+    int sunID;
+    double luminosity;   // W
+    std::unordered_map<int, SrpProperties> properties;
+
+    // per-step SoA over participants, padded to a whole SIMD pair
+    size_t count = 0;
+    std::vector<int> batchIndex;
+    std::vector<double> px, py, pz;
+    std::vector<double> cannon;            // Cr A/m
+    std::vector<double> plateS;            // A/m (1 - specular), along the Sun line
+    std::vector<double> plateN1, plateN0;  // A/m 2 specular, A/m 2/3 diffuse, along the normal
+    std::vector<double> nx, ny, nz;
+    std::vector<double> lit;               // traced shadow factor, 1 otherwise
+    std::vector<double> outX, outY, outZ;
+
+    // occluders for this step
+    std::vector<int> occluderIndex;
+    std::vector<double> ox, oy, oz, oRadius;
+
+    void pack(const BodyBatch& batch);
+    // participants [begin, end), begin even; writes outX/Y/Z
+    void kernel(size_t begin, size_t end, const glm::dvec3& sunPos, double sunRadius);
+    // product of the visible Sun fractions past every occluder but the body itself
+    double conicalShadow(size_t k, const glm::dvec3& sunPos, double sunRadius) const;
+};
+
+#endif // SOLAR_RADIATION_PRESSURE_H
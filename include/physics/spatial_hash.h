@@ -0,0 +1,86 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "physics/simd.h"
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// cell coordinates are kept well inside int64 so neighbors never wrap
+constexpr double GRID_CELL_LIMIT = 1e18;
+
+// cell coordinate of x on a grid of 1 / invCell
+inline int64_t gridCell(double x, double invCell) {
+    return (int64_t) std::floor(std::clamp(x * invCell, -GRID_CELL_LIMIT, GRID_CELL_LIMIT));
+}
+
+// cells are grouped into blocks of 4 x 4 x 4
+constexpr int GRID_BLOCK_BITS = 6;
+
+// splitmix64 finalizer, a bijection that spreads every input bit
+inline uint64_t mixBits(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ h >> 31;
+}
+
+// 64-bit key of a cell: its block, hashed one coordinate at a time so
+// nearby blocks spread over the table, above the cell's place in the block.
+// Two cells share a key about as often as any two 58-bit hashes do, which
+// costs callers no more than a few extra exact tests
+inline uint64_t gridKey(int64_t x, int64_t y, int64_t z) {
+    uint64_t h = mixBits(mixBits(mixBits(uint64_t(x >> 2)) + uint64_t(y >> 2)) + uint64_t(z >> 2));
+    return h << GRID_BLOCK_BITS | uint64_t(x & 3) | uint64_t(y & 3) << 2 | uint64_t(z & 3) << 4;
+}
+
+// Uniform-grid spatial hash. Items carry the gridKey of their cell and are
+// grouped by a counting sort into a power-of-two table with twice as many
+// buckets as items, so a build is linear. A block of cells takes 64
+// consecutive buckets, so neighboring cells are near each other in the table
+// and items() runs through space a block at a time. Cells can share a
+// bucket; callers compare keys.
+template <typename Item>
+class SpatialHash {
+public:
+    void build(const std::vector<Item>& items) {
+        bits = GRID_BLOCK_BITS + 1;
+        while ((size_t(1) << bits) < 2 * items.size()) ++bits;
+        size_t count = bucketCount();
+        starts.assign(count + 1, 0);
+        for (const Item& item : items)
+            ++starts[bucketOf(item.key)];
+        for (size_t b = 1; b < count; ++b)
+            starts[b] += starts[b - 1];
+        starts[count] = (uint32_t) items.size();
+        // filled back to front, leaving each start at its bucket's first item
+        sorted.resize(items.size());
+        for (size_t i = items.size(); i-- > 0;)
+            sorted[--starts[bucketOf(items[i].key)]] = items[i];
+    }
+
+    size_t bucketCount() const { return size_t(1) << bits; }
+    // Fibonacci hashing of the block, then the cell within it
+    size_t bucketOf(uint64_t key) const {
+        size_t block = size_t(((key >> GRID_BLOCK_BITS) * 0x9E3779B97F4A7C15ull) >> (64 - bits + GRID_BLOCK_BITS));
+        return block << GRID_BLOCK_BITS | size_t(key & ((1u << GRID_BLOCK_BITS) - 1));
+    }
+    const Item* begin(size_t bucket) const { return sorted.data() + starts[bucket]; }
+    const Item* end(size_t bucket) const { return sorted.data() + starts[bucket + 1]; }
+    // lookups over large tables miss the cache; fetch a bucket's bounds,
+    // then once those are in, its first items
+    void prefetchBucket(size_t bucket) const { prefetch(starts.data() + bucket); }
+    void prefetchItems(size_t bucket) const { prefetch(begin(bucket)); }
+    // every item, in bucket order
+    const std::vector<Item>& items() const { return sorted; }
+
+private:
+    int bits = GRID_BLOCK_BITS + 1;
+    std::vector<Item> sorted;
+    std::vector<uint32_t> starts;
+};
+
+#endif // SPATIAL_HASH_H
@@ -0,0 +1,56 @@
+#ifndef SPHERE_BVH_H
+#define SPHERE_BVH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+// Bounding volume hierarchy over spheres for shadow rays. Bounds are kept in
+// double so bodies an AU apart stay exact; a query converts each node it
+// visits to floats relative to the ray origin and tests a packet of four rays
+// at once. Moving spheres only refit the bounds; the tree is rebuilt when the
+// sphere count changes or refitting has let it grow too loose.
+class SphereBVH {
+public:
+    static constexpr int PACKET_SIZE = 4;
+    static constexpr int LEAF_SIZE = 4;
+    static constexpr double REBUILD_GROWTH = 2.0; // node surface area vs. the last build
+
+    // four rays from one origin
+    struct RayPacket {
+        glm::dvec3 origin;                // m
+        float dx[PACKET_SIZE], dy[PACKET_SIZE], dz[PACKET_SIZE]; // unit directions
+        float tMax[PACKET_SIZE];          // segment lengths, m
+    };
+
+    void build(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii);
+    // same spheres, new positions: recompute bounds bottom-up
+    void refit(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii);
+    // refit, or build when the count changed or the tree degraded; true if rebuilt
+    bool update(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii);
+
+    // bit k set when ray k hits any sphere other than skip
+    int occluded(const RayPacket& packet, int skip = -1) const;
+    size_t size() const;
+
+private:
+    struct Node {
+        glm::dvec3 lo, hi;
+        int first;   // leaf: first slot in the leaf arrays; internal: left child, right is first + 1
+        int count;   // spheres in a leaf, 0 for internal nodes
+    };
+
+    std::vector<Node> nodes;       // parents before children
+    // sphere data in leaf order so a leaf test reads contiguous memory
+    std::vector<int> indices;
+    std::vector<glm::dvec3> leafCenters;
+    std::vector<double> leafRadii;
+    double builtArea = 0.0;
+
+    // fills nodes[index] from indices[begin, end), splitting at the median center
+    void buildNode(const std::vector<glm::dvec3>& centers, int index, int begin, int end);
+    // rewrites the leaf arrays and node bounds, returns the summed node area
+    double refitBounds(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii);
+};
+
+#endif // SPHERE_BVH_H
@@ -0,0 +1,70 @@
+#ifndef SPHERICAL_HARMONICS_H
+#define SPHERICAL_HARMONICS_H
+
+#include "physics/force_model.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+// Non-central gravity of selected bodies from fully normalized C/S
+// coefficients (degree >= 2; the point-mass term stays in computeForces).
+// Every other body within a field's influence distance feels the field, and
+// the central body takes the reaction, so momentum is conserved (the torque
+// would go into the body's spin, which is not modelled). Legendre functions come from the standard forward-column
+// recursion, whose per-(n, m) factors are cached when the degree changes.
+// The body's rotation is evaluated once per step and shared by every
+// particle. Particles go through the recursion two at a time in SIMD lanes.
+class SphericalHarmonicGravity : public ForceModel {
+public:
+    static constexpr int MAX_DEGREE = 360;
+
+    const char* name() const override;
+    void evaluate(BodyBatch& batch, ThreadPool& workers) override;
+
+    // ICGEM .gfc file (gfc lines, fully normalized) for the field of centralID
+    bool load(int centralID, const std::string& path);
+    // zonal-only field from unnormalized J2, J3, ... (J[0] is J2)
+    void setZonal(int centralID, double mu, double radius, const std::vector<double>& J);
+    // truncates evaluation to what was loaded
+    void setDegreeOrder(int centralID, int degree, int order);
+    // equatorialToInertial maps the body's equator frame (z = spin axis) to
+    // the simulation frame; the prime meridian turns at rate rad/s
+    void setRotation(int centralID, const glm::dmat3& equatorialToInertial, double rate, double angleAtEpoch);
+    // bodies farther away get no harmonic terms; default 1000 reference radii
+    void setInfluence(int centralID, double maxDistance);
+    void removeField(int centralID);
+
+    // ms per evaluation against degree for a synthetic field and satellite shell
+    static void benchmark(int maxDegree, int satellites);
+
+private:
+    struct Field {
+        double mu = 0.0;             // m^3/s^2 the coefficients are scaled by
+        double radius = 0.0;         // m, reference radius
+        int loadedDegree = 0;
+        int degree = 0, order = 0;   // evaluated
+        std::vector<double> C, S;    // triangular, index n (n + 1) / 2 + m
+        glm::dmat3 equatorialToInertial = glm::dmat3(1.0);
+        double rate = 0.0, angleAtEpoch = 0.0;
+        double maxDistance = 0.0;
+
+        // recursion factors up to degree + 1, same indexing as C/S
+        std::vector<double> a, b, dp;
+        std::vector<double> sectoral;
+    };
+
+    std::unordered_map<int, Field> fields;
+
+    // per-field scratch, body-fixed coordinates padded to a SIMD pair
+    std::vector<int> particles;
+    std::vector<double> px, py, pz, outX, outY, outZ;
+
+    static void resize(Field& field, int degree);
+    static void cacheRecursion(Field& field);
+    // body-fixed accelerations of particles [begin, end), begin even
+    void kernel(const Field& field, double mu, size_t begin, size_t end);
+};
+
+#endif // SPHERICAL_HARMONICS_H
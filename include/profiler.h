@@ -0,0 +1,94 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "opengl_includes.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <cstdint>
+
+// Per-stage frame timings: CPU stages via ScopedTimer, GPU passes via
+// GL_TIME_ELAPSED queries read back one frame late (double-buffered so the
+// CPU never waits on them). Keeps a rolling history per stage for the GUI
+// and can record a Chrome trace (chrome://tracing, Perfetto).
+class Profiler {
+public:
+    static constexpr int HISTORY = 240;
+
+    struct Stage {
+        std::string name;
+        bool gpu = false;
+        std::array<float, HISTORY> history = {}; // ms
+        int head = 0;                            // next write index
+        double accumMs = 0.0;                    // this frame so far
+
+        float last() const;
+    };
+
+    static Profiler& get();
+
+    void beginFrame();
+    void endFrame();
+
+    // CPU stage sample, times in microseconds since the profiler epoch
+    void addSample(const char* stage, int64_t startUs, int64_t durationUs);
+    // GL_TIME_ELAPSED queries can't nest; one pass at a time
+    void beginGPU(const char* pass);
+    void endGPU();
+
+    void startTrace(const std::string& path);
+    void stopTrace();
+    bool isTracing() const;
+
+    const std::vector<Stage>& getStages() const;
+    int64_t nowUs() const;
+    void cleanup();
+
+private:
+    struct GPUPass {
+        int stage;
+        GLuint queries[2] = {};
+        bool issued[2] = {};
+    };
+    struct TraceEvent {
+        int stage;
+        int64_t startUs, durationUs;
+        int thread;
+    };
+
+    std::mutex mutex;
+    std::vector<Stage> stages;
+    std::vector<GPUPass> gpuPasses;
+    int activeGPUPass = -1;
+    int parity = 0;
+    int64_t frameStartUs = 0;
+
+    bool tracing = false;
+    std::string tracePath;
+    std::vector<TraceEvent> traceEvents;
+    std::unordered_map<std::thread::id, int> threadIDs;
+
+    Profiler();
+    int stageIndex(const char* name, bool gpu);
+    void writeTrace();
+};
+
+// records the enclosing scope as one sample of a CPU stage
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* stage);
+    ~ScopedTimer();
+
+private:
+    const char* stage;
+    int64_t startUs;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage) ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(stage)
+
+#endif // PROFILER_H
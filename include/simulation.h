@@ -5,8 +5,12 @@
 #include "graphics/camera.h"
 #include "graphics/renderable.h"
 #include "physics/physics_engine.h"
+#include "physics/sgp4.h"
+#include "physics/conjunction.h"
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <string>
 
 class SimObj {
 private:
@@ -26,8 +30,8 @@ public:
     SimObj(const SimObj&) = delete;
     SimObj& operator=(const SimObj&) = delete;
 
-    // update renderable model from physObj 
-    void syncPhysicsToRender();
+    // write physObj position relative to the floating origin into the instance offsets
+    void syncPhysicsToRender(const glm::dvec3& origin, glm::vec3* offsets);
 
     // accessors
     int getID() const;
@@ -40,6 +44,24 @@ private:
     std::shared_ptr<GraphicsEngine> gEng;
     std::shared_ptr<PhysicsEngine> pEng;
     std::unordered_map<int, SimObj> simObjs;
+    std::unique_ptr<Sgp4Catalog> catalog;
+    std::vector<int> trackedIDs;   // SimObj per catalog entry, -1 once dropped
+    double epochJD;                // UTC Julian date at simulation time 0
+    std::unique_ptr<ConjunctionScreener> screener;
+
+    // body positioned from outside: no trail, skipped by the force pass
+    void addKinematicSimObj(int id, std::unique_ptr<Renderable> renderable, std::unique_ptr<PhysObj> physObj);
+    // move tracked satellites to their SGP4 states at time (s), relative to
+    // where Earth is now
+    void updateTracked(double time);
+    // screener samples due before the current time, tracked objects brought to each
+    void sampleConjunctions();
+    // print the last count conjunctions found by the screener
+    void reportConjunctions(size_t count) const;
+    // batched camera-relative transform pass over every SimObj
+    void syncPhysicsToRender(const Camera& cam);
+    // sample every body's position into its orbit trail
+    void pushTrailSamples();
 
 public:
     Simulation(std::shared_ptr<GraphicsEngine> gEng, std::shared_ptr<PhysicsEngine> pEng);
@@ -50,6 +72,14 @@ public:
     const SimObj* getSimObj(int id) const;
     void clear();
 
+    // TLE catalog propagated around Earth as kinematic bodies; returns objects added
+    size_t loadTleCatalog(const std::string& path);
+    // screen tracked satellites for approaches under distance (m)
+    void enableConjunctionScreening(double distance);
+    const ConjunctionScreener* getConjunctionScreener() const;
+    // print the Moon's perigees, apogees and passages through Earth's penumbra as they happen
+    void logLunarEvents();
+
     // main update loop: steps physObj, syncs objects, and renders
     void update(OrbitalCamera& cam, float deltaTime);
 };
@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+// Fixed set of worker threads fed from one task queue.
+// parallelFor runs one chunk on the calling thread and helps drain the
+// queue while it waits, so it is safe to nest.
+class ThreadPool {
+public:
+    // 0 threads means hardware_concurrency - 1 (the caller is the extra one)
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of chunks parallelFor will split count items into
+    size_t chunkCount(size_t count, size_t grain) const;
+    // fn(begin, end, chunk) over [0, count) in chunkCount(count, grain) contiguous pieces
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, size_t)>& fn);
+    void enqueue(std::function<void()> task);
+    unsigned size() const;
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskCV;
+    bool stopping = false;
+
+    void workerLoop();
+    bool runOne();
+};
+
+#endif // THREAD_POOL_H
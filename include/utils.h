@@ -2,3 +2,4 @@
 
 glm::vec3 toRender(glm::dvec3 physicsPos);
 float toRender(double realDist);
+double toReal(float renderDist);
@@ -3,11 +3,64 @@
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 UV;
+in float LogZ;
 
 uniform vec3 objectColor;
+uniform bool useTexture;
+uniform sampler2D diffuse; // unit 0
+#ifdef LOG_DEPTH
+uniform float logDepthCoef; // 2 / log2(far + 1)
+#endif
+
+// sunlight: camera-relative Sun position, lit share of the disc from the shadow tracer
+uniform vec3 sunPosition;
+uniform float sunVisibility;
+uniform bool emissive;
+const float AMBIENT = 0.03;
+
+// virtual texture: per-body page table into the shared tile atlas
+uniform bool useVirtualTexture;
+uniform usampler2D pageTable; // unit 1
+uniform sampler2D tileAtlas;  // unit 2
+uniform float tileSize;
+uniform float tileBorder;
+uniform float atlasSize;
 
 out vec4 FragColor;
 
+vec4 sampleVirtual(vec2 uv) {
+    ivec2 tiles = textureSize(pageTable, 0);
+    int maxLevel = findMSB(tiles.y);
+    vec2 texel = uv * vec2(tiles) * tileSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    int level = clamp(int(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))))), 0, maxLevel);
+
+    ivec2 levelTiles = max(tiles >> level, ivec2(1));
+    uvec4 entry = texelFetch(pageTable, clamp(ivec2(uv * vec2(levelTiles)), ivec2(0), levelTiles - 1), level);
+    if (entry.a == 0u)
+        return vec4(objectColor, 1.0);
+
+    // the entry may point at a coarser ancestor; locate uv inside that tile
+    vec2 mappedTiles = vec2(max(tiles >> int(entry.b), ivec2(1)));
+    vec2 inTile = fract(uv * mappedTiles);
+    vec2 origin = vec2(entry.rg) * (tileSize + 2.0 * tileBorder) + tileBorder;
+    return vec4(texture(tileAtlas, (origin + inTile * tileSize) / atlasSize).rgb, 1.0);
+}
+
 void main() {
-    FragColor = vec4(objectColor, 1.0);
+    if (useVirtualTexture)
+        FragColor = sampleVirtual(UV);
+    else if (useTexture)
+        FragColor = vec4(texture(diffuse, UV).rgb, 1.0);
+    else
+        FragColor = vec4(objectColor, 1.0);
+
+    if (!emissive) {
+        float lambert = max(dot(normalize(Normal), normalize(sunPosition - FragPos)), 0.0);
+        FragColor.rgb *= AMBIENT + (1.0 - AMBIENT) * lambert * sunVisibility;
+    }
+    // only the log-depth permutation writes depth, so reversed-Z keeps early-z
+#ifdef LOG_DEPTH
+    gl_FragDepth = log2(LogZ) * logDepthCoef * 0.5;
+#endif
 }
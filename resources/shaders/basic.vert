@@ -3,6 +3,7 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+layout (location = 3) in vec3 aOffset; // camera-relative instance position
 
 uniform mat4 model;
 uniform mat4 view;
@@ -11,11 +12,13 @@ uniform mat4 projection;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 UV;
+out float LogZ;
 
 void main() {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    vec4 worldPos = model * vec4(aPos, 1.0) + vec4(aOffset, 0.0);
     FragPos = worldPos.xyz;
     Normal = mat3(transpose(inverse(model))) * aNormal;
     UV = aUV;
     gl_Position = projection * view * worldPos;
+    LogZ = 1.0 + gl_Position.w;
 }
@@ -0,0 +1,12 @@
+#version 410 core
+
+in vec4 StarColor;
+
+out vec4 FragColor;
+
+void main() {
+    vec2 p = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot(p, p);
+    if (r2 > 1.0) discard;
+    FragColor = vec4(StarColor.rgb * StarColor.a * (1.0 - r2), 1.0);
+}
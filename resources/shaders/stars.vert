@@ -0,0 +1,27 @@
+#version 410 core
+
+layout (location = 0) in vec3 aDir;        // unit vector, ecliptic frame
+layout (location = 1) in float aMagnitude; // thousandths of a magnitude
+layout (location = 2) in vec4 aColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float limitingMagnitude;
+uniform float pointScale; // px diameter of a magnitude 0 star
+
+out vec4 StarColor;
+
+void main() {
+    float magnitude = aMagnitude * 0.001;
+    // direction only: stars sit at infinity, depth is irrelevant with depth test off
+    gl_Position = projection * vec4(mat3(view) * aDir, 0.0);
+    gl_Position.z = 0.0;
+    if (magnitude > limitingMagnitude)
+        gl_Position = vec4(2.0, 2.0, 0.0, 1.0); // off screen
+
+    // diameter follows sqrt(flux) so disc area tracks flux;
+    // below a pixel stars dim instead of shrinking
+    float size = pointScale * pow(10.0, -0.2 * magnitude);
+    gl_PointSize = clamp(size, 1.0, 16.0);
+    StarColor = vec4(aColor.rgb, min(size * size, 1.0));
+}
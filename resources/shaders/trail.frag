@@ -0,0 +1,17 @@
+#version 410 core
+
+in float LogZ;
+
+uniform vec3 trailColor;
+#ifdef LOG_DEPTH
+uniform float logDepthCoef; // 2 / log2(far + 1)
+#endif
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(trailColor, 1.0);
+#ifdef LOG_DEPTH
+    gl_FragDepth = log2(LogZ) * logDepthCoef * 0.5;
+#endif
+}
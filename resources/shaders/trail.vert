@@ -0,0 +1,16 @@
+#version 410 core
+
+layout (location = 0) in vec3 aPos; // relative to the trail's anchor, render units
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform samplerBuffer anchors; // per trail slot: anchor - camera, render units
+uniform int slotSize;          // vertices per trail slot
+
+out float LogZ;
+
+void main() {
+    vec3 anchor = texelFetch(anchors, gl_VertexID / slotSize).xyz;
+    gl_Position = projection * view * vec4(aPos + anchor, 1.0);
+    LogZ = 1.0 + gl_Position.w;
+}
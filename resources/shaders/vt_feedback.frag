@@ -0,0 +1,33 @@
+#version 410 core
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 UV;
+in float LogZ;
+
+uniform usampler2D pageTable;
+uniform float tileSize;
+uniform float lodBias;      // log2 of how much smaller this target is than the screen
+uniform uint vtHandle;
+#ifdef LOG_DEPTH
+uniform float logDepthCoef; // 2 / log2(far + 1)
+#endif
+
+// tile x, tile y, level, handle + 1 (0 = nothing)
+layout (location = 0) out uvec4 Feedback;
+
+void main() {
+    ivec2 tiles = textureSize(pageTable, 0);
+    int maxLevel = findMSB(tiles.y);
+    vec2 texel = UV * vec2(tiles) * tileSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) - lodBias;
+    int level = clamp(int(floor(lod)), 0, maxLevel);
+
+    ivec2 levelTiles = max(tiles >> level, ivec2(1));
+    ivec2 tile = clamp(ivec2(UV * vec2(levelTiles)), ivec2(0), levelTiles - 1);
+    Feedback = uvec4(uvec2(tile), uint(level), vtHandle + 1u);
+#ifdef LOG_DEPTH
+    gl_FragDepth = log2(LogZ) * logDepthCoef * 0.5;
+#endif
+}
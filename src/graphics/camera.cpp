@@ -53,6 +53,20 @@ Camera::~Camera() {
     cleanup();
 }
 void Camera::update() {}
+
+glm::mat4 Camera::makePerspective(float fovy, float aspect, float near) const {
+    if (depthMode != DepthMode::ReversedZ)
+        return glm::infinitePerspective(fovy, aspect, near);
+
+    // infinite far plane, z_ndc = near / w so depth goes from 1 at near to 0 at infinity
+    float f = 1.0f / tanf(fovy / 2.0f);
+    glm::mat4 p(0.0f);
+    p[0][0] = f / aspect;
+    p[1][1] = f;
+    p[2][3] = -1.0f;
+    p[3][2] = near;
+    return p;
+}
 void Camera::cleanup() {
     glfwSetMouseButtonCallback(window, nullptr);
     glfwSetCursorPosCallback(window, nullptr);
@@ -76,18 +90,18 @@ void OrbitalCamera::update() {
 }
 
 void OrbitalCamera::update(glm::dvec3 realTarget) {
-    glm::vec3 renderTarget = toRender(realTarget);
- 
-    position = glm::vec3(
-        radius * cos(elevation) * cos(azimuth),
-        radius * cos(elevation) * sin(azimuth),
-        radius * sin(elevation)
-    ) + renderTarget;
+    // camera position is kept in double; render space is centred on it
+    realPosition = glm::dvec3(
+        cos(elevation) * cos(azimuth),
+        cos(elevation) * sin(azimuth),
+        sin(elevation)
+    ) * toReal(radius) + realTarget;
+    position = toRender(realPosition);
     // position = toRender(glm::dvec3(1.496e11 + 5e7f, 0, 5e7f)); 
     
     model = glm::mat4(1.0f);
-    view = glm::lookAt(position, renderTarget, glm::vec3(0,0,1));
-    projection = glm::infinitePerspective(glm::radians(60.0f), float(width) / float(height), 0.1f);
+    view = glm::lookAt(glm::vec3(0.0f), toRender(realTarget - realPosition), glm::vec3(0,0,1));
+    projection = makePerspective(glm::radians(60.0f), float(width) / float(height), 0.1f);
 }
 
 void OrbitalCamera::handleMouseMove(GLFWwindow* win, double x, double y) {
@@ -0,0 +1,217 @@
+#include "graphics/frame_capture.h"
+#include "graphics/render_target.h"
+#include "opengl_includes.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// ---------------- PNG encoding ----------------
+
+static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+static void putChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    putU32(chunk, (uint32_t) data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putU32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write((const char*) chunk.data(), chunk.size());
+}
+
+// RGBA8 PNG with stored (uncompressed) deflate blocks; rows given top-down
+static bool writePNG(const std::string& path, int width, int height, const uint8_t* rows) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write((const char*) signature, 8);
+
+    std::vector<uint8_t> ihdr;
+    putU32(ihdr, width);
+    putU32(ihdr, height);
+    ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 }); // 8-bit RGBA, no interlace
+    putChunk(file, "IHDR", ihdr);
+
+    // filter byte 0 in front of every row
+    size_t stride = size_t(width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rows + y * stride, rows + (y + 1) * stride);
+    }
+
+    std::vector<uint8_t> idat = { 0x78, 0x01 };
+    uint32_t a = 1, b = 0;
+    for (uint8_t v : raw) {
+        a = (a + v) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (size_t pos = 0; pos < raw.size() || pos == 0; ) {
+        size_t len = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + len >= raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back(len & 0xFF);
+        idat.push_back(len >> 8);
+        idat.push_back(~len & 0xFF);
+        idat.push_back((~len >> 8) & 0xFF);
+        idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+        if (last) break;
+    }
+    putU32(idat, (b << 16) | a);
+    putChunk(file, "IDAT", idat);
+    putChunk(file, "IEND", {});
+    return bool(file);
+}
+
+// ---------------- FrameCapture ----------------
+
+FrameCapture::FrameCapture(std::string outputDir, CaptureFormat format)
+    : outputDir(outputDir), format(format) {
+    glGenBuffers(PBO_COUNT, pbos);
+    worker = std::thread(&FrameCapture::workerLoop, this);
+}
+
+FrameCapture::~FrameCapture() {
+    cleanup();
+}
+
+void FrameCapture::capture(const RenderTarget& target) {
+    int i = nextPBO;
+    // this PBO was filled PBO_COUNT frames ago, so mapping it won't stall
+    if (pboFrame[i] >= 0) collect(i);
+
+    size_t bytes = size_t(target.width) * target.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+    if (bytes != pboBytes[i]) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        pboBytes[i] = bytes;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.FBO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, target.width, target.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pboWidth[i] = target.width;
+    pboHeight[i] = target.height;
+    pboFrame[i] = frameCounter++;
+    nextPBO = (i + 1) % PBO_COUNT;
+}
+
+void FrameCapture::collect(int i) {
+    Frame frame;
+    frame.index = pboFrame[i];
+    frame.width = pboWidth[i];
+    frame.height = pboHeight[i];
+    frame.pixels.resize(pboBytes[i]);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+    void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pboBytes[i], GL_MAP_READ_BIT);
+    if (src) {
+        memcpy(frame.pixels.data(), src, pboBytes[i]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pboFrame[i] = -1;
+    if (!src) return;
+
+    // back-pressure: don't let the encoder fall arbitrarily far behind
+    std::unique_lock<std::mutex> lock(mutex);
+    queueCV.wait(lock, [this] { return queue.size() < MAX_QUEUED_FRAMES; });
+    queue.push_back(std::move(frame));
+    queueCV.notify_all();
+}
+
+void FrameCapture::flush() {
+    for (int k = 0; k < PBO_COUNT; ++k) {
+        int i = (nextPBO + k) % PBO_COUNT;
+        if (pboFrame[i] >= 0) collect(i);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    queueCV.wait(lock, [this] { return queue.empty() && !busy; });
+}
+
+void FrameCapture::workerLoop() {
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueCV.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            frame = std::move(queue.front());
+            queue.pop_front();
+            busy = true;
+            queueCV.notify_all();
+        }
+        writeFrame(frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        queueCV.notify_all();
+    }
+}
+
+void FrameCapture::writeFrame(const Frame& frame) const {
+    // GL rows are bottom-up
+    size_t stride = size_t(frame.width) * 4;
+    std::vector<uint8_t> flipped(frame.pixels.size());
+    for (int y = 0; y < frame.height; ++y)
+        memcpy(&flipped[y * stride], &frame.pixels[(frame.height - 1 - y) * stride], stride);
+
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%06d.%s", frame.index, format == CaptureFormat::PNG ? "png" : "rgba");
+    std::string path = outputDir + "/" + name;
+
+    bool ok;
+    if (format == CaptureFormat::PNG) {
+        ok = writePNG(path, frame.width, frame.height, flipped.data());
+    } else {
+        std::ofstream file(path, std::ios::binary);
+        file.write((const char*) flipped.data(), flipped.size());
+        ok = bool(file);
+    }
+    if (!ok) fprintf(stderr, "Failed to write frame %s\n", path.c_str());
+}
+
+void FrameCapture::cleanup() {
+    if (!worker.joinable()) return;
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queueCV.notify_all();
+    worker.join();
+    glDeleteBuffers(PBO_COUNT, pbos);
+}
@@ -0,0 +1,107 @@
+#include "graphics/frustum_culling.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_CULL_SSE
+#endif
+
+// ---------------- Frustum ----------------
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum f;
+    f.planes[0] = row3 + row0; // left
+    f.planes[1] = row3 - row0; // right
+    f.planes[2] = row3 + row1; // bottom
+    f.planes[3] = row3 - row1; // top
+    f.planes[4] = row3 + row2; // near
+    f.planes[5] = row3 - row2; // far
+
+    for (glm::vec4& p : f.planes) {
+        float len = glm::length(glm::vec3(p));
+        // an infinite projection has a degenerate far plane; make it accept everything
+        if (len < 1e-6f) p = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        else p /= len;
+    }
+    return f;
+}
+
+// ---------------- FrustumCuller ----------------
+
+void FrustumCuller::clear() {
+    xs.clear();
+    ys.clear();
+    zs.clear();
+    radii.clear();
+}
+
+size_t FrustumCuller::addSphere(const glm::vec3& center, float radius) {
+    xs.push_back(center.x);
+    ys.push_back(center.y);
+    zs.push_back(center.z);
+    radii.push_back(radius);
+    return xs.size() - 1;
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum) {
+    size_t count = xs.size();
+    // pad to a whole batch so the loop never reads past the end
+    size_t padded = (count + 3) & ~size_t(3);
+    xs.resize(padded, 0.0f);
+    ys.resize(padded, 0.0f);
+    zs.resize(padded, 0.0f);
+    radii.resize(padded, 0.0f);
+    visible.resize(padded);
+
+    size_t culled = 0;
+    for (size_t i = 0; i < padded; i += 4) {
+#ifdef FRUSTUM_CULL_SSE
+        __m128 x = _mm_loadu_ps(&xs[i]);
+        __m128 y = _mm_loadu_ps(&ys[i]);
+        __m128 z = _mm_loadu_ps(&zs[i]);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radii[i]));
+
+        int mask = 0xF;
+        for (const glm::vec4& p : frustum.planes) {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_mul_ps(y, _mm_set1_ps(p.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+            mask &= _mm_movemask_ps(_mm_cmpge_ps(d, negR));
+        }
+#else
+        int mask = 0;
+        for (int k = 0; k < 4; ++k) {
+            bool inside = true;
+            for (const glm::vec4& p : frustum.planes)
+                inside &= p.x * xs[i + k] + p.y * ys[i + k] + p.z * zs[i + k] + p.w >= -radii[i + k];
+            mask |= int(inside) << k;
+        }
+#endif
+        for (size_t k = 0; k < 4; ++k) {
+            visible[i + k] = (mask >> k) & 1;
+            if (i + k < count && !visible[i + k]) ++culled;
+        }
+    }
+
+    xs.resize(count);
+    ys.resize(count);
+    zs.resize(count);
+    radii.resize(count);
+    return culled;
+}
+
+bool FrustumCuller::isVisible(size_t index) const {
+    return visible[index];
+}
+
+size_t FrustumCuller::size() const {
+    return xs.size();
+}
@@ -3,15 +3,36 @@
 #include "graphics/shader.h"
 #include "graphics/camera.h"
 #include "graphics/renderable.h"
+#include "graphics/sphere_lod.h"
+#include "graphics/frustum_culling.h"
+#include "graphics/instance_buffer.h"
+#include "graphics/render_target.h"
+#include "graphics/orbit_trails.h"
+#include "graphics/frame_capture.h"
+#include "graphics/render_queue.h"
+#include "graphics/star_field.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "utils.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cstdio>
+#include <cmath>
 #include <memory>
+#include <filesystem>
 
-GraphicsEngine::GraphicsEngine(std::string title, int initialWidth, int initialHeight)
-    : title(title) {
+static const char* STAR_CATALOG = "resources/stars.bin";
+
+// far distance (render units) mapped to depth 1 by the log-depth fallback
+constexpr float LOG_DEPTH_FAR = 1e16f;
+
+GraphicsEngine::GraphicsEngine(std::string title, int initialWidth, int initialHeight, bool headless)
+    : title(title), headless(headless) {
+    // no display needed; the null platform still hands out EGL/OSMesa contexts
+    if (headless)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
     if (!glfwInit()) {
         fprintf(stderr, "GLFW init failed\n");
         exit(EXIT_FAILURE);
@@ -23,8 +44,17 @@ GraphicsEngine::GraphicsEngine(std::string title, int initialWidth, int initialH
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    }
 
     window = glfwCreateWindow(initialWidth, initialHeight, title.c_str(), NULL, NULL);
+    if (!window && headless) {
+        // software Mesa without EGL
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        window = glfwCreateWindow(initialWidth, initialHeight, title.c_str(), NULL, NULL);
+    }
     if (!window) {
         fprintf(stderr, "Failed to create GLFW window\n");
         glfwTerminate();
@@ -42,7 +72,32 @@ GraphicsEngine::GraphicsEngine(std::string title, int initialWidth, int initialH
     }
     printf("OpenGL %s\n", glGetString(GL_VERSION));
     
-    shaders["basic"] = std::make_unique<Shader>("basic.vert", "basic.frag");
+    // the depth mode picks the shader permutations, so it comes first
+    setupDepth();
+    std::string defines = depthMode == DepthMode::Logarithmic ? "#define LOG_DEPTH\n" : "";
+    shaders["basic"] = std::make_unique<Shader>("basic.vert", "basic.frag", defines);
+    shaders["trail"] = std::make_unique<Shader>("trail.vert", "trail.frag", defines);
+    shaders["vt_feedback"] = std::make_unique<Shader>("basic.vert", "vt_feedback.frag", defines);
+    shaders["stars"] = std::make_unique<Shader>("stars.vert", "stars.frag", defines);
+    if (depthMode == DepthMode::Logarithmic) {
+        for (auto& [name, shader] : shaders) {
+            glUseProgram(shader->ID);
+            shader->setFloat("logDepthCoef", 2.0f / log2f(LOG_DEPTH_FAR + 1.0f));
+        }
+        glUseProgram(0);
+    }
+    sphereLODCache = std::make_unique<SphereLODCache>();
+    sphereLODCache->buildAll();
+    meshRegistry = std::make_unique<MeshRegistry>();
+    textureStreamer = std::make_unique<TextureStreamer>();
+    virtualTextures = std::make_unique<VirtualTextureSystem>();
+    virtualTextures->configureShader(*shaders["basic"]);
+    virtualTextures->configureShader(*shaders["vt_feedback"]);
+    workers = std::make_unique<ThreadPool>();
+    orbitTrails = std::make_unique<OrbitTrails>();
+    starField = std::make_unique<StarField>();
+    if (std::filesystem::exists(STAR_CATALOG))
+        starField->load(STAR_CATALOG);
 
     int fbWidth, fbHeight;
     glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
@@ -56,31 +111,179 @@ GraphicsEngine::~GraphicsEngine() {
     cleanup();
 }
 
+void GraphicsEngine::setupDepth() {
+    // reversed-Z needs [0, 1] clip depth; otherwise the LOG_DEPTH shaders write log depth
+    if (GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_clip_control) {
+        depthMode = DepthMode::ReversedZ;
+        glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glDepthFunc(GL_GREATER);
+        glClearDepth(0.0);
+    } else {
+        depthMode = DepthMode::Logarithmic;
+    }
+    printf("Depth mode: %s\n", depthMode == DepthMode::ReversedZ ? "reversed-Z" : "logarithmic");
+}
+
 void GraphicsEngine::addRenderable(int id, Renderable* r) {
-    renderables.emplace(id, r);
+    if (renderableIndex.count(id)) return;
+    r->setInstanceSlot(instances.allocate());
+    renderableIndex.emplace(id, renderables.size());
+    renderables.push_back(r);
+    renderableIDs.push_back(id);
 }
 
 void GraphicsEngine::removeRenderable(int id) {
-    renderables.erase(id);
+    auto it = renderableIndex.find(id);
+    if (it == renderableIndex.end()) return;
+    size_t index = it->second;
+    instances.release(renderables[index]->getInstanceSlot());
+
+    // swap-remove, then fix the index of the renderable that moved
+    size_t last = renderables.size() - 1;
+    if (index != last) {
+        renderables[index] = renderables[last];
+        renderableIDs[index] = renderableIDs[last];
+        renderableIndex[renderableIDs[index]] = index;
+    }
+    renderables.pop_back();
+    renderableIDs.pop_back();
+    renderableIndex.erase(id);
 }
 
 void GraphicsEngine::clear() {
+    for (Renderable* r : renderables)
+        instances.release(r->getInstanceSlot());
     renderables.clear();
+    renderableIDs.clear();
+    renderableIndex.clear();
+}
+
+// renderables per prepare chunk; smaller scenes stay on the calling thread
+constexpr size_t PREPARE_GRAIN = 2048;
+
+void GraphicsEngine::setSunPosition(const glm::dvec3& realPosition) {
+    sunPosition = realPosition;
 }
 
 void GraphicsEngine::renderScene(const Camera& cam) {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    for (auto& [id, r] : renderables) {
-        r->draw(cam.view, cam.projection);
+    glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
+    {
+        PROFILE_SCOPE("textures");
+        textureStreamer->update();
+        virtualTextures->update();
     }
-};
+    prepareScene(cam);
+    submitScene(cam);
+}
+
+void GraphicsEngine::prepareScene(const Camera& cam) {
+    PROFILE_SCOPE("cull/prepare");
+    Frustum frustum = Frustum::fromMatrix(cam.projection * cam.view);
+    size_t chunkCount = workers->chunkCount(renderables.size(), PREPARE_GRAIN);
+    if (prepareChunks.size() < chunkCount)
+        prepareChunks.resize(chunkCount);
+
+    workers->parallelFor(renderables.size(), PREPARE_GRAIN, [&](size_t begin, size_t end, size_t chunkIndex) {
+        PrepareChunk& chunk = prepareChunks[chunkIndex];
+
+        // gather camera-relative bounding spheres into the culler's contiguous arrays
+        chunk.culler.clear();
+        for (size_t i = begin; i < end; ++i) {
+            Renderable* r = renderables[i];
+            const glm::mat4& model = r->getModel();
+            float scale = glm::max(glm::length(glm::vec3(model[0])),
+                          glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+            chunk.culler.addSphere(instances.get(r->getInstanceSlot()), r->getBoundingRadius() * scale);
+        }
+        chunk.culled = (int) chunk.culler.cull(frustum);
+
+        // only survivors submit packets
+        chunk.queue.clear();
+        for (size_t i = begin; i < end; ++i) {
+            if (chunk.culler.isVisible(i - begin))
+                renderables[i]->submit(chunk.queue, cam.view, cam.projection);
+        }
+    });
+
+    stats.culled = 0;
+    for (size_t c = 0; c < chunkCount; ++c)
+        stats.culled += prepareChunks[c].culled;
+    stats.drawn = (int) renderables.size() - stats.culled;
+    preparedChunkCount = chunkCount;
+}
+
+void GraphicsEngine::submitScene(const Camera& cam) {
+    PROFILE_SCOPE("submit");
+    Profiler& profiler = Profiler::get();
+    instances.upload();
+
+    // merge per-chunk command lists, sort by state, replay
+    renderQueue.clear();
+    for (size_t c = 0; c < preparedChunkCount; ++c)
+        renderQueue.append(prepareChunks[c].queue);
+    renderQueue.sort();
+
+    // tile requests for next frame, into its own small target
+    profiler.beginGPU("vt feedback");
+    virtualTextures->renderFeedback(renderQueue, *shaders["vt_feedback"], cam.view, cam.projection,
+                                    instances, viewportWidth, viewportHeight);
+    profiler.endGPU();
+
+    if (usesSceneTarget()) {
+        sceneTarget.resize(viewportWidth, viewportHeight);
+        sceneTarget.bind();
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    profiler.beginGPU("stars");
+    starField->draw(cam, *shaders["stars"]);
+    profiler.endGPU();
+    // camera-relative like every instance offset
+    glUseProgram(shaders["basic"]->ID);
+    shaders["basic"]->setVec3("sunPosition", toRender(sunPosition - cam.realPosition));
+    profiler.beginGPU("scene");
+    stats.binds = renderQueue.execute(cam.view, cam.projection, instances);
+    profiler.endGPU();
+    profiler.beginGPU("trails");
+    orbitTrails->draw(cam, *shaders["trail"]);
+    profiler.endGPU();
+
+    if (headless)
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    else if (usesSceneTarget())
+        sceneTarget.blitToDefault();
+}
+
+bool GraphicsEngine::usesSceneTarget() const {
+    return headless || depthMode == DepthMode::ReversedZ;
+}
+
+void GraphicsEngine::startCapture(const std::string& outputDir, CaptureFormat format) {
+    frameCapture = std::make_unique<FrameCapture>(outputDir, format);
+}
+
+void GraphicsEngine::stopCapture() {
+    frameCapture.reset();
+}
 
 void GraphicsEngine::finishRender() {
+    if (frameCapture && usesSceneTarget())
+        frameCapture->capture(sceneTarget);
     glfwPollEvents();
-    glfwSwapBuffers(window);
+    if (!headless)
+        glfwSwapBuffers(window);
 }
 
 void GraphicsEngine::cleanup() {
+    stopCapture();
+    if (sphereLODCache) sphereLODCache->cleanup();
+    if (meshRegistry) meshRegistry->cleanup();
+    if (textureStreamer) textureStreamer->cleanup();
+    if (virtualTextures) virtualTextures->cleanup();
+    if (orbitTrails) orbitTrails->cleanup();
+    if (starField) starField->cleanup();
+    workers.reset();
+    instances.cleanup();
+    sceneTarget.cleanup();
     glfwDestroyWindow(window);
     glfwTerminate();
 }
@@ -93,6 +296,46 @@ Shader* GraphicsEngine::getShader(const std::string& name) {
     return it->second.get();
 }
 
+SphereLODCache* GraphicsEngine::getSphereLODCache() {
+    return sphereLODCache.get();
+}
+
+MeshRegistry* GraphicsEngine::getMeshRegistry() {
+    return meshRegistry.get();
+}
+
+TextureStreamer* GraphicsEngine::getTextureStreamer() {
+    return textureStreamer.get();
+}
+
+VirtualTextureSystem* GraphicsEngine::getVirtualTextures() {
+    return virtualTextures.get();
+}
+
+InstanceBuffer& GraphicsEngine::getInstanceBuffer() {
+    return instances;
+}
+
+OrbitTrails* GraphicsEngine::getOrbitTrails() {
+    return orbitTrails.get();
+}
+
+StarField* GraphicsEngine::getStarField() {
+    return starField.get();
+}
+
+DepthMode GraphicsEngine::getDepthMode() const {
+    return depthMode;
+}
+
+int GraphicsEngine::getViewportHeight() const {
+    return viewportHeight;
+}
+
+const RenderStats& GraphicsEngine::getStats() const {
+    return stats;
+}
+
 void GraphicsEngine::handleError(int error, const char* description) {
     fprintf(stderr, "Graphics Engine Error %d: %s\n", error, description);
 }
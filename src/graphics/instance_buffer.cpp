@@ -0,0 +1,72 @@
+#include "graphics/instance_buffer.h"
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+InstanceBuffer::InstanceBuffer() {}
+
+InstanceBuffer::~InstanceBuffer() {
+    cleanup();
+}
+
+int InstanceBuffer::allocate() {
+    if (!freeSlots.empty()) {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    offsets.push_back(glm::vec3(0.0f));
+    return (int) offsets.size() - 1;
+}
+
+void InstanceBuffer::release(int slot) {
+    if (slot < 0) return;
+    offsets[slot] = glm::vec3(0.0f);
+    freeSlots.push_back(slot);
+}
+
+glm::vec3* InstanceBuffer::data() {
+    return offsets.data();
+}
+
+const glm::vec3& InstanceBuffer::get(int slot) const {
+    return offsets[slot];
+}
+
+size_t InstanceBuffer::size() const {
+    return offsets.size();
+}
+
+void InstanceBuffer::upload() {
+    if (offsets.empty()) return;
+    if (VBO == 0) glGenBuffers(1, &VBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    size_t bytes = offsets.size() * sizeof(glm::vec3);
+    if (offsets.size() > gpuCapacity) {
+        gpuCapacity = offsets.size();
+        glBufferData(GL_ARRAY_BUFFER, bytes, offsets.data(), GL_STREAM_DRAW);
+    } else {
+        // orphan the old storage so the driver doesn't sync on last frame's draws
+        glBufferData(GL_ARRAY_BUFFER, gpuCapacity * sizeof(glm::vec3), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, offsets.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::bindAttribute(int slot) const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(OFFSET_ATTRIB, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 
+                          (void*)(slot * sizeof(glm::vec3)));
+    glVertexAttribDivisor(OFFSET_ATTRIB, 1);
+    glEnableVertexAttribArray(OFFSET_ATTRIB);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::cleanup() {
+    if (VBO == 0) return;
+    glDeleteBuffers(1, &VBO);
+    VBO = 0;
+    gpuCapacity = 0;
+}
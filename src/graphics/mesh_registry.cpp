@@ -0,0 +1,115 @@
+#include "graphics/mesh_registry.h"
+#include "graphics/vertex_format.h"
+#include "opengl_includes.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+MeshRegistry::MeshRegistry() {}
+
+MeshRegistry::~MeshRegistry() {
+    cleanup();
+}
+
+bool MeshRegistry::valid(int handle) const {
+    return handle >= 0 && handle < (int) entries.size() && entries[handle].refCount > 0;
+}
+
+// the same geometry packed in two formats is two different meshes
+static std::string residentKey(const std::string& key, VertexFormat format) {
+    return key + '#' + std::to_string(int(format));
+}
+
+int MeshRegistry::acquire(const std::string& key, const MeshBuilder& build, VertexFormat format) {
+    std::string resident = residentKey(key, format);
+    auto it = handleByKey.find(resident);
+    if (it != handleByKey.end()) {
+        entries[it->second].refCount++;
+        return it->second;
+    }
+
+    // scoped so the CPU copy is gone as soon as the GPU has it
+    std::vector<uint8_t> packed;
+    std::vector<uint32_t> indices;
+    {
+        std::vector<Vertex> vertices;
+        build(vertices, indices);
+        if (vertices.empty() || indices.empty()) {
+            fprintf(stderr, "Mesh '%s' has no geometry\n", key.c_str());
+            return INVALID_HANDLE;
+        }
+        packed = packVertices(vertices, format);
+    }
+
+    int handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = (int) entries.size();
+        entries.emplace_back();
+    }
+
+    Entry& e = entries[handle];
+    e.key = resident;
+    e.indexCount = static_cast<GLsizei>(indices.size());
+    e.refCount = 1;
+
+    glGenVertexArrays(1, &e.VAO);
+    glGenBuffers(1, &e.VBO);
+    glGenBuffers(1, &e.EBO);
+
+    glBindVertexArray(e.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, e.VBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t),
+                 indices.data(), GL_STATIC_DRAW);
+
+    applyVertexFormat(format);
+
+    glBindVertexArray(0);
+
+    handleByKey.emplace(resident, handle);
+    return handle;
+}
+
+void MeshRegistry::release(int handle) {
+    if (!valid(handle)) return;
+    Entry& e = entries[handle];
+    if (--e.refCount > 0) return;
+
+    glDeleteVertexArrays(1, &e.VAO);
+    glDeleteBuffers(1, &e.VBO);
+    glDeleteBuffers(1, &e.EBO);
+    handleByKey.erase(e.key);
+    e = Entry();
+    freeHandles.push_back(handle);
+}
+
+GLuint MeshRegistry::getVAO(int handle) const {
+    return valid(handle) ? entries[handle].VAO : 0;
+}
+
+GLsizei MeshRegistry::getIndexCount(int handle) const {
+    return valid(handle) ? entries[handle].indexCount : 0;
+}
+
+size_t MeshRegistry::size() const {
+    return handleByKey.size();
+}
+
+void MeshRegistry::cleanup() {
+    for (Entry& e : entries) {
+        if (e.refCount <= 0) continue;
+        glDeleteVertexArrays(1, &e.VAO);
+        glDeleteBuffers(1, &e.VBO);
+        glDeleteBuffers(1, &e.EBO);
+    }
+    entries.clear();
+    freeHandles.clear();
+    handleByKey.clear();
+}
@@ -0,0 +1,270 @@
+#include "graphics/orbit_trails.h"
+#include "opengl_includes.h"
+#include "graphics/shader.h"
+#include "graphics/camera.h"
+#include "utils.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+OrbitTrails::OrbitTrails(uint32_t samplesPerBody)
+    : samplesPerBody(samplesPerBody) {
+    persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+OrbitTrails::~OrbitTrails() {
+    cleanup();
+}
+
+void OrbitTrails::allocate(int slots) {
+    GLsizeiptr bytes = GLsizeiptr(slots) * 2 * samplesPerBody * sizeof(glm::vec3);
+    GLuint newVBO;
+    glGenBuffers(1, &newVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, newVBO);
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // carry existing trails over once the GPU is done with the old buffer
+    if (VBO != 0) {
+        glFinish();
+        if (mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            mapped = nullptr;
+        }
+        GLsizeiptr oldBytes = GLsizeiptr(slotCapacity) * 2 * samplesPerBody * sizeof(glm::vec3);
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        glDeleteBuffers(1, &VBO);
+    }
+    VBO = newVBO;
+
+    if (persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        mapped = (glm::vec3*) glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+
+    // one anchor per slot, fetched by the vertex shader
+    if (anchorBuffer == 0) glGenBuffers(1, &anchorBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, anchorBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(slots) * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    if (anchorTexture == 0) glGenTextures(1, &anchorTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, anchorTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, anchorBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    anchors.resize(slots, glm::vec4(0.0f));
+
+    if (VAO == 0) glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (int s = slotCapacity; s < slots; ++s)
+        freeSlots.push_back(s);
+    slotCapacity = slots;
+}
+
+void OrbitTrails::addTrail(int id) {
+    if (trails.count(id)) return;
+    if (freeSlots.empty())
+        allocate(std::max(8, slotCapacity * 2));
+
+    Trail trail;
+    trail.samples.resize(samplesPerBody);
+    trail.slot = freeSlots.back();
+    freeSlots.pop_back();
+    trails.emplace(id, trail);
+}
+
+void OrbitTrails::removeTrail(int id) {
+    auto it = trails.find(id);
+    if (it == trails.end()) return;
+    freeSlots.push_back(it->second.slot);
+    trails.erase(it);
+}
+
+void OrbitTrails::clear() {
+    for (auto& [id, trail] : trails)
+        freeSlots.push_back(trail.slot);
+    trails.clear();
+}
+
+void OrbitTrails::waitForFrame() {
+    if (frameWaited) return;
+    frameWaited = true;
+
+    // the oldest in-flight frame may still read slots we are about to overwrite
+    GLsync& fence = fences[frameIndex];
+    if (!fence) return;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void OrbitTrails::waitForAllFrames() {
+    for (GLsync& fence : fences) {
+        if (!fence) continue;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    frameWaited = true;
+}
+
+void OrbitTrails::write(const Trail& trail, const glm::dvec3& real) {
+    size_t base = size_t(trail.slot) * 2 * samplesPerBody;
+    size_t i0 = base + trail.head;
+    size_t i1 = i0 + samplesPerBody;
+    glm::vec3 p = toRender(real - trail.anchor);
+
+    if (mapped) {
+        mapped[i0] = p;
+        mapped[i1] = p;
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, i0 * sizeof(glm::vec3), sizeof(glm::vec3), glm::value_ptr(p));
+        glBufferSubData(GL_ARRAY_BUFFER, i1 * sizeof(glm::vec3), sizeof(glm::vec3), glm::value_ptr(p));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void OrbitTrails::rebase(Trail& trail, const glm::dvec3& anchor) {
+    trail.anchor = anchor;
+    std::vector<glm::vec3> segment(2 * samplesPerBody);
+    for (uint32_t i = 0; i < samplesPerBody; ++i)
+        segment[i] = segment[i + samplesPerBody] = toRender(trail.samples[i] - anchor);
+
+    // every stored sample changes, including ones frames in flight still draw
+    size_t base = size_t(trail.slot) * 2 * samplesPerBody;
+    if (mapped) {
+        waitForAllFrames();
+        std::copy(segment.begin(), segment.end(), mapped + base);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, base * sizeof(glm::vec3), segment.size() * sizeof(glm::vec3), segment.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void OrbitTrails::push(int id, const glm::dvec3& p) {
+    auto it = trails.find(id);
+    if (it == trails.end()) return;
+    Trail& trail = it->second;
+
+    // keep a sample only once the path has turned enough since the last kept one
+    if (decimate && trail.count >= 2 && trail.skipped < maxSkipped) {
+        glm::dvec3 d1 = trail.last - trail.prev;
+        glm::dvec3 d2 = p - trail.last;
+        double l1 = glm::length(d1), l2 = glm::length(d2);
+        if (l2 < 1.0) return;
+        if (l1 > 1.0 && glm::dot(d1, d2) / (l1 * l2) > std::cos(minTurnAngle)) {
+            ++trail.skipped;
+            return;
+        }
+    }
+
+    if (persistent) waitForFrame();
+    trail.samples[trail.head] = p;
+    if (trail.count == 0)
+        trail.anchor = p;
+    if (toRender(glm::length(p - trail.anchor)) > REBASE_DISTANCE)
+        rebase(trail, p);
+    else
+        write(trail, p);
+    trail.head = (trail.head + 1) % samplesPerBody;
+    trail.count = std::min(trail.count + 1, samplesPerBody);
+    trail.prev = trail.last;
+    trail.last = p;
+    trail.skipped = 0;
+}
+
+void OrbitTrails::draw(const Camera& cam, const Shader& shader) {
+    if (trails.empty() || VAO == 0) return;
+
+    // newest samples only; the oldest FRAMES_IN_FLIGHT slots may be rewritten
+    // while earlier frames are still in flight
+    uint32_t maxCount = samplesPerBody - FRAMES_IN_FLIGHT;
+    drawFirsts.clear();
+    drawCounts.clear();
+    for (auto& [id, trail] : trails) {
+        uint32_t count = std::min(trail.count, maxCount);
+        if (count < 2) continue;
+        uint32_t start = (trail.head + samplesPerBody - count) % samplesPerBody;
+        // camera-relative in double, so only small offsets reach the GPU
+        anchors[trail.slot] = glm::vec4(toRender(trail.anchor - cam.realPosition), 0.0f);
+        drawFirsts.push_back(GLint(size_t(trail.slot) * 2 * samplesPerBody + start));
+        drawCounts.push_back(GLsizei(count));
+    }
+
+    if (!drawCounts.empty()) {
+        glUseProgram(shader.ID);
+        shader.setMat4("view", cam.view);
+        shader.setMat4("projection", cam.projection);
+        shader.setInt("anchors", 0);
+        shader.setInt("slotSize", int(2 * samplesPerBody));
+        shader.setVec3("trailColor", glm::vec3(0.4f, 0.6f, 0.9f));
+
+        glBindBuffer(GL_TEXTURE_BUFFER, anchorBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, anchors.size() * sizeof(glm::vec4), anchors.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, anchorTexture);
+
+        glBindVertexArray(VAO);
+        glMultiDrawArrays(GL_LINE_STRIP, drawFirsts.data(), drawCounts.data(), (GLsizei) drawCounts.size());
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    if (persistent) {
+        if (fences[frameIndex]) glDeleteSync(fences[frameIndex]);
+        fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frameIndex = (frameIndex + 1) % FRAMES_IN_FLIGHT;
+    }
+    frameWaited = false;
+}
+
+void OrbitTrails::cleanup() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (VBO != 0) {
+        if (mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            mapped = nullptr;
+        }
+        glDeleteBuffers(1, &VBO);
+        VBO = 0;
+    }
+    if (anchorTexture != 0) {
+        glDeleteTextures(1, &anchorTexture);
+        anchorTexture = 0;
+    }
+    if (anchorBuffer != 0) {
+        glDeleteBuffers(1, &anchorBuffer);
+        anchorBuffer = 0;
+    }
+    if (VAO != 0) {
+        glDeleteVertexArrays(1, &VAO);
+        VAO = 0;
+    }
+    anchors.clear();
+    trails.clear();
+    freeSlots.clear();
+    slotCapacity = 0;
+}
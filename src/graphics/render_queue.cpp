@@ -0,0 +1,182 @@
+#include "graphics/render_queue.h"
+#include "graphics/instance_buffer.h"
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+// depth range (render units) spread over the 16 depth bits, log-spaced
+constexpr float SORT_DEPTH_FAR = 1e16f;
+
+uint64_t RenderQueue::makeKey(RenderPass pass, GLuint program, uint32_t material, GLuint mesh, float viewDepth) {
+    float d = log2f(1.0f + glm::max(viewDepth, 0.0f)) / log2f(1.0f + SORT_DEPTH_FAR);
+    uint64_t depth = (uint64_t) (glm::clamp(d, 0.0f, 1.0f) * 65535.0f);
+    // opaque front-to-back for early-z; transparent back-to-front
+    if (pass == RenderPass::Transparent) depth = 65535 - depth;
+
+    return ((uint64_t) pass & 0xF) << 60
+         | ((uint64_t) program & 0xFFF) << 48
+         | ((uint64_t) material & 0xFFFF) << 32
+         | ((uint64_t) mesh & 0xFFFF) << 16
+         | depth;
+}
+
+uint32_t RenderQueue::colorMaterial(const glm::vec3& color) {
+    glm::vec3 c = glm::clamp(color, 0.0f, 1.0f);
+    return uint32_t(c.x * 31.0f) << 11 | uint32_t(c.y * 63.0f) << 5 | uint32_t(c.z * 31.0f);
+}
+
+uint32_t RenderQueue::textureMaterial(GLuint texture) {
+    return texture & 0xFFFF;
+}
+
+void RenderQueue::clear() {
+    packets.clear();
+}
+
+void RenderQueue::submit(const DrawPacket& packet) {
+    packets.push_back(packet);
+}
+
+void RenderQueue::append(const RenderQueue& other) {
+    packets.insert(packets.end(), other.packets.begin(), other.packets.end());
+}
+
+// LSD radix sort of (key, index) pairs, 8 bits per pass;
+// passes where every key shares the same byte are skipped
+void RenderQueue::sort() {
+    size_t n = packets.size();
+    keys.resize(n);
+    order.resize(n);
+    keysScratch.resize(n);
+    orderScratch.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = packets[i].key;
+        order[i] = (uint32_t) i;
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (size_t i = 0; i < n; ++i)
+            ++counts[(keys[i] >> shift) & 0xFF];
+        if (n == 0 || counts[(keys[0] >> shift) & 0xFF] == n) continue;
+
+        size_t offset = 0;
+        for (size_t& c : counts) {
+            size_t count = c;
+            c = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t dst = counts[(keys[i] >> shift) & 0xFF]++;
+            keysScratch[dst] = keys[i];
+            orderScratch[dst] = order[i];
+        }
+        keys.swap(keysScratch);
+        order.swap(orderScratch);
+    }
+}
+
+const RenderQueue::ProgramUniforms& RenderQueue::uniformsFor(GLuint program) {
+    for (const ProgramUniforms& u : uniformCache)
+        if (u.program == program) return u;
+    uniformCache.push_back({
+        program,
+        glGetUniformLocation(program, "model"),
+        glGetUniformLocation(program, "view"),
+        glGetUniformLocation(program, "projection"),
+        glGetUniformLocation(program, "objectColor"),
+        glGetUniformLocation(program, "useTexture"),
+        glGetUniformLocation(program, "useVirtualTexture"),
+        glGetUniformLocation(program, "sunVisibility"),
+        glGetUniformLocation(program, "emissive")
+    });
+    return uniformCache.back();
+}
+
+int RenderQueue::execute(const glm::mat4& view, const glm::mat4& projection, const InstanceBuffer& instances) {
+    GLuint boundProgram = 0, boundVAO = 0;
+    const glm::mat4* boundModel = nullptr;
+    glm::vec3 boundColor(-1.0f);
+    GLuint boundTexture = ~0u, boundPageTable = ~0u;
+    float boundVisibility = -1.0f;
+    int boundEmissive = -1;
+    int boundSlot = -1;
+    const ProgramUniforms* u = nullptr;
+    int binds = 0;
+
+    for (uint32_t index : order) {
+        const DrawPacket& p = packets[index];
+        if (p.program != boundProgram) {
+            glUseProgram(p.program);
+            u = &uniformsFor(p.program);
+            glUniformMatrix4fv(u->view, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(u->projection, 1, GL_FALSE, glm::value_ptr(projection));
+            boundProgram = p.program;
+            boundModel = nullptr;
+            boundColor = glm::vec3(-1.0f);
+            boundTexture = ~0u;
+            boundPageTable = ~0u;
+            boundVisibility = -1.0f;
+            boundEmissive = -1;
+            ++binds;
+        }
+        if (p.VAO != boundVAO) {
+            glBindVertexArray(p.VAO);
+            boundVAO = p.VAO;
+            boundSlot = -1; // the instance attribute is VAO state
+            ++binds;
+        }
+        if (p.model != boundModel) {
+            glUniformMatrix4fv(u->model, 1, GL_FALSE, glm::value_ptr(*p.model));
+            boundModel = p.model;
+        }
+        if (p.color != boundColor) {
+            glUniform3f(u->color, p.color.x, p.color.y, p.color.z);
+            boundColor = p.color;
+        }
+        if (p.texture != boundTexture) {
+            if (p.texture) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, p.texture);
+            }
+            glUniform1i(u->useTexture, p.texture != 0);
+            boundTexture = p.texture;
+        }
+        if (p.pageTable != boundPageTable) {
+            if (p.pageTable) {
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, p.pageTable);
+                glActiveTexture(GL_TEXTURE0);
+            }
+            glUniform1i(u->useVirtualTexture, p.pageTable != 0);
+            boundPageTable = p.pageTable;
+        }
+        if (p.sunVisibility != boundVisibility) {
+            glUniform1f(u->sunVisibility, p.sunVisibility);
+            boundVisibility = p.sunVisibility;
+        }
+        if (int(p.emissive) != boundEmissive) {
+            glUniform1i(u->emissive, p.emissive);
+            boundEmissive = p.emissive;
+        }
+        if (p.instanceSlot != boundSlot) {
+            instances.bindAttribute(p.instanceSlot);
+            boundSlot = p.instanceSlot;
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, p.indexCount, GL_UNSIGNED_INT, 0, 1);
+    }
+
+    glBindVertexArray(0);
+    return binds;
+}
+
+size_t RenderQueue::size() const {
+    return packets.size();
+}
+
+const std::vector<DrawPacket>& RenderQueue::getPackets() const {
+    return packets;
+}
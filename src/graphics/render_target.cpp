@@ -0,0 +1,55 @@
+#include "graphics/render_target.h"
+#include "opengl_includes.h"
+#include <cstdio>
+
+RenderTarget::RenderTarget() {}
+
+RenderTarget::~RenderTarget() {
+    cleanup();
+}
+
+void RenderTarget::resize(int w, int h) {
+    if (w <= 0 || h <= 0) return; // minimized
+    if (FBO != 0 && w == width && h == height) return;
+    width = w;
+    height = h;
+
+    if (FBO == 0) {
+        glGenFramebuffers(1, &FBO);
+        glGenRenderbuffers(1, &colorRBO);
+        glGenRenderbuffers(1, &depthRBO);
+    }
+
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Render target %dx%d is incomplete\n", width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+}
+
+void RenderTarget::blitToDefault() const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::cleanup() {
+    if (FBO == 0) return;
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(1, &colorRBO);
+    glDeleteRenderbuffers(1, &depthRBO);
+    FBO = colorRBO = depthRBO = 0;
+    width = height = 0;
+}
@@ -4,54 +4,78 @@
 #include "utils.h"
 #include "opengl_includes.h"
 #include "graphics/shader.h"
+#include "graphics/sphere_lod.h"
+#include "graphics/instance_buffer.h"
+#include "graphics/render_queue.h"
+#include "graphics/vertex_format.h"
+#include "graphics/mesh_registry.h"
+#include "graphics/texture_streamer.h"
+#include "graphics/virtual_texture.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "graphics/stb_image.h"
 #include <vector>
+#include <string>
+#include <iterator>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
 #include <cmath>
 #include <cstdint>
 
-#ifndef offsetof
-#define offsetof(t, d) __builtin_offsetof(t, d)
-#endif
-
 Renderable::Renderable(std::weak_ptr<GraphicsEngine> gEng)
-    : gEng(gEng), VAO(0), VBO(0), EBO(0), model(glm::mat4(1.0f)), indexCount(0), vertices(std::vector<Vertex>()), indices(std::vector<uint32_t>()) {}
+    : gEng(gEng), mesh(MeshRegistry::INVALID_HANDLE), VAO(0), model(glm::mat4(1.0f)), instanceSlot(-1), indexCount(0), texture(TextureStreamer::INVALID_HANDLE), 
+      virtualTexture(VirtualTextureSystem::INVALID_HANDLE), sunVisibility(1.0f), emissive(false) {}
 
 Renderable::~Renderable() {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    // the engine frees every resident mesh itself when it goes first
+    std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
+    if (!lgEng) return;
+    lgEng->getMeshRegistry()->release(mesh);
+    lgEng->getTextureStreamer()->release(texture);
+    lgEng->getVirtualTextures()->release(virtualTexture);
 }
 
-void Renderable::draw(const glm::mat4& view, const glm::mat4& projection) {}
+void Renderable::submit(RenderQueue& queue, const glm::mat4& view, const glm::mat4& projection) {}
 
-void Renderable::setupMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
-    indexCount = static_cast<GLsizei>(indices.size());
+float Renderable::getBoundingRadius() const {
+    return 0.0f;
+}
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+void Renderable::setupMesh(const std::string& key, const MeshBuilder& build, VertexFormat format) {
+    std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
+    if (!lgEng) return;
+    MeshRegistry* registry = lgEng->getMeshRegistry();
+    registry->release(mesh);
+    mesh = registry->acquire(key, build, format);
+    VAO = registry->getVAO(mesh);
+    indexCount = registry->getIndexCount(mesh);
+}
 
-    glBindVertexArray(VAO);
+void Renderable::setTexture(const std::string& path) {
+    std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
+    if (!lgEng) return;
+    TextureStreamer* streamer = lgEng->getTextureStreamer();
+    int previous = texture;
+    texture = streamer->acquire(path);
+    streamer->release(previous);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
-                 vertices.data(), GL_STATIC_DRAW);
+void Renderable::setVirtualTexture(const std::string& dir) {
+    std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
+    if (!lgEng) return;
+    VirtualTextureSystem* system = lgEng->getVirtualTextures();
+    int previous = virtualTexture;
+    virtualTexture = system->acquire(dir);
+    system->release(previous);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t),
-                 indices.data(), GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+GLuint Renderable::residentPageTable() const {
+    std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
+    return lgEng ? lgEng->getVirtualTextures()->getPageTable(virtualTexture) : 0;
+}
 
-    glBindVertexArray(0);
+GLuint Renderable::residentTexture() const {
+    std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
+    return lgEng ? lgEng->getTextureStreamer()->getTexture(texture) : 0;
 }
 
 void Renderable::setModel(const glm::mat4& m) {
@@ -62,9 +86,25 @@ glm::mat4& Renderable::getModel() {
     return model;
 }
 
+void Renderable::setSunVisibility(float visibility) {
+    sunVisibility = visibility;
+}
+
+void Renderable::setEmissive(bool emissive) {
+    this->emissive = emissive;
+}
+
+void Renderable::setInstanceSlot(int slot) {
+    instanceSlot = slot;
+}
+
+int Renderable::getInstanceSlot() const {
+    return instanceSlot;
+}
+
 // CUBE
 
-static const std::vector<Vertex> cubeVertices = {
+static const Vertex cubeVertices[] = {
     { { -0.5f, -0.5f, -0.5f } },
     { {  0.5f, -0.5f, -0.5f } },
     { {  0.5f,  0.5f, -0.5f } },
@@ -75,7 +115,7 @@ static const std::vector<Vertex> cubeVertices = {
     { { -0.5f,  0.5f,  0.5f } }
 };
 
-static const std::vector<uint32_t> cubeIndices = {
+static const uint32_t cubeIndices[] = {
     0,1,2, 2,3,0,
     4,5,6, 6,7,4,
     0,4,7, 7,3,0,
@@ -86,95 +126,54 @@ static const std::vector<uint32_t> cubeIndices = {
 
 Cube::Cube(std::weak_ptr<GraphicsEngine> gEng, glm::vec3 color)
     : Renderable(gEng), color(color) {
-    setupMesh(cubeVertices, cubeIndices);
+    setupMesh("cube", [](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+        vertices.assign(std::begin(cubeVertices), std::end(cubeVertices));
+        indices.assign(std::begin(cubeIndices), std::end(cubeIndices));
+    });
 }
 
-void Cube::draw(const glm::mat4& view, const glm::mat4& projection) {
+void Cube::submit(RenderQueue& queue, const glm::mat4& view, const glm::mat4& projection) {
     std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
     if (!lgEng) return;
     Shader* basicShader = lgEng->getShader("basic");
-    glUseProgram(basicShader->ID);
-    
-    GLint modelLoc = glGetUniformLocation(basicShader->ID, "model");
-    GLint viewLoc  = glGetUniformLocation(basicShader->ID, "view");
-    GLint projLoc  = glGetUniformLocation(basicShader->ID, "projection");
-    GLint colorLoc = glGetUniformLocation(basicShader->ID, "objectColor");
-    
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform3f(colorLoc, color[0], color[1], color[2]);
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+
+    glm::vec3 eyeCenter = glm::vec3(view * glm::vec4(lgEng->getInstanceBuffer().get(instanceSlot), 1.0f));
+    GLuint tex = residentTexture(), pageTable = residentPageTable();
+    uint32_t material = pageTable ? RenderQueue::textureMaterial(pageTable) 
+                      : tex ? RenderQueue::textureMaterial(tex) : RenderQueue::colorMaterial(color);
+    uint64_t key = RenderQueue::makeKey(RenderPass::Opaque, basicShader->ID, material, VAO, glm::length(eyeCenter));
+    queue.submit({ key, basicShader->ID, VAO, indexCount, instanceSlot, &model, color, tex, pageTable, sunVisibility, emissive });
+}
+
+float Cube::getBoundingRadius() const {
+    return 0.8660254f; // half the unit cube diagonal
 }
 
 // SPHERE
 
-// helper to generate sphere vertices/indices
-static void generateSphere(float radius, uint32_t sectorCount, uint32_t stackCount, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
-    float x, y, z, xy;                              // vertex position
-
-    for (int i = 0; i <= stackCount; ++i) {
-        float stackAngle = M_PI / 2 - i * M_PI / stackCount; // from pi/2 to -pi/2
-        xy = radius * cosf(stackAngle);
-        z = radius * sinf(stackAngle);
-
-        for (int j = 0; j <= sectorCount; ++j) {
-            float sectorAngle = j * 2 * M_PI / sectorCount; // 0 to 2pi
-            x = xy * cosf(sectorAngle);
-            y = xy * sinf(sectorAngle);
-            vertices.push_back({ glm::vec3(x, y, z) });
-        }
-    }
-
-    // indices
-    for (int i = 0; i < stackCount; ++i) {
-        int k1 = i * (sectorCount + 1); // beginning of stack
-        int k2 = k1 + sectorCount + 1;  // beginning of next stack
-
-        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
-            if (i != 0) {
-                indices.push_back(k1);
-                indices.push_back(k2);
-                indices.push_back(k1 + 1);
-            }
-
-            if (i != (stackCount - 1)) {
-                indices.push_back(k1 + 1);
-                indices.push_back(k2);
-                indices.push_back(k2 + 1);
-            }
-        }
-    }
-}
-
-Sphere::Sphere(std::weak_ptr<GraphicsEngine> gEng, glm::vec3 color, double realRadius, int sectorCount, int stackCount)
+Sphere::Sphere(std::weak_ptr<GraphicsEngine> gEng, glm::vec3 color, double realRadius)
     : Renderable(gEng), color(color), radius(toRender(realRadius)) {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    generateSphere(radius, sectorCount, stackCount, vertices, indices);
-    setupMesh(vertices, indices);
+    // shared meshes are unit spheres, so the model carries the radius
+    model = glm::scale(glm::mat4(1.0f), glm::vec3(radius));
 }
 
-void Sphere::draw(const glm::mat4& view, const glm::mat4& projection) {
+void Sphere::submit(RenderQueue& queue, const glm::mat4& view, const glm::mat4& projection) {
     std::shared_ptr<GraphicsEngine> lgEng = gEng.lock();
     if (!lgEng) return;
     Shader* basicShader = lgEng->getShader("basic");
-    glUseProgram(basicShader->ID);
-
-    GLint modelLoc = glGetUniformLocation(basicShader->ID, "model");
-    GLint viewLoc  = glGetUniformLocation(basicShader->ID, "view");
-    GLint projLoc  = glGetUniformLocation(basicShader->ID, "projection");
-    GLint colorLoc = glGetUniformLocation(basicShader->ID, "objectColor");
-    
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform3f(colorLoc, color[0], color[1], color[2]);
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+
+    SphereLODCache* lodCache = lgEng->getSphereLODCache();
+    glm::vec3 eyeCenter = glm::vec3(view * glm::vec4(lgEng->getInstanceBuffer().get(instanceSlot), 1.0f));
+    int level = lodCache->selectLevel(radius, eyeCenter, projection, lgEng->getViewportHeight());
+    const SphereMesh& mesh = lodCache->getMesh(level);
+
+    GLuint tex = residentTexture(), pageTable = residentPageTable();
+    uint32_t material = pageTable ? RenderQueue::textureMaterial(pageTable) 
+                      : tex ? RenderQueue::textureMaterial(tex) : RenderQueue::colorMaterial(color);
+    uint64_t key = RenderQueue::makeKey(RenderPass::Opaque, basicShader->ID, material, mesh.VAO, glm::length(eyeCenter));
+    queue.submit({ key, basicShader->ID, mesh.VAO, mesh.indexCount, instanceSlot, &model, color, tex, pageTable, sunVisibility, emissive });
+}
+
+float Sphere::getBoundingRadius() const {
+    return 1.0f; // unit mesh, scaled by model
 }
@@ -7,8 +7,19 @@
 #include <sstream>
 #include <iostream>
 #include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <filesystem>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+// source with defines inserted after its #version line, so permutations share a file
+static std::string withDefines(const std::string& code, const std::string& defines) {
+    if (defines.empty()) return code;
+    size_t line = code.find('\n');
+    if (line == std::string::npos) return code + "\n" + defines;
+    return code.substr(0, line + 1) + defines + code.substr(line + 1);
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines) {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -30,14 +41,25 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         vShaderFile.close();
         fShaderFile.close();
         // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();			
+        vertexCode = withDefines(vShaderStream.str(), defines);
+        fragmentCode = withDefines(fShaderStream.str(), defines);			
     } catch (std::ifstream::failure& e) {
         fprintf(stderr, "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: %s\n", e.what());
     }
+    // 2. try the program binary cache, keyed on both sources and the driver
+    std::string driver = std::string((const char*) glGetString(GL_VENDOR)) + "|" 
+                       + (const char*) glGetString(GL_RENDERER) + "|" 
+                       + (const char*) glGetString(GL_VERSION);
+    uint64_t key = hashSource(vertexCode + '\0' + fragmentCode + '\0' + driver);
+    std::string cacheName = std::string(vertexPath) + "+" + fragmentPath;
+    if (loadCachedBinary(cacheName, key)) {
+        printf("Shader loaded from cache: %d\n", ID);
+        return;
+    }
+
     const char* vShaderCode = vertexCode.c_str();
     const char * fShaderCode = fragmentCode.c_str();
-    // 2. compile shaders
+    // 3. compile shaders
     unsigned int vertex, fragment;
     // vertex shader
     vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -53,16 +75,100 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 
+    // 4. store the linked binary for the next launch
+    storeCachedBinary(cacheName, key);
+
     printf("Shader successfully loaded: %d\n", ID);
 }
 
 Shader::Shader() {}
+
+// program binary cache
+// ------------------------------------------------------------------------
+static const char* SHADER_CACHE_DIR = "shader_cache";
+static const uint32_t SHADER_CACHE_MAGIC = 0x41534843; // "ASHC"
+
+// 64-bit FNV-1a
+uint64_t Shader::hashSource(const std::string& text) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static std::filesystem::path cachePath(const std::string& name, uint64_t key) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) key);
+    return std::filesystem::path(SHADER_CACHE_DIR) / (name + "." + hex + ".bin");
+}
+
+bool Shader::loadCachedBinary(const std::string& name, uint64_t key) {
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0) return false;
+
+    std::ifstream file(cachePath(name, key), std::ios::binary);
+    if (!file) return false;
+
+    uint32_t magic = 0;
+    GLenum format = 0;
+    uint32_t length = 0;
+    file.read((char*) &magic, sizeof(magic));
+    file.read((char*) &format, sizeof(format));
+    file.read((char*) &length, sizeof(length));
+    if (!file || magic != SHADER_CACHE_MAGIC || length == 0) return false;
+    std::vector<char> binary(length);
+    if (!file.read(binary.data(), length)) return false;
+
+    ID = glCreateProgram();
+    glProgramBinary(ID, format, binary.data(), (GLsizei) length);
+    GLint success = 0;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success) {
+        // driver rejected it (e.g. updated in place); fall back to source
+        glDeleteProgram(ID);
+        ID = 0;
+        return false;
+    }
+    return true;
+}
+
+void Shader::storeCachedBinary(const std::string& name, uint64_t key) {
+    GLint formatCount = 0, length = 0, success = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (formatCount == 0 || !success || length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, nullptr, &format, binary.data());
+
+    std::error_code ec;
+    std::filesystem::create_directories(SHADER_CACHE_DIR, ec);
+    // drop stale binaries of this program left by older sources or drivers
+    for (const auto& entry : std::filesystem::directory_iterator(SHADER_CACHE_DIR, ec)) {
+        if (entry.path().filename().string().rfind(name + ".", 0) == 0)
+            std::filesystem::remove(entry.path(), ec);
+    }
+
+    std::ofstream file(cachePath(name, key), std::ios::binary);
+    uint32_t size = (uint32_t) length;
+    file.write((const char*) &SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC));
+    file.write((const char*) &format, sizeof(format));
+    file.write((const char*) &size, sizeof(size));
+    file.write(binary.data(), length);
+    if (!file) fprintf(stderr, "Failed to write shader cache for %s\n", name.c_str());
+}
 Shader::~Shader() {}
 
 // utility uniform functions
@@ -0,0 +1,124 @@
+#include "graphics/sphere_lod.h"
+#include "graphics/vertex_format.h"
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+// helper to generate unit sphere vertices/indices
+static void generateSphere(uint32_t sectorCount, uint32_t stackCount, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    float x, y, z, xy;                              // vertex position
+
+    for (int i = 0; i <= stackCount; ++i) {
+        float stackAngle = M_PI / 2 - i * M_PI / stackCount; // from pi/2 to -pi/2
+        xy = cosf(stackAngle);
+        z = sinf(stackAngle);
+
+        for (int j = 0; j <= sectorCount; ++j) {
+            float sectorAngle = j * 2 * M_PI / sectorCount; // 0 to 2pi
+            x = xy * cosf(sectorAngle);
+            y = xy * sinf(sectorAngle);
+            // unit sphere: normal equals position
+            glm::vec3 p(x, y, z);
+            vertices.push_back({ p, p, glm::vec2((float)j / sectorCount, (float)i / stackCount) });
+        }
+    }
+
+    // indices
+    for (int i = 0; i < stackCount; ++i) {
+        int k1 = i * (sectorCount + 1); // beginning of stack
+        int k2 = k1 + sectorCount + 1;  // beginning of next stack
+
+        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
+            if (i != 0) {
+                indices.push_back(k1);
+                indices.push_back(k2);
+                indices.push_back(k1 + 1);
+            }
+
+            if (i != (stackCount - 1)) {
+                indices.push_back(k1 + 1);
+                indices.push_back(k2);
+                indices.push_back(k2 + 1);
+            }
+        }
+    }
+}
+
+SphereLODCache::SphereLODCache() {}
+
+SphereLODCache::~SphereLODCache() {
+    cleanup();
+}
+
+int SphereLODCache::selectLevel(float radius, const glm::vec3& eyeCenter, const glm::mat4& projection, int viewportHeight) const {
+    // eye-space distance to the sphere centre
+    float dist = glm::length(eyeCenter);
+    if (dist <= radius) 
+        return LEVEL_COUNT - 1;
+
+    // projected radius in px; projection[1][1] = cot(fovy / 2)
+    float pixelRadius = radius / sqrtf(dist * dist - radius * radius) 
+                        * projection[1][1] * 0.5f * viewportHeight;
+
+    // max chord deviation of an n-sector ring is r * (1 - cos(pi / n))
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        float error = pixelRadius * (1.0f - cosf(M_PI / SECTOR_COUNTS[level]));
+        if (error <= maxPixelError)
+            return level;
+    }
+    return LEVEL_COUNT - 1;
+}
+
+const SphereMesh& SphereLODCache::getMesh(int level) {
+    level = glm::clamp(level, 0, LEVEL_COUNT - 1);
+    if (meshes[level].VAO == 0)
+        build(level);
+    return meshes[level];
+}
+
+void SphereLODCache::buildAll() {
+    for (int level = 0; level < LEVEL_COUNT; ++level)
+        getMesh(level);
+}
+
+void SphereLODCache::build(int level) {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    uint32_t sectorCount = SECTOR_COUNTS[level];
+    generateSphere(sectorCount, sectorCount / 2, vertices, indices);
+
+    SphereMesh& mesh = meshes[level];
+    mesh.indexCount = static_cast<GLsizei>(indices.size());
+
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+    glGenBuffers(1, &mesh.EBO);
+
+    glBindVertexArray(mesh.VAO);
+
+    // unit sphere fits snorm16 exactly, so the quantized layout loses nothing visible
+    std::vector<uint8_t> packed = packVertices(vertices, VertexFormat::CompactQuantized);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t),
+                 indices.data(), GL_STATIC_DRAW);
+
+    applyVertexFormat(VertexFormat::CompactQuantized);
+
+    glBindVertexArray(0);
+}
+
+void SphereLODCache::cleanup() {
+    for (SphereMesh& mesh : meshes) {
+        if (mesh.VAO == 0) continue;
+        glDeleteVertexArrays(1, &mesh.VAO);
+        glDeleteBuffers(1, &mesh.VBO);
+        glDeleteBuffers(1, &mesh.EBO);
+        mesh = SphereMesh();
+    }
+}
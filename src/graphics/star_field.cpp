@@ -0,0 +1,202 @@
+#include "graphics/star_field.h"
+#include "graphics/camera.h"
+#include "graphics/shader.h"
+#include "mapped_file.h"
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+static const uint32_t STAR_CATALOG_MAGIC = 0x53545341; // "ASTS"
+static const uint32_t STAR_CATALOG_VERSION = 1;
+static const double OBLIQUITY = 23.4392911 * M_PI / 180.0; // J2000
+
+struct StarCatalogHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t recordSize;
+};
+
+static_assert(sizeof(StarRecord) == 12, "StarRecord must stay tightly packed");
+
+StarField::StarField() {}
+
+StarField::~StarField() {
+    cleanup();
+}
+
+// ---------------- Conversion ----------------
+
+static std::vector<std::string> splitCSV(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') quoted = !quoted;
+        else if (c == ',' && !quoted) {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') field += c;
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+// B-V index -> blackbody temperature (Ballesteros) -> approximate sRGB
+static void colorFromBV(double bv, uint8_t* rgb) {
+    bv = glm::clamp(bv, -0.4, 2.0);
+    double t = 4600.0 * (1.0 / (0.92 * bv + 1.7) + 1.0 / (0.92 * bv + 0.62)) / 100.0;
+    double r, g, b;
+    if (t <= 66.0) {
+        r = 255.0;
+        g = 99.4708025861 * log(t) - 161.1195681661;
+        b = t <= 19.0 ? 0.0 : 138.5177312231 * log(t - 10.0) - 305.0447927307;
+    } else {
+        r = 329.698727446 * pow(t - 60.0, -0.1332047592);
+        g = 288.1221695283 * pow(t - 60.0, -0.0755148492);
+        b = 255.0;
+    }
+    rgb[0] = (uint8_t) glm::clamp(r, 0.0, 255.0);
+    rgb[1] = (uint8_t) glm::clamp(g, 0.0, 255.0);
+    rgb[2] = (uint8_t) glm::clamp(b, 0.0, 255.0);
+}
+
+bool StarField::convertCatalog(const std::string& csvPath, const std::string& outPath) {
+    std::ifstream in(csvPath);
+    std::string line;
+    if (!in || !std::getline(in, line)) {
+        fprintf(stderr, "Failed to read star catalog %s\n", csvPath.c_str());
+        return false;
+    }
+
+    std::vector<std::string> header = splitCSV(line);
+    auto column = [&header](const char* name) {
+        auto it = std::find(header.begin(), header.end(), name);
+        return it == header.end() ? -1 : (int) (it - header.begin());
+    };
+    int raCol = column("ra"), decCol = column("dec"), magCol = column("mag"), ciCol = column("ci");
+    if (raCol < 0 || decCol < 0 || magCol < 0) {
+        fprintf(stderr, "Star catalog %s needs ra, dec and mag columns\n", csvPath.c_str());
+        return false;
+    }
+
+    std::ofstream out(outPath, std::ios::binary);
+    StarCatalogHeader h = { STAR_CATALOG_MAGIC, STAR_CATALOG_VERSION, 0, sizeof(StarRecord) };
+    out.write((const char*) &h, sizeof(h));
+
+    double cosE = cos(OBLIQUITY), sinE = sin(OBLIQUITY);
+    while (std::getline(in, line)) {
+        std::vector<std::string> f = splitCSV(line);
+        if ((int) f.size() <= std::max({ raCol, decCol, magCol, ciCol })) continue;
+        double mag = atof(f[magCol].c_str());
+        if (mag < -5.0 || mag > 32.0) continue; // the Sun row, bad data
+
+        double ra = atof(f[raCol].c_str()) * M_PI / 12.0;
+        double dec = atof(f[decCol].c_str()) * M_PI / 180.0;
+        // equatorial -> ecliptic, the simulation's frame
+        double x = cos(dec) * cos(ra), y = cos(dec) * sin(ra), z = sin(dec);
+        glm::dvec3 dir(x, y * cosE + z * sinE, -y * sinE + z * cosE);
+
+        StarRecord s;
+        for (int i = 0; i < 3; ++i)
+            s.dir[i] = (int16_t) lround(glm::clamp(dir[i], -1.0, 1.0) * 32767.0);
+        s.magnitude = (int16_t) lround(mag * 1000.0);
+        colorFromBV(ciCol >= 0 && !f[ciCol].empty() ? atof(f[ciCol].c_str()) : 0.65, s.color);
+        s.color[3] = 255;
+        out.write((const char*) &s, sizeof(s));
+        h.count++;
+    }
+
+    out.seekp(0);
+    out.write((const char*) &h, sizeof(h));
+    if (!out) {
+        fprintf(stderr, "Failed to write star catalog %s\n", outPath.c_str());
+        return false;
+    }
+    printf("Converted %u stars to %s\n", h.count, outPath.c_str());
+    return true;
+}
+
+// ---------------- Rendering ----------------
+
+bool StarField::load(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        fprintf(stderr, "Failed to map star catalog %s\n", path.c_str());
+        return false;
+    }
+    StarCatalogHeader h;
+    if (file.size() < sizeof(h)) return false;
+    memcpy(&h, file.data(), sizeof(h));
+    if (h.magic != STAR_CATALOG_MAGIC || h.version != STAR_CATALOG_VERSION || h.recordSize != sizeof(StarRecord) ||
+        file.size() < sizeof(h) + (size_t) h.count * sizeof(StarRecord)) {
+        fprintf(stderr, "Star catalog %s is invalid or truncated\n", path.c_str());
+        return false;
+    }
+
+    cleanup();
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // straight from the mapping; pages are read as the driver copies them
+    glBufferData(GL_ARRAY_BUFFER, (size_t) h.count * sizeof(StarRecord), file.data() + sizeof(h), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(StarRecord), (void*)offsetof(StarRecord, dir));
+    glVertexAttribPointer(1, 1, GL_SHORT, GL_FALSE, sizeof(StarRecord), (void*)offsetof(StarRecord, magnitude));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StarRecord), (void*)offsetof(StarRecord, color));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+
+    count = h.count;
+    printf("Star field: %u stars\n", count);
+    return true;
+}
+
+void StarField::draw(const Camera& cam, const Shader& shader) const {
+    if (count == 0) return;
+
+    glUseProgram(shader.ID);
+    shader.setMat4("view", cam.view);
+    shader.setMat4("projection", cam.projection);
+    shader.setFloat("limitingMagnitude", limitingMagnitude);
+    shader.setFloat("pointScale", pointScale);
+
+    // behind everything: no depth, additive so close pairs brighten
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_POINTS, 0, (GLsizei) count);
+    glBindVertexArray(0);
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+}
+
+uint32_t StarField::size() const {
+    return count;
+}
+
+void StarField::cleanup() {
+    if (VAO == 0) return;
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    VAO = VBO = 0;
+    count = 0;
+}
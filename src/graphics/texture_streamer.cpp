@@ -0,0 +1,434 @@
+#include "graphics/texture_streamer.h"
+#include "graphics/stb_image.h"
+#include "opengl_includes.h"
+#include "thread_pool.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+static const char* TEXTURE_CACHE_DIR = "texture_cache";
+static const uint32_t TEXTURE_CACHE_MAGIC = 0x58545341; // "ASTX"
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+TextureStreamer::TextureStreamer(unsigned decodeThreads)
+    : compress(GLAD_GL_EXT_texture_compression_s3tc != 0),
+      decodePool(std::make_unique<ThreadPool>(decodeThreads)) {
+    printf("Texture streaming: %s\n", compress ? "BC1" : "RGBA8");
+}
+
+TextureStreamer::~TextureStreamer() {
+    cleanup();
+}
+
+bool TextureStreamer::valid(int handle) const {
+    return handle >= 0 && handle < (int) entries.size() && entries[handle].refCount > 0;
+}
+
+int TextureStreamer::acquire(const std::string& path) {
+    auto it = handleByPath.find(path);
+    if (it != handleByPath.end()) {
+        entries[it->second].refCount++;
+        return it->second;
+    }
+    if (!decodePool) return INVALID_HANDLE;
+
+    int handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = (int) entries.size();
+        entries.emplace_back();
+    }
+    Entry& e = entries[handle];
+    e.path = path;
+    e.refCount = 1;
+    e.generation = ++nextGeneration;
+    handleByPath.emplace(path, handle);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingDecodes++;
+    }
+    uint64_t generation = e.generation;
+    decodePool->enqueue([this, handle, generation, path] {
+        decode(handle, generation, path);
+    });
+    return handle;
+}
+
+void TextureStreamer::release(int handle) {
+    if (!valid(handle)) return;
+    Entry& e = entries[handle];
+    if (--e.refCount > 0) return;
+
+    // in-flight work for this generation is dropped when it surfaces
+    if (e.texture) glDeleteTextures(1, &e.texture);
+    handleByPath.erase(e.path);
+    e = Entry();
+    freeHandles.push_back(handle);
+}
+
+GLuint TextureStreamer::getTexture(int handle) const {
+    if (!valid(handle)) return 0;
+    const Entry& e = entries[handle];
+    return e.residentLevel >= 0 ? e.texture : 0;
+}
+
+bool TextureStreamer::isComplete(int handle) const {
+    return valid(handle) && entries[handle].complete;
+}
+
+// ---------------- Decode (worker threads) ----------------
+
+void TextureStreamer::decode(int handle, uint64_t generation, const std::string& path) {
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        skip = stopping;
+    }
+    std::unique_ptr<Image> image = skip ? nullptr : loadImage(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!stopping) {
+        Upload upload;
+        upload.handle = handle;
+        upload.generation = generation;
+        if (image) upload.level = (int) image->levels.size() - 1;
+        upload.image = std::move(image);
+        decoded.push_back(std::move(upload));
+    }
+    pendingDecodes--;
+    idleCV.notify_all();
+}
+
+std::unique_ptr<TextureStreamer::Image> TextureStreamer::loadImage(const std::string& path) const {
+    Format format = compress ? Format::BC1 : Format::RGBA8;
+    std::string cacheFile = cachePath(path, format);
+
+    auto image = std::make_unique<Image>();
+    if (readCache(cacheFile, format, *image))
+        return image;
+
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load texture %s: %s\n", path.c_str(), stbi_failure_reason());
+        return nullptr;
+    }
+    image->format = Format::RGBA8;
+    image->levels.push_back({ width, height, std::vector<uint8_t>(pixels, pixels + (size_t) width * height * 4) });
+    stbi_image_free(pixels);
+
+    buildMips(*image);
+    if (compress) compressBC1(*image);
+    writeCache(cacheFile, *image);
+    return image;
+}
+
+// 2x2 box filter down to 1x1; odd edges reuse the last texel
+void TextureStreamer::buildMips(Image& image) {
+    while (image.levels.back().width > 1 || image.levels.back().height > 1) {
+        const Level& src = image.levels.back();
+        Level dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.data.resize((size_t) dst.width * dst.height * 4);
+
+        for (int y = 0; y < dst.height; ++y) {
+            int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+            for (int x = 0; x < dst.width; ++x) {
+                int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+                const uint8_t* a = &src.data[((size_t) y0 * src.width + x0) * 4];
+                const uint8_t* b = &src.data[((size_t) y0 * src.width + x1) * 4];
+                const uint8_t* c = &src.data[((size_t) y1 * src.width + x0) * 4];
+                const uint8_t* d = &src.data[((size_t) y1 * src.width + x1) * 4];
+                uint8_t* out = &dst.data[((size_t) y * dst.width + x) * 4];
+                for (int ch = 0; ch < 4; ++ch)
+                    out[ch] = (uint8_t) ((a[ch] + b[ch] + c[ch] + d[ch] + 2) / 4);
+            }
+        }
+        image.levels.push_back(std::move(dst));
+    }
+}
+
+// ---------------- BC1 encoding ----------------
+
+static uint16_t to565(const int* c) {
+    return (uint16_t) (((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+static void from565(uint16_t v, int* c) {
+    c[0] = ((v >> 11) & 31) * 255 / 31;
+    c[1] = ((v >> 5) & 63) * 255 / 63;
+    c[2] = (v & 31) * 255 / 31;
+}
+
+// range fit: endpoints from the inset bounding box of the block's colors
+static void encodeBlock(const uint8_t* rgba, int width, int height, int bx, int by, uint8_t* out) {
+    int texels[16][3];
+    int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; ++i) {
+        int x = std::min(bx * 4 + (i & 3), width - 1);
+        int y = std::min(by * 4 + (i >> 2), height - 1);
+        const uint8_t* p = &rgba[((size_t) y * width + x) * 4];
+        for (int ch = 0; ch < 3; ++ch) {
+            texels[i][ch] = p[ch];
+            lo[ch] = std::min(lo[ch], (int) p[ch]);
+            hi[ch] = std::max(hi[ch], (int) p[ch]);
+        }
+    }
+    for (int ch = 0; ch < 3; ++ch) {
+        int inset = (hi[ch] - lo[ch]) / 16;
+        lo[ch] += inset;
+        hi[ch] -= inset;
+    }
+
+    uint16_t c0 = to565(hi), c1 = to565(lo);
+    uint32_t indices = 0;
+    if (c0 < c1) std::swap(c0, c1);
+    if (c0 != c1) {
+        // four-color mode (c0 > c1): c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+        int palette[4][3];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int ch = 0; ch < 3; ++ch) {
+            palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+            palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDist = INT32_MAX;
+            for (int k = 0; k < 4; ++k) {
+                int dr = texels[i][0] - palette[k][0];
+                int dg = texels[i][1] - palette[k][1];
+                int db = texels[i][2] - palette[k][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = k;
+                }
+            }
+            indices |= (uint32_t) best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+void TextureStreamer::compressBC1(Image& image) const {
+    for (Level& level : image.levels) {
+        int blocksWide = (level.width + 3) / 4, blocksHigh = (level.height + 3) / 4;
+        std::vector<uint8_t> blocks((size_t) blocksWide * blocksHigh * 8);
+        decodePool->parallelFor(blocksHigh, 64, [&](size_t begin, size_t end, size_t) {
+            for (size_t by = begin; by < end; ++by)
+                for (int bx = 0; bx < blocksWide; ++bx)
+                    encodeBlock(level.data.data(), level.width, level.height, bx, (int) by, &blocks[(by * blocksWide + bx) * 8]);
+        });
+        level.data.swap(blocks);
+    }
+    image.format = Format::BC1;
+}
+
+// ---------------- Disk cache ----------------
+
+std::string TextureStreamer::cachePath(const std::string& path, Format format) {
+    // keyed on the source's identity so edited images are re-baked
+    std::error_code ec;
+    std::string identity = path + '\0';
+    identity += std::to_string(std::filesystem::file_size(path, ec)) + '\0';
+    identity += std::to_string(std::filesystem::last_write_time(path, ec).time_since_epoch().count()) + '\0';
+    identity += std::to_string((uint32_t) format);
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : identity) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) hash);
+    return (std::filesystem::path(TEXTURE_CACHE_DIR) / (std::string(hex) + ".tex")).string();
+}
+
+bool TextureStreamer::readCache(const std::string& file, Format format, Image& image) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return false;
+
+    uint32_t header[4] = {};
+    in.read((char*) header, sizeof(header));
+    if (!in || header[0] != TEXTURE_CACHE_MAGIC || header[1] != TEXTURE_CACHE_VERSION ||
+        header[2] != (uint32_t) format || header[3] == 0 || header[3] > 32)
+        return false;
+
+    image.format = format;
+    image.levels.resize(header[3]);
+    for (Level& level : image.levels) {
+        uint32_t dims[3] = {};
+        in.read((char*) dims, sizeof(dims));
+        if (!in) return false;
+        level.width = (int) dims[0];
+        level.height = (int) dims[1];
+        level.data.resize(dims[2]);
+        if (!in.read((char*) level.data.data(), dims[2])) return false;
+    }
+    return true;
+}
+
+void TextureStreamer::writeCache(const std::string& file, const Image& image) {
+    std::error_code ec;
+    std::filesystem::create_directories(TEXTURE_CACHE_DIR, ec);
+
+    // written aside and renamed so a crash never leaves a truncated entry
+    std::string temp = file + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary);
+        uint32_t header[4] = { TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, (uint32_t) image.format, (uint32_t) image.levels.size() };
+        out.write((const char*) header, sizeof(header));
+        for (const Level& level : image.levels) {
+            uint32_t dims[3] = { (uint32_t) level.width, (uint32_t) level.height, (uint32_t) level.data.size() };
+            out.write((const char*) dims, sizeof(dims));
+            out.write((const char*) level.data.data(), level.data.size());
+        }
+        if (!out) {
+            fprintf(stderr, "Failed to write texture cache %s\n", file.c_str());
+            return;
+        }
+    }
+    std::filesystem::rename(temp, file, ec);
+}
+
+// ---------------- Upload (GL thread) ----------------
+
+void TextureStreamer::update() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!decoded.empty()) {
+            uploads.push_back(std::move(decoded.front()));
+            decoded.pop_front();
+        }
+    }
+
+    size_t spent = 0;
+    while (!uploads.empty() && spent < uploadBudget) {
+        Upload& u = uploads.front();
+        if (!valid(u.handle) || entries[u.handle].generation != u.generation) {
+            uploads.pop_front(); // released while decoding
+            continue;
+        }
+        if (!u.image) {
+            entries[u.handle].failed = true;
+            uploads.pop_front();
+            continue;
+        }
+        spent += uploadBand(uploadBudget - spent);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+size_t TextureStreamer::uploadBand(size_t budget) {
+    Upload& u = uploads.front();
+    Entry& e = entries[u.handle];
+    Level& level = u.image->levels[u.level];
+    bool bc1 = u.image->format == Format::BC1;
+
+    if (e.texture == 0) {
+        // only levels at or above the base level need to exist for sampling
+        int maxLevel = (int) u.image->levels.size() - 1;
+        glGenTextures(1, &e.texture);
+        glBindTexture(GL_TEXTURE_2D, e.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, maxLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    }
+    glBindTexture(GL_TEXTURE_2D, e.texture);
+
+    if (!u.allocated) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (bc1)
+            glCompressedTexImage2D(GL_TEXTURE_2D, u.level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0,
+                                   (GLsizei) level.data.size(), nullptr);
+        else
+            glTexImage2D(GL_TEXTURE_2D, u.level, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        u.allocated = true;
+    }
+
+    // BC1 rows come in 4-texel block rows
+    int rowStep = bc1 ? 4 : 1;
+    size_t rowBytes = bc1 ? (size_t) ((level.width + 3) / 4) * 8 : (size_t) level.width * 4;
+    int rowsLeft = (level.height - u.row + rowStep - 1) / rowStep;
+    int rows = (int) std::clamp<size_t>(budget / rowBytes, 1, rowsLeft);
+    size_t bytes = rows * rowBytes;
+    int height = std::min(rows * rowStep, level.height - u.row);
+
+    if (pbo == 0) glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    // orphan so this band never waits on the previous one
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    const uint8_t* src = &level.data[(u.row / rowStep) * rowBytes];
+    const void* source = nullptr; // offset into the PBO
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst) {
+        memcpy(dst, src, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        // mapping failed; fall back to a synchronous client-memory upload
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        source = src;
+    }
+    if (bc1)
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, u.level, 0, u.row, level.width, height,
+                                  GL_COMPRESSED_RGB_S3TC_DXT1_EXT, (GLsizei) bytes, source);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, u.level, 0, u.row, level.width, height, GL_RGBA, GL_UNSIGNED_BYTE, source);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    u.row += height;
+
+    if (u.row >= level.height) {
+        // level done: expose it and drop the CPU copy
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, u.level);
+        e.residentLevel = u.level;
+        std::vector<uint8_t>().swap(level.data);
+        u.row = 0;
+        u.allocated = false;
+        if (--u.level < 0) {
+            e.complete = true;
+            uploads.pop_front();
+        }
+    }
+    return bytes;
+}
+
+void TextureStreamer::cleanup() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        idleCV.wait(lock, [this] { return pendingDecodes == 0; });
+        decoded.clear();
+    }
+    decodePool.reset();
+    uploads.clear();
+
+    for (Entry& e : entries) {
+        if (e.texture) glDeleteTextures(1, &e.texture);
+    }
+    entries.clear();
+    freeHandles.clear();
+    handleByPath.clear();
+    if (pbo) {
+        glDeleteBuffers(1, &pbo);
+        pbo = 0;
+    }
+}
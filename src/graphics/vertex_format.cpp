@@ -0,0 +1,90 @@
+#include "graphics/vertex_format.h"
+#include "opengl_includes.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+struct CompactVertex {
+    glm::vec3 pos;
+    uint32_t normal;     // GL_INT_2_10_10_10_REV
+    uint16_t uv[2];      // half floats
+};
+
+struct QuantizedVertex {
+    int16_t pos[4];      // snorm16, w unused
+    uint32_t normal;
+    uint16_t uv[2];
+};
+
+static_assert(sizeof(Vertex) == 32, "Vertex layout changed");
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay tightly packed");
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay tightly packed");
+
+const VertexFormatDesc& describeVertexFormat(VertexFormat format) {
+    static const VertexFormatDesc full = {
+        sizeof(Vertex),
+        { 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, pos) },
+        { 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal) },
+        { 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, uv) }
+    };
+    static const VertexFormatDesc compact = {
+        sizeof(CompactVertex),
+        { 3, GL_FLOAT, GL_FALSE, offsetof(CompactVertex, pos) },
+        { 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(CompactVertex, normal) },
+        { 2, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactVertex, uv) }
+    };
+    static const VertexFormatDesc quantized = {
+        sizeof(QuantizedVertex),
+        { 4, GL_SHORT, GL_TRUE, offsetof(QuantizedVertex, pos) },
+        { 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(QuantizedVertex, normal) },
+        { 2, GL_HALF_FLOAT, GL_FALSE, offsetof(QuantizedVertex, uv) }
+    };
+
+    switch (format) {
+        case VertexFormat::Compact: return compact;
+        case VertexFormat::CompactQuantized: return quantized;
+        default: return full;
+    }
+}
+
+static uint32_t packNormal(const glm::vec3& n) {
+    return glm::packSnorm3x10_1x2(glm::vec4(n, 0.0f));
+}
+
+std::vector<uint8_t> packVertices(const std::vector<Vertex>& vertices, VertexFormat format) {
+    const VertexFormatDesc& desc = describeVertexFormat(format);
+    std::vector<uint8_t> bytes(vertices.size() * desc.stride);
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        uint8_t* dst = &bytes[i * desc.stride];
+        if (format == VertexFormat::Compact) {
+            CompactVertex c = { v.pos, packNormal(v.normal), 
+                                { glm::packHalf1x16(v.uv.x), glm::packHalf1x16(v.uv.y) } };
+            memcpy(dst, &c, sizeof(c));
+        } else if (format == VertexFormat::CompactQuantized) {
+            glm::vec3 p = glm::clamp(v.pos, -1.0f, 1.0f) * 32767.0f;
+            QuantizedVertex q = { { int16_t(roundf(p.x)), int16_t(roundf(p.y)), int16_t(roundf(p.z)), 32767 },
+                                  packNormal(v.normal), 
+                                  { glm::packHalf1x16(v.uv.x), glm::packHalf1x16(v.uv.y) } };
+            memcpy(dst, &q, sizeof(q));
+        } else {
+            memcpy(dst, &v, sizeof(v));
+        }
+    }
+    return bytes;
+}
+
+void applyVertexFormat(VertexFormat format) {
+    const VertexFormatDesc& desc = describeVertexFormat(format);
+    const VertexAttribDesc* attribs[3] = { &desc.pos, &desc.normal, &desc.uv };
+    for (GLuint i = 0; i < 3; ++i) {
+        const VertexAttribDesc& a = *attribs[i];
+        glVertexAttribPointer(i, a.size, a.type, a.normalized, (GLsizei) desc.stride, (void*)a.offset);
+        glEnableVertexAttribArray(i);
+    }
+}
@@ -0,0 +1,594 @@
+#include "graphics/virtual_texture.h"
+#include "graphics/stb_image.h"
+#include "graphics/shader.h"
+#include "graphics/render_queue.h"
+#include "graphics/instance_buffer.h"
+#include "opengl_includes.h"
+#include "thread_pool.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+static const char* VT_INFO_FILE = "vt.info";
+
+static uint32_t packEntry(int slotX, int slotY, int level) {
+    return (uint32_t) slotX | (uint32_t) slotY << 8 | (uint32_t) level << 16 | 1u << 24;
+}
+
+static bool entryValid(uint32_t e) { return (e >> 24) != 0; }
+static int entryLevel(uint32_t e) { return (e >> 16) & 0xFF; }
+
+static std::string tilePath(const std::string& dir, int level, int x, int y) {
+    return dir + "/" + std::to_string(level) + "/" + std::to_string(x) + "_" + std::to_string(y) + ".rgba";
+}
+
+VirtualTextureSystem::VirtualTextureSystem(int atlasSlotsPerSide, unsigned loaderThreads)
+    : atlasSlots(glm::clamp(atlasSlotsPerSide, 1, 256)),
+      loaderPool(std::make_unique<ThreadPool>(loaderThreads)) {
+    int size = atlasSlots * TILE_STRIDE;
+    glGenTextures(1, &atlas);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    // the atlas stays bound to unit 2 for every program that samples it
+    glActiveTexture(GL_TEXTURE0);
+
+    slots.resize(atlasSlots * atlasSlots);
+    for (int i = (int) slots.size() - 1; i >= 0; --i)
+        freeSlots.push_back(i);
+    glGenBuffers(FEEDBACK_BUFFERS, feedbackPBOs);
+    printf("Virtual texture atlas: %dx%d tiles (%d px)\n", atlasSlots, atlasSlots, size);
+}
+
+VirtualTextureSystem::~VirtualTextureSystem() {
+    cleanup();
+}
+
+// handle 16 | level 8 | y 20 | x 20
+uint64_t VirtualTextureSystem::tileKey(int handle, int level, int x, int y) {
+    return (uint64_t) handle << 48 | (uint64_t) level << 40 | (uint64_t) y << 20 | (uint64_t) x;
+}
+
+void VirtualTextureSystem::unpackKey(uint64_t key, int& handle, int& level, int& x, int& y) {
+    handle = (int) (key >> 48);
+    level = (int) ((key >> 40) & 0xFF);
+    y = (int) ((key >> 20) & 0xFFFFF);
+    x = (int) (key & 0xFFFFF);
+}
+
+bool VirtualTextureSystem::valid(int handle) const {
+    return handle >= 0 && handle < (int) textures.size() && textures[handle].refCount > 0;
+}
+
+// ---------------- Baking ----------------
+
+bool VirtualTextureSystem::bake(const std::string& imagePath, const std::string& dir) {
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load %s: %s\n", imagePath.c_str(), stbi_failure_reason());
+        return false;
+    }
+
+    // top level is 2x1 tiles; each finer level doubles both
+    int tilesY = 1, levelCount = 1;
+    while (tilesY * TILE_SIZE < height) {
+        tilesY *= 2;
+        levelCount++;
+    }
+    int tilesX = 2 * tilesY;
+    int w = tilesX * TILE_SIZE, h = tilesY * TILE_SIZE;
+
+    // level 0: bilinear resample to the virtual size
+    std::vector<uint8_t> level((size_t) w * h * 4);
+    for (int y = 0; y < h; ++y) {
+        float sy = glm::clamp((y + 0.5f) * height / h - 0.5f, 0.0f, height - 1.0f);
+        int y0 = (int) sy, y1 = std::min(y0 + 1, height - 1);
+        float fy = sy - y0;
+        for (int x = 0; x < w; ++x) {
+            float sx = glm::clamp((x + 0.5f) * width / w - 0.5f, 0.0f, width - 1.0f);
+            int x0 = (int) sx, x1 = std::min(x0 + 1, width - 1);
+            float fx = sx - x0;
+            for (int ch = 0; ch < 4; ++ch) {
+                float top = pixels[((size_t) y0 * width + x0) * 4 + ch] * (1 - fx) + pixels[((size_t) y0 * width + x1) * 4 + ch] * fx;
+                float bottom = pixels[((size_t) y1 * width + x0) * 4 + ch] * (1 - fx) + pixels[((size_t) y1 * width + x1) * 4 + ch] * fx;
+                level[((size_t) y * w + x) * 4 + ch] = (uint8_t) (top * (1 - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+    stbi_image_free(pixels);
+
+    std::vector<uint8_t> tile((size_t) TILE_STRIDE * TILE_STRIDE * 4);
+    for (int l = 0; l < levelCount; ++l) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir + "/" + std::to_string(l), ec);
+
+        // borders wrap in longitude and clamp at the poles
+        for (int ty = 0; ty < (tilesY >> l); ++ty) {
+            for (int tx = 0; tx < (tilesX >> l); ++tx) {
+                for (int j = 0; j < TILE_STRIDE; ++j) {
+                    int sy = glm::clamp(ty * TILE_SIZE + j - TILE_BORDER, 0, h - 1);
+                    for (int i = 0; i < TILE_STRIDE; ++i) {
+                        int sx = ((tx * TILE_SIZE + i - TILE_BORDER) % w + w) % w;
+                        memcpy(&tile[((size_t) j * TILE_STRIDE + i) * 4], &level[((size_t) sy * w + sx) * 4], 4);
+                    }
+                }
+                std::ofstream out(tilePath(dir, l, tx, ty), std::ios::binary);
+                out.write((const char*) tile.data(), tile.size());
+                if (!out) {
+                    fprintf(stderr, "Failed to write tile %s\n", tilePath(dir, l, tx, ty).c_str());
+                    return false;
+                }
+            }
+        }
+
+        if (l + 1 == levelCount) break;
+        // 2x2 box filter into the next level
+        int nw = w / 2, nh = h / 2;
+        std::vector<uint8_t> next((size_t) nw * nh * 4);
+        for (int y = 0; y < nh; ++y)
+            for (int x = 0; x < nw; ++x)
+                for (int ch = 0; ch < 4; ++ch)
+                    next[((size_t) y * nw + x) * 4 + ch] = (uint8_t) ((
+                        level[((size_t) (2 * y) * w + 2 * x) * 4 + ch] + level[((size_t) (2 * y) * w + 2 * x + 1) * 4 + ch] +
+                        level[((size_t) (2 * y + 1) * w + 2 * x) * 4 + ch] + level[((size_t) (2 * y + 1) * w + 2 * x + 1) * 4 + ch] + 2) / 4);
+        level.swap(next);
+        w = nw;
+        h = nh;
+    }
+
+    std::ofstream info(dir + "/" + VT_INFO_FILE);
+    info << tilesX << " " << tilesY << " " << levelCount << "\n";
+    printf("Baked %s: %d levels, %dx%d tiles at level 0\n", imagePath.c_str(), levelCount, tilesX, tilesY);
+    return (bool) info;
+}
+
+// ---------------- Virtual textures ----------------
+
+bool VirtualTextureSystem::readInfo(VirtualTexture& vt) const {
+    std::ifstream info(vt.dir + "/" + VT_INFO_FILE);
+    if (!(info >> vt.tilesX >> vt.tilesY >> vt.levelCount)) return false;
+    // 12 levels is a 2048x1024 page table, ~268K texels around the equator
+    return vt.levelCount > 0 && vt.levelCount <= 12 && vt.tilesX == 2 * vt.tilesY &&
+           vt.tilesY == 1 << (vt.levelCount - 1);
+}
+
+void VirtualTextureSystem::createPageTable(VirtualTexture& vt) {
+    glGenTextures(1, &vt.pageTable);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, vt.pageTable);
+    // integer textures can't filter; lookups use texelFetch
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, vt.levelCount - 1);
+
+    vt.entries.resize(vt.levelCount);
+    vt.dirty.assign(vt.levelCount, false);
+    for (int l = 0; l < vt.levelCount; ++l) {
+        vt.entries[l].assign((size_t) (vt.tilesX >> l) * (vt.tilesY >> l), 0);
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8UI, vt.tilesX >> l, vt.tilesY >> l, 0,
+                     GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, vt.entries[l].data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+int VirtualTextureSystem::acquire(const std::string& dir) {
+    auto it = handleByDir.find(dir);
+    if (it != handleByDir.end()) {
+        textures[it->second].refCount++;
+        return it->second;
+    }
+    if (!loaderPool) return INVALID_HANDLE;
+
+    VirtualTexture vt;
+    vt.dir = dir;
+    if (!readInfo(vt)) {
+        fprintf(stderr, "Virtual texture %s has no valid %s\n", dir.c_str(), VT_INFO_FILE);
+        return INVALID_HANDLE;
+    }
+
+    int handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = (int) textures.size();
+        textures.emplace_back();
+    }
+    vt.refCount = 1;
+    vt.generation = ++nextGeneration;
+    createPageTable(vt);
+    textures[handle] = std::move(vt);
+    handleByDir.emplace(dir, handle);
+    requestTopLevel(handle);
+    return handle;
+}
+
+void VirtualTextureSystem::release(int handle) {
+    if (!valid(handle)) return;
+    VirtualTexture& vt = textures[handle];
+    if (--vt.refCount > 0) return;
+
+    // free its slots outright; the page table goes with it
+    for (int s = 0; s < (int) slots.size(); ++s) {
+        if (!slots[s].used || (int) (slots[s].key >> 48) != handle) continue;
+        if (!slots[s].pinned) lru.erase(slots[s].lru);
+        slotByKey.erase(slots[s].key);
+        slots[s] = Slot();
+        freeSlots.push_back(s);
+    }
+    for (auto it = missing.begin(); it != missing.end();) {
+        if ((int) (*it >> 48) == handle) it = missing.erase(it);
+        else ++it;
+    }
+
+    glDeleteTextures(1, &vt.pageTable);
+    handleByDir.erase(vt.dir);
+    vt = VirtualTexture();
+    freeHandles.push_back(handle);
+}
+
+GLuint VirtualTextureSystem::getPageTable(int handle) const {
+    if (!valid(handle)) return 0;
+    const VirtualTexture& vt = textures[handle];
+    for (uint32_t e : vt.entries.back())
+        if (!entryValid(e)) return 0;
+    return vt.pageTable;
+}
+
+void VirtualTextureSystem::configureShader(const Shader& shader) const {
+    glUseProgram(shader.ID);
+    shader.setInt("pageTable", 1);
+    shader.setInt("tileAtlas", 2);
+    shader.setFloat("tileSize", (float) TILE_SIZE);
+    shader.setFloat("tileBorder", (float) TILE_BORDER);
+    shader.setFloat("atlasSize", (float) (atlasSlots * TILE_STRIDE));
+    glUseProgram(0);
+}
+
+size_t VirtualTextureSystem::residentTiles() const {
+    return slotByKey.size();
+}
+
+// ---------------- Residency ----------------
+
+void VirtualTextureSystem::requestTopLevel(int handle) {
+    const VirtualTexture& vt = textures[handle];
+    int top = vt.levelCount - 1;
+    for (int x = 0; x < 2; ++x)
+        request(tileKey(handle, top, x, 0));
+}
+
+void VirtualTextureSystem::request(uint64_t key) {
+    auto it = slotByKey.find(key);
+    if (it != slotByKey.end()) {
+        touch(it->second);
+        return;
+    }
+    if (pending.count(key) || missing.count(key) || (int) pending.size() >= maxPendingLoads)
+        return;
+
+    int handle, level, x, y;
+    unpackKey(key, handle, level, x, y);
+    pending.insert(key);
+    std::string path = tilePath(textures[handle].dir, level, x, y);
+    uint64_t generation = textures[handle].generation;
+    loaderPool->enqueue([this, key, generation, path] {
+        LoadedTile tile{ key, generation, {} };
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            tile.texels.resize((size_t) TILE_STRIDE * TILE_STRIDE * 4);
+            if (!in.read((char*) tile.texels.data(), tile.texels.size()))
+                tile.texels.clear();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.push_back(std::move(tile));
+    });
+}
+
+void VirtualTextureSystem::touch(int slot) {
+    slots[slot].lastUsed = frame;
+    if (!slots[slot].pinned)
+        lru.splice(lru.begin(), lru, slots[slot].lru);
+}
+
+int VirtualTextureSystem::allocateSlot() {
+    if (freeSlots.empty()) {
+        // never evict something on screen; the tile waits for a later frame
+        if (lru.empty() || slots[lru.back()].lastUsed >= frame) return -1;
+        evict(lru.back());
+    }
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
+
+void VirtualTextureSystem::evict(int slot) {
+    int handle, level, x, y;
+    unpackKey(slots[slot].key, handle, level, x, y);
+    lru.erase(slots[slot].lru);
+    slotByKey.erase(slots[slot].key);
+    slots[slot] = Slot();
+    freeSlots.push_back(slot);
+
+    // fall back to whatever the parent tile maps to
+    VirtualTexture& vt = textures[handle];
+    uint32_t parent = 0;
+    if (level + 1 < vt.levelCount)
+        parent = vt.entries[level + 1][(size_t) (y / 2) * (vt.tilesX >> (level + 1)) + x / 2];
+    mapTile(vt, level, x, y, parent, false);
+}
+
+bool VirtualTextureSystem::insert(const LoadedTile& tile) {
+    int slot = allocateSlot();
+    if (slot < 0) return false;
+
+    int handle, level, x, y;
+    unpackKey(tile.key, handle, level, x, y);
+    int slotX = slot % atlasSlots, slotY = slot / atlasSlots;
+
+    glActiveTexture(GL_TEXTURE2);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * TILE_STRIDE, slotY * TILE_STRIDE, TILE_STRIDE, TILE_STRIDE,
+                    GL_RGBA, GL_UNSIGNED_BYTE, tile.texels.data());
+    glActiveTexture(GL_TEXTURE0);
+
+    VirtualTexture& vt = textures[handle];
+    Slot& s = slots[slot];
+    s.key = tile.key;
+    s.used = true;
+    s.pinned = level == vt.levelCount - 1;
+    s.lastUsed = frame;
+    if (!s.pinned) {
+        lru.push_front(slot);
+        s.lru = lru.begin();
+    }
+    slotByKey.emplace(tile.key, slot);
+    mapTile(vt, level, x, y, packEntry(slotX, slotY, level), true);
+    return true;
+}
+
+void VirtualTextureSystem::mapTile(VirtualTexture& vt, int level, int x, int y, uint32_t entry, bool inserting) {
+    for (int l = level; l >= 0; --l) {
+        int span = 1 << (level - l);
+        int width = vt.tilesX >> l;
+        std::vector<uint32_t>& entries = vt.entries[l];
+        for (int ty = y * span; ty < (y + 1) * span; ++ty) {
+            for (int tx = x * span; tx < (x + 1) * span; ++tx) {
+                uint32_t& e = entries[(size_t) ty * width + tx];
+                bool replace = inserting ? (!entryValid(e) || entryLevel(e) >= level)
+                                         : (entryValid(e) && entryLevel(e) == level);
+                if (replace) e = entry;
+            }
+        }
+        vt.dirty[l] = true;
+    }
+}
+
+// ---------------- Per frame ----------------
+
+void VirtualTextureSystem::readFeedback() {
+    int i = nextFeedback;
+    if (!feedbackFences[i]) return;
+    GLenum status = glClientWaitSync(feedbackFences[i], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+    glDeleteSync(feedbackFences[i]);
+    feedbackFences[i] = nullptr;
+
+    size_t texels = (size_t) feedbackSize[i][0] * feedbackSize[i][1];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBOs[i]);
+    const uint16_t* data = (const uint16_t*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, texels * 8, GL_MAP_READ_BIT);
+    std::unordered_set<uint64_t> visible;
+    if (data) {
+        // r, g = tile, b = level, a = handle + 1
+        for (size_t t = 0; t < texels; ++t) {
+            const uint16_t* f = &data[t * 4];
+            int handle = (int) f[3] - 1;
+            if (!valid(handle)) continue;
+            const VirtualTexture& vt = textures[handle];
+            int x = f[0], y = f[1];
+            // ancestors too, so a coarser fallback is always on its way
+            for (int level = f[2]; level < vt.levelCount; ++level, x /= 2, y /= 2) {
+                if (!visible.insert(tileKey(handle, level, x, y)).second) break;
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // coarse first: each load then covers the most screen
+    std::vector<uint64_t> requests(visible.begin(), visible.end());
+    std::sort(requests.begin(), requests.end(), [](uint64_t a, uint64_t b) {
+        return ((a >> 40) & 0xFF) > ((b >> 40) & 0xFF);
+    });
+    for (uint64_t key : requests)
+        request(key);
+}
+
+void VirtualTextureSystem::update() {
+    frame++;
+    readFeedback();
+    for (int h = 0; h < (int) textures.size(); ++h) {
+        if (valid(h)) requestTopLevel(h);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!loaded.empty()) {
+            ready.push_back(std::move(loaded.front()));
+            loaded.pop_front();
+        }
+    }
+
+    int uploads = 0;
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glActiveTexture(GL_TEXTURE0);
+    while (!ready.empty() && uploads < uploadsPerFrame) {
+        LoadedTile& tile = ready.front();
+        int handle = (int) (tile.key >> 48);
+        bool current = valid(handle) && textures[handle].generation == tile.generation;
+        if (current && !tile.texels.empty() && !slotByKey.count(tile.key)) {
+            if (!insert(tile)) break; // atlas full of visible tiles
+            uploads++;
+        } else if (current && tile.texels.empty()) {
+            missing.insert(tile.key);
+        }
+        pending.erase(tile.key);
+        ready.pop_front();
+    }
+
+    // push changed page table levels
+    glActiveTexture(GL_TEXTURE1);
+    for (VirtualTexture& vt : textures) {
+        if (vt.refCount <= 0) continue;
+        for (int l = 0; l < vt.levelCount; ++l) {
+            if (!vt.dirty[l]) continue;
+            glBindTexture(GL_TEXTURE_2D, vt.pageTable);
+            glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, vt.tilesX >> l, vt.tilesY >> l,
+                            GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, vt.entries[l].data());
+            vt.dirty[l] = false;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void VirtualTextureSystem::resizeFeedback(int width, int height) {
+    if (feedbackFBO != 0 && width == feedbackWidth && height == feedbackHeight) return;
+    feedbackWidth = width;
+    feedbackHeight = height;
+    if (feedbackFBO == 0) {
+        glGenFramebuffers(1, &feedbackFBO);
+        glGenRenderbuffers(1, &feedbackColor);
+        glGenRenderbuffers(1, &feedbackDepth);
+    }
+
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA16UI, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Feedback target %dx%d is incomplete\n", width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void VirtualTextureSystem::renderFeedback(const RenderQueue& queue, const Shader& feedbackShader, const glm::mat4& view,
+                                          const glm::mat4& projection, const InstanceBuffer& instances, int viewportWidth, int viewportHeight) {
+    const std::vector<DrawPacket>& packets = queue.getPackets();
+    bool any = std::any_of(packets.begin(), packets.end(), [](const DrawPacket& p) { return p.pageTable != 0; });
+    if (!any || viewportWidth <= 0 || viewportHeight <= 0) return;
+
+    resizeFeedback(std::max(1, viewportWidth / FEEDBACK_DIVISOR), std::max(1, viewportHeight / FEEDBACK_DIVISOR));
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glViewport(0, 0, feedbackWidth, feedbackHeight);
+    const GLuint clearValue[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, clearValue);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(feedbackShader.ID);
+    feedbackShader.setMat4("view", view);
+    feedbackShader.setMat4("projection", projection);
+    // derivatives are FEEDBACK_DIVISOR times coarser here than on screen
+    feedbackShader.setFloat("lodBias", log2f((float) FEEDBACK_DIVISOR));
+    GLint handleLoc = glGetUniformLocation(feedbackShader.ID, "vtHandle");
+    glActiveTexture(GL_TEXTURE1);
+    GLuint boundVAO = 0;
+    int boundSlot = -1;
+    for (const DrawPacket& p : packets) {
+        if (p.pageTable == 0) continue;
+        int handle = INVALID_HANDLE;
+        for (int h = 0; h < (int) textures.size() && handle < 0; ++h) {
+            if (valid(h) && textures[h].pageTable == p.pageTable) handle = h;
+        }
+        if (handle < 0) continue;
+        glUniform1ui(handleLoc, (GLuint) handle);
+        glBindTexture(GL_TEXTURE_2D, p.pageTable);
+        feedbackShader.setMat4("model", *p.model);
+        if (p.VAO != boundVAO) {
+            glBindVertexArray(p.VAO);
+            boundVAO = p.VAO;
+            boundSlot = -1;
+        }
+        if (p.instanceSlot != boundSlot) {
+            instances.bindAttribute(p.instanceSlot);
+            boundSlot = p.instanceSlot;
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, p.indexCount, GL_UNSIGNED_INT, 0, 1);
+    }
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    // async readback; an unread older sample in this buffer is simply dropped
+    int i = nextFeedback;
+    if (feedbackFences[i]) glDeleteSync(feedbackFences[i]);
+    size_t bytes = (size_t) feedbackWidth * feedbackHeight * 8;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBOs[i]);
+    if (feedbackSize[i][0] != feedbackWidth || feedbackSize[i][1] != feedbackHeight)
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    feedbackFences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    feedbackSize[i][0] = feedbackWidth;
+    feedbackSize[i][1] = feedbackHeight;
+    nextFeedback = (i + 1) % FEEDBACK_BUFFERS;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+}
+
+void VirtualTextureSystem::cleanup() {
+    // loader tasks only touch the queue, so draining the pool is enough
+    loaderPool.reset();
+    for (VirtualTexture& vt : textures) {
+        if (vt.pageTable) glDeleteTextures(1, &vt.pageTable);
+    }
+    textures.clear();
+    freeHandles.clear();
+    handleByDir.clear();
+    slots.clear();
+    freeSlots.clear();
+    lru.clear();
+    slotByKey.clear();
+    pending.clear();
+    missing.clear();
+    ready.clear();
+    loaded.clear();
+
+    for (int i = 0; i < FEEDBACK_BUFFERS; ++i) {
+        if (feedbackFences[i]) glDeleteSync(feedbackFences[i]);
+        feedbackFences[i] = nullptr;
+    }
+    if (feedbackPBOs[0]) glDeleteBuffers(FEEDBACK_BUFFERS, feedbackPBOs);
+    memset(feedbackPBOs, 0, sizeof(feedbackPBOs));
+    if (feedbackFBO) {
+        glDeleteFramebuffers(1, &feedbackFBO);
+        glDeleteRenderbuffers(1, &feedbackColor);
+        glDeleteRenderbuffers(1, &feedbackDepth);
+        feedbackFBO = 0;
+    }
+    if (atlas) {
+        glDeleteTextures(1, &atlas);
+        atlas = 0;
+    }
+}
@@ -3,6 +3,9 @@
 #include "backends/imgui_impl_opengl3.h"
 #include "imgui.h"
 #include "opengl_includes.h"
+#include "profiler.h"
+#include <cfloat>
+#include <cstdio>
 
 GUI::GUI(GLFWwindow* window) {
     IMGUI_CHECKVERSION();
@@ -23,7 +26,7 @@ void GUI::newFrame() {
     ImGui::NewFrame();
 }
 
-void GUI::drawElements() {
+void GUI::drawElements(const RenderStats& renderStats, DriftMonitor& drift) {
     ImGui::SetNextWindowPos(ImVec2(10, 10));
     ImGui::SetNextWindowBgAlpha(0.3f);
     ImGui::Begin("Options", nullptr, ImGuiWindowFlags_NoDecoration | 
@@ -32,13 +35,42 @@ void GUI::drawElements() {
                                      ImGuiWindowFlags_NoNav);
     
     ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+    ImGui::Text("Drawn: %d  Culled: %d  Binds: %d", renderStats.drawn, renderStats.culled, renderStats.binds);
     
     if (ImGui::Button(btn_paused ? "Play" : "Pause")) {
        btn_paused = !btn_paused; 
     }
     
-    ImGui::SliderFloat("Sim Speed", &slider_sim_speed, 0, 1e4f, "%.3fx", 
-                       ImGuiSliderFlags_None & ~ImGuiSliderFlags_WrapAround);
+    ImGui::SliderFloat("Sim Speed", &slider_sim_speed, 0, 1e6f, "%.3fx", 
+                       ImGuiSliderFlags_Logarithmic & ~ImGuiSliderFlags_WrapAround);
+
+    if (ImGui::CollapsingHeader("Conservation")) {
+        for (const DriftMonitor::Series* series : { &drift.energy(), &drift.momentum(), &drift.angularMomentum() }) {
+            char label[64];
+            snprintf(label, sizeof(label), "%s %.2e", series->name, series->drift);
+            ImGui::PlotLines(label, series->history.data(), DriftMonitor::HISTORY, series->head,
+                             nullptr, 0.0f, FLT_MAX, ImVec2(200, 30));
+        }
+        ImGui::Checkbox("Limit speed", &drift.throttle);
+        ImGui::SameLine();
+        ImGui::InputDouble("Step drift", &drift.tolerance, 0.0, 0.0, "%.1e");
+        if (drift.throttle)
+            ImGui::Text("Speed scaled by %.3f", drift.speedScale());
+    }
+
+    if (ImGui::CollapsingHeader("Profiler")) {
+        Profiler& profiler = Profiler::get();
+        for (const Profiler::Stage& stage : profiler.getStages()) {
+            char label[64];
+            snprintf(label, sizeof(label), "%s%s %.2f ms", stage.gpu ? "GPU " : "", stage.name.c_str(), stage.last());
+            ImGui::PlotLines(label, stage.history.data(), Profiler::HISTORY, stage.head, 
+                             nullptr, 0.0f, FLT_MAX, ImVec2(200, 30));
+        }
+        if (ImGui::Button(profiler.isTracing() ? "Stop Trace" : "Start Trace")) {
+            if (profiler.isTracing()) profiler.stopTrace();
+            else profiler.startTrace("trace.json");
+        }
+    }
     
     ImGui::End();
 }
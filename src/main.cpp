@@ -2,22 +2,154 @@
 #include "opengl_includes.h"
 #include "graphics/graphics_engine.h"
 #include "graphics/camera.h"
+#include "graphics/frame_capture.h"
+#include "graphics/virtual_texture.h"
+#include "graphics/star_field.h"
 #include "physics/physics_engine.h"
+#include "physics/spherical_harmonics.h"
+#include "physics/sgp4.h"
+#include "physics/conjunction.h"
+#include "physics/collisions.h"
 #include "simulation.h"
 #include "utils.h"
 #include "gui.h"
+#include "profiler.h"
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <filesystem>
+
+// batch run without a display: fixed frame step, every frame written to outputDir
+static int runHeadless(const std::string& outputDir, int frameCount, float simSpeed, CaptureFormat format,
+                       const std::string& tracePath, const std::string& tlePath, double screenDistance,
+                       bool lunarEvents, double maxDrift) {
+    std::filesystem::create_directories(outputDir);
+    std::shared_ptr<GraphicsEngine> gEng = std::make_shared<GraphicsEngine>("Astral Engine v1.0.0", 1920, 1080, true);
+    OrbitalCamera cam(gEng->window, 5e7f, 1e6f, 1e22f, 0.01f, 0.01f, 10.0f);
+    cam.depthMode = gEng->getDepthMode();
+    std::shared_ptr<PhysicsEngine> pEng = std::make_shared<PhysicsEngine>();
+    DriftMonitor* drift = pEng->getDriftMonitor();
+    drift->throttle = maxDrift > 0.0;
+    if (maxDrift > 0.0) drift->tolerance = maxDrift;
+    Simulation sim(gEng, pEng);
+    if (!tlePath.empty()) sim.loadTleCatalog(tlePath);
+    if (screenDistance > 0.0) sim.enableConjunctionScreening(screenDistance);
+    if (lunarEvents) sim.logLunarEvents();
+
+    Profiler& profiler = Profiler::get();
+    if (!tracePath.empty()) profiler.startTrace(tracePath);
+    gEng->startCapture(outputDir, format);
+    const double frameDT = 1.0 / 60.0;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        profiler.beginFrame();
+        sim.update(cam, frameDT * simSpeed * drift->speedScale());
+        gEng->finishRender();
+        profiler.endFrame();
+    }
+    gEng->stopCapture();
+    printf("Wrote %d frames to %s\n", frameCount, outputDir.c_str());
+    drift->printStats();
+    if (const ConjunctionScreener* screener = sim.getConjunctionScreener())
+        screener->printStats();
+
+    sim.clear();
+    cam.cleanup();
+    profiler.cleanup();
+    gEng->cleanup();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // --headless <dir> [--frames N] [--speed X] [--raw] [--trace file.json]
+    // --speed X: sim speed to start at, in the GUI as well
+    // --tle <catalog.txt>: track every object of a TLE catalog with SGP4
+    // --screen <km>: report conjunctions between tracked objects closer than km
+    // --max-drift <tolerance>: slow the sim down while a step drifts energy or momentum by more than tolerance
+    // --events: print the Moon's perigees, apogees and penumbra passages as they happen
+    // --bake-vt <image> <dir>: write a virtual texture tile pyramid and exit
+    // --convert-stars <catalog.csv> <out.bin>: write a binary star catalog and exit
+    // --bench-gravity [maxDegree] [satellites]: time spherical-harmonic gravity against degree and exit
+    // --bench-sgp4 [objects]: time SGP4 over a synthetic catalog and exit
+    // --bench-conjunctions [objects] [hours] [km]: screen a synthetic catalog and exit
+    // --bench-collisions [particles]: time collision detection over a particle ring and exit
+    bool headless = false;
+    std::string outputDir = "frames";
+    int frameCount = 600;
+    float simSpeed = 1.0f;
+    CaptureFormat format = CaptureFormat::PNG;
+    std::string tracePath;
+    std::string tlePath;
+    double screenDistance = 0.0;
+    bool lunarEvents = false;
+    double maxDrift = 0.0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--headless")) {
+            headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') outputDir = argv[++i];
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frameCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--speed") && i + 1 < argc) {
+            simSpeed = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--raw")) {
+            format = CaptureFormat::Raw;
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (!strcmp(argv[i], "--tle") && i + 1 < argc) {
+            tlePath = argv[++i];
+        } else if (!strcmp(argv[i], "--screen") && i + 1 < argc) {
+            screenDistance = atof(argv[++i]) * 1e3;
+        } else if (!strcmp(argv[i], "--max-drift") && i + 1 < argc) {
+            maxDrift = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--events")) {
+            lunarEvents = true;
+        } else if (!strcmp(argv[i], "--bake-vt") && i + 2 < argc) {
+            return VirtualTextureSystem::bake(argv[i + 1], argv[i + 2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (!strcmp(argv[i], "--convert-stars") && i + 2 < argc) {
+            return StarField::convertCatalog(argv[i + 1], argv[i + 2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (!strcmp(argv[i], "--bench-gravity")) {
+            int maxDegree = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 64;
+            int satellites = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 10000;
+            SphericalHarmonicGravity::benchmark(maxDegree, satellites);
+            return EXIT_SUCCESS;
+        } else if (!strcmp(argv[i], "--bench-sgp4")) {
+            int objects = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 30000;
+            Sgp4Catalog::benchmark(objects);
+            return EXIT_SUCCESS;
+        } else if (!strcmp(argv[i], "--bench-conjunctions")) {
+            int objects = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 20000;
+            double hours = i + 1 < argc && argv[i + 1][0] != '-' ? atof(argv[++i]) : 6.0;
+            double km = i + 1 < argc && argv[i + 1][0] != '-' ? atof(argv[++i]) : 5.0;
+            ConjunctionScreener::benchmark(objects, hours, km * 1e3);
+            return EXIT_SUCCESS;
+        } else if (!strcmp(argv[i], "--bench-collisions")) {
+            int particles = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 1000000;
+            CollisionSystem::benchmark(particles);
+            return EXIT_SUCCESS;
+        }
+    }
+    if (headless)
+        return runHeadless(outputDir, frameCount, simSpeed, format, tracePath, tlePath, screenDistance, lunarEvents, maxDrift);
 
-int main() {
     std::shared_ptr<GraphicsEngine> gEng = std::make_shared<GraphicsEngine>("Astral Engine v1.0.0", 1600, 900);
     GUI gui(gEng->window);
+    gui.slider_sim_speed = simSpeed;
     OrbitalCamera cam(gEng->window, 5e7f, 1e6f, 1e22f, 0.01f, 0.01f, 10.0f);
+    cam.depthMode = gEng->getDepthMode();
     std::shared_ptr<PhysicsEngine> pEng = std::make_shared<PhysicsEngine>();
+    DriftMonitor* drift = pEng->getDriftMonitor();
+    drift->throttle = maxDrift > 0.0;
+    if (maxDrift > 0.0) drift->tolerance = maxDrift;
     Simulation sim(gEng, pEng);
+    if (!tlePath.empty()) sim.loadTleCatalog(tlePath);
+    if (screenDistance > 0.0) sim.enableConjunctionScreening(screenDistance);
+    if (lunarEvents) sim.logLunarEvents();
 
+    Profiler& profiler = Profiler::get();
     double lastTime = glfwGetTime();
     while (!glfwWindowShouldClose(gEng->window)) {
+        profiler.beginFrame();
         double now = glfwGetTime();
         double dT = now - lastTime;   // seconds since last frame
         gui.newFrame();
@@ -26,17 +158,26 @@ int main() {
         //     sim.update(cam, gui.btn_paused ? 0 : dT * gui.slider_sim_speed);
         //     lastTime = now;
         // }
-        sim.update(cam, gui.btn_paused ? 0 : dT * gui.slider_sim_speed);
+        // steps, syncs and renders the scene
+        sim.update(cam, gui.btn_paused ? 0 : dT * gui.slider_sim_speed * drift->speedScale());
     
-        gEng->renderScene(cam);
-        gui.drawElements();
-        gui.render();
+        gui.drawElements(gEng->getStats(), *drift);
+        {
+            PROFILE_SCOPE("imgui");
+            profiler.beginGPU("imgui");
+            gui.render();
+            profiler.endGPU();
+        }
         gEng->finishRender();
+        profiler.endFrame();
     }
 
+    if (const ConjunctionScreener* screener = sim.getConjunctionScreener())
+        screener->printStats();
     sim.clear(); 
     cam.cleanup();
     gui.cleanup();
+    profiler.cleanup();
     gEng->cleanup();
 
     return 0;
@@ -0,0 +1,97 @@
+#include "mapped_file.h"
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    ptr = (const uint8_t*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    length = (size_t) fileSize.QuadPart;
+    if (!ptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mapping) CloseHandle(mapping);
+    if (fileHandle) CloseHandle(fileHandle);
+    ptr = nullptr;
+    mapping = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close();
+        return false;
+    }
+    void* p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        close();
+        return false;
+    }
+    ptr = (const uint8_t*) p;
+    length = (size_t) st.st_size;
+    madvise(p, length, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) munmap((void*) ptr, length);
+    if (fd >= 0) ::close(fd);
+    ptr = nullptr;
+    length = 0;
+    fd = -1;
+}
+
+#endif
+
+const uint8_t* MappedFile::data() const {
+    return ptr;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
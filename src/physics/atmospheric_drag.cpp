@@ -0,0 +1,193 @@
+#include "physics/atmospheric_drag.h"
+#include "physics/force_model.h"
+#include "physics/simd.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <cmath>
+
+// participant pairs per worker chunk
+constexpr size_t DRAG_GRAIN = 512;
+
+// ---------------- AtmosphericDrag ----------------
+
+const char* AtmosphericDrag::name() const {
+    return "drag";
+}
+
+template <typename LogDensity>
+void AtmosphericDrag::resample(Atmosphere& atmosphere, double top, LogDensity logDensity) {
+    size_t cells = std::max<size_t>(1, (size_t) std::ceil(top / TABLE_STEP));
+    atmosphere.top = top;
+    atmosphere.logRho.resize(cells + 1);
+    atmosphere.slope.resize(cells + 1);
+    for (size_t i = 0; i <= cells; ++i)
+        atmosphere.logRho[i] = logDensity(std::min(i * TABLE_STEP, top));
+    for (size_t i = 0; i < cells; ++i)
+        atmosphere.slope[i] = atmosphere.logRho[i + 1] - atmosphere.logRho[i];
+    atmosphere.slope[cells] = 0.0;
+}
+
+void AtmosphericDrag::setExponential(int centralID, double radius, double rho0, double scaleHeight, double maxAltitude) {
+    if (rho0 <= 0.0 || scaleHeight <= 0.0 || maxAltitude <= 0.0) {
+        fprintf(stderr, "Atmosphere of %d: density, scale height and top must be positive\n", centralID);
+        return;
+    }
+    Atmosphere& atmosphere = atmospheres[centralID];
+    atmosphere.radius = radius;
+    double logRho0 = std::log(rho0);
+    resample(atmosphere, maxAltitude, [&](double h) { return logRho0 - h / scaleHeight; });
+}
+
+bool AtmosphericDrag::setTable(int centralID, double radius, const std::vector<double>& altitudes,
+                               const std::vector<double>& densities) {
+    bool valid = altitudes.size() >= 2 && altitudes.size() == densities.size();
+    for (size_t j = 0; valid && j < altitudes.size(); ++j)
+        valid = densities[j] > 0.0 && (j == 0 || altitudes[j] > altitudes[j - 1]);
+    if (!valid || altitudes.back() <= 0.0) {
+        fprintf(stderr, "Atmosphere of %d: need two or more positive densities at increasing altitudes\n", centralID);
+        return false;
+    }
+
+    Atmosphere& atmosphere = atmospheres[centralID];
+    atmosphere.radius = radius;
+    // the end segments extend past the first sample and up to the top
+    resample(atmosphere, altitudes.back(), [&](double h) {
+        size_t j = std::upper_bound(altitudes.begin() + 1, altitudes.end() - 1, h) - altitudes.begin() - 1;
+        double t = (h - altitudes[j]) / (altitudes[j + 1] - altitudes[j]);
+        return std::log(densities[j]) + t * (std::log(densities[j + 1]) - std::log(densities[j]));
+    });
+    return true;
+}
+
+void AtmosphericDrag::setRotation(int centralID, const glm::dvec3& spinAxis, double rate) {
+    atmospheres[centralID].omega = glm::normalize(spinAxis) * rate;
+}
+
+void AtmosphericDrag::removeAtmosphere(int centralID) {
+    atmospheres.erase(centralID);
+}
+
+void AtmosphericDrag::setBody(int id, double ballisticCoefficient) {
+    if (ballisticCoefficient <= 0.0) {
+        fprintf(stderr, "Body %d: ballistic coefficient must be positive\n", id);
+        return;
+    }
+    ballistic[id] = ballisticCoefficient;
+}
+
+void AtmosphericDrag::removeBody(int id) {
+    ballistic.erase(id);
+}
+
+size_t AtmosphericDrag::bodyCount() const {
+    return ballistic.size();
+}
+
+double AtmosphericDrag::ballisticCoefficient(double mass, double area, double dragCoefficient) {
+    return mass / (dragCoefficient * area);
+}
+
+double AtmosphericDrag::density(int centralID, double altitude) const {
+    auto it = atmospheres.find(centralID);
+    if (it == atmospheres.end() || altitude >= it->second.top) return 0.0;
+    const Atmosphere& atmosphere = it->second;
+    double u = std::max(altitude, 0.0) / TABLE_STEP;
+    size_t i = std::min((size_t) u, atmosphere.logRho.size() - 1);
+    return std::exp(atmosphere.logRho[i] + atmosphere.slope[i] * (u - i));
+}
+
+void AtmosphericDrag::pack(const BodyBatch& batch, int central, const Atmosphere& atmosphere) {
+    glm::dvec3 center(batch.x[central], batch.y[central], batch.z[central]);
+    glm::dvec3 centerVel(batch.vx[central], batch.vy[central], batch.vz[central]);
+    double ceiling = atmosphere.radius + atmosphere.top;
+
+    batchIndex.clear();
+    for (std::vector<double>* v : { &px, &py, &pz, &pvx, &pvy, &pvz, &invBallistic })
+        v->clear();
+    for (auto& [id, B] : ballistic) {
+        int i = batch.find(id);
+        if (i < 0 || i == central) continue;
+        glm::dvec3 rel = glm::dvec3(batch.x[i], batch.y[i], batch.z[i]) - center;
+        if (glm::dot(rel, rel) >= ceiling * ceiling) continue;
+        glm::dvec3 vel = glm::dvec3(batch.vx[i], batch.vy[i], batch.vz[i]) - centerVel;
+        batchIndex.push_back(i);
+        px.push_back(rel.x);
+        py.push_back(rel.y);
+        pz.push_back(rel.z);
+        pvx.push_back(vel.x);
+        pvy.push_back(vel.y);
+        pvz.push_back(vel.z);
+        invBallistic.push_back(1.0 / B);
+    }
+    count = batchIndex.size();
+    // the pad lane sits on the surface and has no area
+    if (count % 2) {
+        px.push_back(atmosphere.radius);
+        for (std::vector<double>* v : { &py, &pz, &pvx, &pvy, &pvz, &invBallistic })
+            v->push_back(0.0);
+    }
+    outX.resize(px.size());
+    outY.resize(px.size());
+    outZ.resize(px.size());
+}
+
+void AtmosphericDrag::kernel(const Atmosphere& atmosphere, size_t begin, size_t end) {
+    const double* logRho = atmosphere.logRho.data();
+    const double* slope = atmosphere.slope.data();
+    const Double2 zero(0.0), half(0.5), radius(atmosphere.radius), invStep(1.0 / TABLE_STEP);
+    const Double2 lastCell(double(atmosphere.logRho.size() - 1));
+    const Double2 wx(atmosphere.omega.x), wy(atmosphere.omega.y), wz(atmosphere.omega.z);
+    for (size_t k = begin; k < end; k += 2) {
+        Double2 x = Double2::load(&px[k]), y = Double2::load(&py[k]), z = Double2::load(&pz[k]);
+        Double2 r = sqrt(x * x + y * y + z * z);
+
+        // table lookup: the index and fraction per lane, the interpolation in both
+        double u[2], l[2], s[2];
+        min(max((r - radius) * invStep, zero), lastCell).store(u);
+        for (int lane = 0; lane < 2; ++lane) {
+            size_t i = (size_t) u[lane];
+            l[lane] = logRho[i];
+            s[lane] = slope[i];
+            u[lane] -= double(i);
+        }
+        Double2 rho = exp(Double2::load(l) + Double2::load(s) * Double2::load(u));
+
+        // velocity relative to the co-rotating air, v - omega x r
+        Double2 vx = Double2::load(&pvx[k]) - (wy * z - wz * y);
+        Double2 vy = Double2::load(&pvy[k]) - (wz * x - wx * z);
+        Double2 vz = Double2::load(&pvz[k]) - (wx * y - wy * x);
+        Double2 speed = sqrt(vx * vx + vy * vy + vz * vz);
+
+        // a = -1/2 rho |v| v Cd A / m
+        Double2 scale = -(half * rho * speed * Double2::load(&invBallistic[k]));
+        (scale * vx).store(&outX[k]);
+        (scale * vy).store(&outY[k]);
+        (scale * vz).store(&outZ[k]);
+    }
+}
+
+void AtmosphericDrag::evaluate(BodyBatch& batch, ThreadPool& workers) {
+    PROFILE_SCOPE("drag");
+    if (ballistic.empty()) return;
+    for (auto& [centralID, atmosphere] : atmospheres) {
+        int c = batch.find(centralID);
+        if (c < 0 || atmosphere.logRho.empty()) continue;
+        pack(batch, c, atmosphere);
+        if (count == 0) continue;
+
+        workers.parallelFor(px.size() / 2, DRAG_GRAIN, [&](size_t begin, size_t end, size_t) {
+            kernel(atmosphere, 2 * begin, 2 * end);
+        });
+
+        for (size_t k = 0; k < count; ++k) {
+            int i = batchIndex[k];
+            batch.ax[i] += outX[k];
+            batch.ay[i] += outY[k];
+            batch.az[i] += outZ[k];
+        }
+    }
+}
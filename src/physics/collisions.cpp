@@ -0,0 +1,253 @@
+#include "physics/collisions.h"
+#include "physics/physics_engine.h"
+#include "physics/spatial_hash.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cmath>
+
+// bodies per worker chunk
+constexpr size_t COLLISION_GRAIN = 4096;
+// bodies whose neighbor buckets are fetched ahead of the one being tested:
+// bounds at PREFETCH_AHEAD, items at half that
+constexpr size_t PREFETCH_AHEAD = 16;
+
+// the cell itself and the 13 neighbors after it in (x, y, z) order; every
+// pair of adjacent cells is visited from exactly one side
+static const int NEIGHBORS[14][3] = {
+    { 0, 0, 0 },
+    { 1, 0, 0 }, { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+    { -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 }, { -1, 0, 1 }, { 0, 0, 1 },
+    { 1, 0, 1 }, { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+};
+
+// ---------------- CollisionSystem ----------------
+
+void CollisionSystem::setResponse(int id, CollisionResponse response) {
+    responses[id] = response;
+}
+
+void CollisionSystem::clearResponse(int id) {
+    responses.erase(id);
+}
+
+CollisionResponse CollisionSystem::responseOf(int id) const {
+    auto it = responses.find(id);
+    return it == responses.end() ? defaultResponse : it->second;
+}
+
+const std::vector<Contact>& CollisionSystem::getContacts() const {
+    return contacts;
+}
+
+void CollisionSystem::gather(const std::unordered_map<int, PhysObj*>& physObjs) {
+    ids.clear();
+    objs.clear();
+    centers.clear();
+    radii.clear();
+    for (auto& [id, obj] : physObjs) {
+        if (obj->radius <= 0.0) continue;
+        ids.push_back(id);
+        objs.push_back(obj);
+        centers.push_back(obj->pos);
+        radii.push_back(obj->radius);
+    }
+}
+
+void CollisionSystem::detect(ThreadPool& workers) {
+    size_t n = ids.size();
+    pairs.clear();
+    if (n < 2) return;
+
+    // a handful of planets among ring particles would make the cells huge
+    std::vector<double> sorted = radii;
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    double largeRadius = sorted[n / 2] * LARGE_RADIUS_FACTOR;
+    small.clear();
+    large.clear();
+    double maxSmall = 0.0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (radii[i] > largeRadius) {
+            large.push_back(i);
+        } else {
+            small.push_back(i);
+            maxSmall = std::max(maxSmall, radii[i]);
+        }
+    }
+
+    // a diameter per cell: overlapping small bodies sit in the same or adjacent cells
+    double invCell = 0.5 / maxSmall;
+    cells.resize(small.size());
+    for (size_t k = 0; k < small.size(); ++k) {
+        uint32_t i = small[k];
+        const glm::dvec3& c = centers[i];
+        cells[k] = { gridKey(gridCell(c.x, invCell), gridCell(c.y, invCell), gridCell(c.z, invCell)), c, radii[i], i };
+    }
+    hash.build(cells);
+
+    chunkPairs.resize(workers.chunkCount(small.size(), COLLISION_GRAIN));
+    for (auto& list : chunkPairs)
+        list.clear();
+    auto overlap = [](const glm::dvec3& a, double ra, const glm::dvec3& b, double rb) {
+        glm::dvec3 d = b - a;
+        return glm::dot(d, d) < (ra + rb) * (ra + rb);
+    };
+
+    // in table order, so consecutive bodies probe the same blocks
+    workers.parallelFor(small.size(), COLLISION_GRAIN, [&](size_t begin, size_t end, size_t chunk) {
+        auto& out = chunkPairs[chunk];
+        // keys and buckets of the 14 cells around each body in flight
+        uint64_t keys[PREFETCH_AHEAD][14];
+        size_t buckets[PREFETCH_AHEAD][14];
+        const std::vector<Cell>& items = hash.items();
+        auto plan = [&](size_t k) {
+            const glm::dvec3& c = items[k].center;
+            int64_t x = gridCell(c.x, invCell), y = gridCell(c.y, invCell), z = gridCell(c.z, invCell);
+            size_t slot = k % PREFETCH_AHEAD;
+            for (int m = 0; m < 14; ++m) {
+                keys[slot][m] = gridKey(x + NEIGHBORS[m][0], y + NEIGHBORS[m][1], z + NEIGHBORS[m][2]);
+                buckets[slot][m] = hash.bucketOf(keys[slot][m]);
+                hash.prefetchBucket(buckets[slot][m]);
+            }
+        };
+        for (size_t k = begin; k < std::min(end, begin + PREFETCH_AHEAD); ++k)
+            plan(k);
+
+        for (size_t k = begin; k < end; ++k) {
+            if (k + PREFETCH_AHEAD / 2 < end)
+                for (size_t bucket : buckets[(k + PREFETCH_AHEAD / 2) % PREFETCH_AHEAD])
+                    hash.prefetchItems(bucket);
+
+            const Cell& body = items[k];
+            uint32_t i = body.index;
+            size_t slot = k % PREFETCH_AHEAD;
+            for (int m = 0; m < 14; ++m) {
+                uint64_t key = keys[slot][m];
+                size_t bucket = buckets[slot][m];
+                for (const Cell* cell = hash.begin(bucket); cell != hash.end(bucket); ++cell) {
+                    // within its own cell a pair is found from both bodies; keep one
+                    if (cell->key != key || (m == 0 && cell->index <= i)) continue;
+                    if (overlap(body.center, body.radius, cell->center, cell->radius))
+                        out.emplace_back(std::min(i, cell->index), std::max(i, cell->index));
+                }
+            }
+            for (uint32_t j : large)
+                if (overlap(body.center, body.radius, centers[j], radii[j])) out.emplace_back(std::min(i, j), std::max(i, j));
+
+            if (k + PREFETCH_AHEAD < end)
+                plan(k + PREFETCH_AHEAD);
+        }
+    });
+
+    for (auto& list : chunkPairs)
+        pairs.insert(pairs.end(), list.begin(), list.end());
+    for (size_t a = 0; a < large.size(); ++a)
+        for (size_t b = a + 1; b < large.size(); ++b)
+            if (overlap(centers[large[a]], radii[large[a]], centers[large[b]], radii[large[b]]))
+                pairs.emplace_back(std::min(large[a], large[b]), std::max(large[a], large[b]));
+}
+
+void CollisionSystem::update(std::unordered_map<int, PhysObj*>& physObjs, ThreadPool& workers, std::vector<int>& absorbed) {
+    contacts.clear();
+    if (!enabled) return;
+    PROFILE_SCOPE("collisions");
+    gather(physObjs);
+    detect(workers);
+    if (pairs.empty()) return;
+
+    // resolve in id order, each pair from the states left by the ones before
+    for (auto& [i, j] : pairs)
+        if (ids[i] > ids[j]) std::swap(i, j);
+    std::sort(pairs.begin(), pairs.end(), [&](const auto& p, const auto& q) {
+        return ids[p.first] != ids[q.first] ? ids[p.first] < ids[q.first] : ids[p.second] < ids[q.second];
+    });
+    std::vector<bool> gone(ids.size(), false);
+    for (auto [i, j] : pairs) {
+        if (gone[i] || gone[j]) continue;
+        PhysObj* a = objs[i];
+        PhysObj* b = objs[j];
+        glm::dvec3 d = b->pos - a->pos;
+        double dist = glm::length(d);
+        double depth = a->radius + b->radius - dist;
+        if (depth <= 0.0) continue;
+
+        Contact contact;
+        contact.idA = ids[i];
+        contact.idB = ids[j];
+        contact.normal = dist > 0.0 ? d / dist : glm::dvec3(1.0, 0.0, 0.0);
+        contact.depth = depth;
+        contact.closingSpeed = glm::dot(a->vel - b->vel, contact.normal);
+        contact.response = std::max(responseOf(ids[i]), responseOf(ids[j]));
+        contacts.push_back(contact);
+
+        // mass fractions; two massless bodies share equally
+        double mass = a->mass + b->mass;
+        double wa = mass > 0.0 ? a->mass / mass : 0.5;
+        double wb = 1.0 - wa;
+
+        if (contact.response == CollisionResponse::Bounce) {
+            // equal and opposite impulses along the normal, only while approaching
+            if (contact.closingSpeed > 0.0) {
+                double dv = (1.0 + restitution) * contact.closingSpeed;
+                a->vel -= dv * wb * contact.normal;
+                b->vel += dv * wa * contact.normal;
+            }
+            a->pos -= depth * wb * contact.normal;
+            b->pos += depth * wa * contact.normal;
+        } else if (contact.response == CollisionResponse::Merge) {
+            // the heavier body survives, at the center of mass with the summed
+            // momentum and volume
+            bool keepA = a->mass != b->mass ? a->mass > b->mass : contact.idA < contact.idB;
+            PhysObj* keep = keepA ? a : b;
+            keep->pos = wa * a->pos + wb * b->pos;
+            keep->vel = wa * a->vel + wb * b->vel;
+            keep->acc = wa * a->acc + wb * b->acc;
+            keep->radius = std::cbrt(a->radius * a->radius * a->radius + b->radius * b->radius * b->radius);
+            keep->mass = mass;
+            int lost = keepA ? j : i;
+            gone[lost] = true;
+            physObjs.erase(ids[lost]);
+            absorbed.push_back(ids[lost]);
+        }
+    }
+}
+
+void CollisionSystem::benchmark(int particles) {
+    particles = std::max(particles, 1000);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    ThreadPool workers;
+    printf("%u threads\n", workers.size() + 1);
+
+    // Saturn and a ring, spaced so some particles touch
+    for (int count = particles / 100; count <= particles; count *= 10) {
+        std::vector<PhysObj> bodies(count + 1);
+        std::unordered_map<int, PhysObj*> physObjs;
+        bodies[0] = PhysObj(glm::dvec3(0.0), glm::dvec3(0.0), 5.683e26, 5.8232e7);
+        physObjs[0] = &bodies[0];
+        double particleRadius = 4e7 / std::sqrt((double) count);
+        for (int i = 1; i <= count; ++i) {
+            double r = 6.7e7 + 7.3e7 * unit(rng), theta = 2.0 * M_PI * unit(rng);
+            glm::dvec3 pos(r * std::cos(theta), r * std::sin(theta), 1e4 * (unit(rng) - 0.5));
+            bodies[i] = PhysObj(pos, glm::dvec3(0.0), 1e3, particleRadius * (0.5 + unit(rng)));
+            physObjs[i] = &bodies[i];
+        }
+
+        CollisionSystem system;
+        system.defaultResponse = CollisionResponse::Flag;
+        std::vector<int> absorbed;
+        system.update(physObjs, workers, absorbed); // warm up
+        const int reps = 5;
+        auto start = std::chrono::steady_clock::now();
+        for (int rep = 0; rep < reps; ++rep)
+            system.update(physObjs, workers, absorbed);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / reps;
+        printf("%8d particles: %8.2f ms per step, %6.1f ns per particle, %zu contacts\n",
+               count, ms, ms * 1e6 / count, system.getContacts().size());
+    }
+}
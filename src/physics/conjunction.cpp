@@ -0,0 +1,475 @@
+#include "physics/conjunction.h"
+#include "physics/physics_engine.h"
+#include "physics/sgp4.h"
+#include "physics/spatial_hash.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include <cstdio>
+#include <cmath>
+
+constexpr double PI = 3.14159265358979323846;
+// refinements of one encounter from both sides of a bin edge merge under this (s)
+constexpr double TCA_MERGE = 1.0;
+constexpr int MAX_DEGREE = 5;
+// bins longer than this many sample intervals are counted and warned about
+constexpr double LONG_BIN = 1.5;
+
+struct ConjunctionScreener::Orbit {
+    bool bound = false;             // elliptic about the central body
+    double perigee = 0.0, apogee = 0.0; // m from the central body's center
+    double p = 0.0, e = 0.0;        // semi-latus rectum (m), eccentricity
+    glm::dvec3 normal = glm::dvec3(0.0), periapsis = glm::dvec3(0.0); // unit vectors
+};
+
+struct ConjunctionScreener::Scratch {
+    struct Entry {
+        uint64_t key;
+        uint32_t slot;
+        glm::dvec3 lo, hi;  // the body's box, copied so a bucket scans contiguously
+    };
+    std::vector<Entry> entries;  // one per cell a box overlaps
+    SpatialHash<Entry> hash;
+    std::vector<ConjunctionScreener::Orbit> orbits; // at the start of this bin
+    std::vector<Conjunction> found;
+    size_t boxPairs = 0, bandPairs = 0, pathPairs = 0;
+    double maxExtent = 0.0;
+};
+
+// ---------------- helpers ----------------
+
+static double evaluate(const double* c, int n, double t) {
+    double v = c[n];
+    for (int i = n - 1; i >= 0; --i)
+        v = v * t + c[i];
+    return v;
+}
+
+// real roots in [0, 1] of the degree n polynomial c (ascending coefficients),
+// ascending. The roots of its derivative split [0, 1] into monotone pieces
+// holding at most one root each, found by Newton kept inside the bracket.
+static int polynomialRoots(const double* c, int n, double* roots) {
+    while (n > 0 && c[n] == 0.0) --n;
+    if (n == 0) return 0;
+    if (n == 1) {
+        double t = -c[0] / c[1];
+        if (t < 0.0 || t > 1.0) return 0;
+        roots[0] = t;
+        return 1;
+    }
+
+    double d[MAX_DEGREE];
+    for (int i = 0; i < n; ++i)
+        d[i] = (i + 1) * c[i + 1];
+    double breaks[MAX_DEGREE + 1];
+    int pieces = polynomialRoots(d, n - 1, breaks + 1) + 1;
+    breaks[0] = 0.0;
+    breaks[pieces] = 1.0;
+
+    int count = 0;
+    for (int k = 0; k < pieces; ++k) {
+        double lo = breaks[k], hi = breaks[k + 1];
+        double flo = evaluate(c, n, lo), fhi = evaluate(c, n, hi);
+        if (flo == 0.0) {
+            if (count == 0 || lo - roots[count - 1] > 1e-12) roots[count++] = lo;
+            continue;
+        }
+        if ((flo < 0.0) == (fhi < 0.0) && fhi != 0.0) continue;
+
+        double t = 0.5 * (lo + hi);
+        for (int it = 0; it < 64; ++it) {
+            double f = evaluate(c, n, t);
+            if (f == 0.0) break;
+            if ((f < 0.0) == (flo < 0.0)) lo = t; else hi = t;
+            double df = evaluate(d, n - 1, t);
+            double next = df != 0.0 ? t - f / df : lo - 1.0;
+            if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+            bool converged = std::abs(next - t) < 1e-14;
+            t = next;
+            if (converged) break;
+        }
+        roots[count++] = t;
+    }
+    return count;
+}
+
+// box around the cubic Hermite curve between two states, h seconds apart:
+// the hull of its Bezier control points
+static void sweptBox(const glm::dvec3& p0, const glm::dvec3& v0, const glm::dvec3& p1, const glm::dvec3& v1,
+                     double h, glm::dvec3& lo, glm::dvec3& hi) {
+    glm::dvec3 c1 = p0 + v0 * (h / 3.0), c2 = p1 - v1 * (h / 3.0);
+    lo = glm::min(glm::min(p0, p1), glm::min(c1, c2));
+    hi = glm::max(glm::max(p0, p1), glm::max(c1, c2));
+}
+
+// osculating conic of a state about a body of gravitational parameter mu
+static ConjunctionScreener::Orbit osculating(const glm::dvec3& r, const glm::dvec3& v, double mu) {
+    ConjunctionScreener::Orbit o;
+    glm::dvec3 h = glm::cross(r, v);
+    double hn = glm::length(h), rn = glm::length(r);
+    if (hn == 0.0 || rn == 0.0) return o;
+    glm::dvec3 ecc = glm::cross(v, h) / mu - r / rn;
+    o.e = glm::length(ecc);
+    o.p = hn * hn / mu;
+    o.bound = o.e < 1.0 && 0.5 * glm::dot(v, v) - mu / rn < 0.0;
+    o.perigee = o.p / (1.0 + o.e);
+    o.apogee = o.bound ? o.p / (1.0 - o.e) : std::numeric_limits<double>::infinity();
+    o.normal = h / hn;
+    o.periapsis = o.e > 1e-12 ? ecc / o.e : r / rn;
+    return o;
+}
+
+// ---------------- ConjunctionScreener ----------------
+
+ConjunctionScreener::ConjunctionScreener(double distance, double sampleInterval, int binsPerWindow)
+    : distance(distance), sampleInterval(sampleInterval), binsPerWindow(std::max(binsPerWindow, 1)) {}
+
+ConjunctionScreener::~ConjunctionScreener() = default;
+
+void ConjunctionScreener::setCentral(const PhysObj* body, double centralMu) {
+    central = body;
+    mu = centralMu;
+}
+
+void ConjunctionScreener::addObject(int id, const PhysObj* obj) {
+    objects[id] = obj;
+}
+
+void ConjunctionScreener::removeObject(int id) {
+    objects.erase(id);
+    auto it = std::find(slotIDs.begin(), slotIDs.end(), id);
+    if (it != slotIDs.end()) slotObjs[it - slotIDs.begin()] = nullptr;
+}
+
+size_t ConjunctionScreener::objectCount() const {
+    return objects.size();
+}
+
+const std::vector<Conjunction>& ConjunctionScreener::getConjunctions() const {
+    return conjunctions;
+}
+
+const ConjunctionScreener::Stats& ConjunctionScreener::getStats() const {
+    return stats;
+}
+
+double ConjunctionScreener::conjunctionsPerComputeHour() const {
+    return stats.computeTime > 0.0 ? stats.conjunctions * 3600.0 / stats.computeTime : 0.0;
+}
+
+void ConjunctionScreener::printStats() const {
+    printf("Conjunction screening: %zu windows, %.1f h screened in %.2f s\n",
+           stats.windows, stats.screenedTime / 3600.0, stats.computeTime);
+    printf("  %zu box pairs -> %zu apogee/perigee -> %zu orbit path -> %zu under %.1f km\n",
+           stats.boxPairs, stats.bandPairs, stats.pathPairs, stats.conjunctions, distance * 1e-3);
+    printf("  %.0f conjunctions per hour of compute\n", conjunctionsPerComputeHour());
+    if (stats.longBins > 0)
+        printf("  %zu bins longer than the %.0f s sample interval\n", stats.longBins, sampleInterval);
+}
+
+void ConjunctionScreener::startWindow() {
+    slotIDs.clear();
+    slotObjs.clear();
+    for (auto& [id, obj] : objects)
+        slotIDs.push_back(id);
+    std::sort(slotIDs.begin(), slotIDs.end());
+    for (int id : slotIDs)
+        slotObjs.push_back(objects[id]);
+    times.clear();
+    positions.clear();
+    velocities.clear();
+}
+
+void ConjunctionScreener::record(double time) {
+    glm::dvec3 origin = central ? central->pos : glm::dvec3(0.0);
+    glm::dvec3 originVel = central ? central->vel : glm::dvec3(0.0);
+    times.push_back(time);
+    for (const PhysObj* obj : slotObjs) {
+        positions.push_back(obj ? obj->pos - origin : glm::dvec3(0.0));
+        velocities.push_back(obj ? obj->vel - originVel : glm::dvec3(0.0));
+    }
+}
+
+size_t ConjunctionScreener::sample(double time, ThreadPool& workers) {
+    // a restart or a cleared engine: begin again
+    if (!times.empty() && time < times.back()) times.clear();
+    if (times.empty()) {
+        startWindow();
+        record(time);
+        return 0;
+    }
+    if (time < nextSampleTime()) return 0;
+
+    if (time - times.back() > LONG_BIN * sampleInterval) {
+        if (stats.longBins++ == 0)
+            fprintf(stderr, "Conjunction screening: %.0f s bin for a %.0f s interval, encounters may be missed\n",
+                    time - times.back(), sampleInterval);
+    }
+    record(time);
+    if ((int) times.size() <= binsPerWindow) return 0;
+    size_t found = screen(workers);
+    // the last sample opens the next window, with any bodies added since
+    startWindow();
+    record(time);
+    return found;
+}
+
+double ConjunctionScreener::nextSampleTime() const {
+    return times.empty() ? std::numeric_limits<double>::infinity() : times.back() + sampleInterval;
+}
+
+void ConjunctionScreener::sieve() {
+    std::vector<uint32_t> order;
+    for (size_t s = 0; s < slotIDs.size(); ++s)
+        if (slotObjs[s]) order.push_back((uint32_t) s);
+    if (!central || mu <= 0.0) {
+        screened = order;
+        return;
+    }
+
+    // sorted by perigee, a body is alone when the highest apogee below it
+    // and the next perigee above it are both out of reach
+    std::vector<Orbit> orbits(slotIDs.size());
+    for (uint32_t s : order)
+        orbits[s] = osculating(positions[s], velocities[s], mu);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return orbits[a].perigee < orbits[b].perigee; });
+    double reach = distance + SIEVE_MARGIN;
+    double highest = -std::numeric_limits<double>::infinity();
+    screened.clear();
+    for (size_t k = 0; k < order.size(); ++k) {
+        const Orbit& o = orbits[order[k]];
+        bool below = highest + reach >= o.perigee || !o.bound;
+        bool above = k + 1 < order.size() && orbits[order[k + 1]].perigee <= o.apogee + reach;
+        if (below || above) screened.push_back(order[k]);
+        highest = std::max(highest, o.apogee);
+    }
+    std::sort(screened.begin(), screened.end());
+}
+
+bool ConjunctionScreener::filterPair(uint32_t a, uint32_t b, Scratch& out) const {
+    const Orbit& A = out.orbits[a];
+    const Orbit& B = out.orbits[b];
+    if (!central || !A.bound || !B.bound) {
+        ++out.bandPairs;
+        ++out.pathPairs;
+        return true;
+    }
+
+    // apogee/perigee: the radial bands of the two orbits must come within reach
+    double reach = distance + FILTER_MARGIN;
+    if (std::max(A.perigee, B.perigee) - std::min(A.apogee, B.apogee) > reach) return false;
+    ++out.bandPairs;
+
+    // orbit path: away from coplanar, the orbits only meet near the line of
+    // nodes. Out of plane separation rules out more than du from it, so the
+    // radii there differ by at most dr/du du from those at the nodes.
+    glm::dvec3 nodes = glm::cross(A.normal, B.normal);
+    double sinI = glm::length(nodes);
+    if (sinI > 1e-9) {
+        nodes /= sinI;
+        double below = std::min(A.perigee, B.perigee) * sinI;
+        double du = reach < below ? std::asin(reach / below) : 0.5 * PI;
+        // dr/dnu = r^2 e sin(nu) / p, at most apogee^2 e / p
+        double slack = reach + (A.apogee * A.apogee * A.e / A.p + B.apogee * B.apogee * B.e / B.p) * du;
+        bool near = false;
+        for (double side : { 1.0, -1.0 }) {
+            double rA = A.p / (1.0 + A.e * side * glm::dot(nodes, A.periapsis));
+            double rB = B.p / (1.0 + B.e * side * glm::dot(nodes, B.periapsis));
+            near |= std::abs(rA - rB) <= slack;
+        }
+        if (!near) return false;
+    }
+    ++out.pathPairs;
+    return true;
+}
+
+void ConjunctionScreener::refinePair(uint32_t a, uint32_t b, size_t bin, Scratch& out) const {
+    size_t slots = slotIDs.size();
+    size_t s0 = bin * slots, s1 = s0 + slots;
+    double h = times[bin + 1] - times[bin];
+
+    // relative cubic Hermite curve in tau = (t - t0) / h
+    glm::dvec3 p0 = positions[s0 + b] - positions[s0 + a];
+    glm::dvec3 p1 = positions[s1 + b] - positions[s1 + a];
+    glm::dvec3 v0 = (velocities[s0 + b] - velocities[s0 + a]) * h;
+    glm::dvec3 v1 = (velocities[s1 + b] - velocities[s1 + a]) * h;
+    glm::dvec3 c[4] = { p0, v0, 3.0 * (p1 - p0) - 2.0 * v0 - v1, 2.0 * (p0 - p1) + v0 + v1 };
+    glm::dvec3 dc[3] = { c[1], 2.0 * c[2], 3.0 * c[3] };
+
+    // r . r' = 1/2 d|r|^2/dtau, a quintic; minima where it turns positive
+    double f[MAX_DEGREE + 1] = {};
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 3; ++j)
+            f[i + j] += glm::dot(c[i], dc[j]);
+    double df[MAX_DEGREE];
+    for (int i = 0; i < MAX_DEGREE; ++i)
+        df[i] = (i + 1) * f[i + 1];
+
+    double roots[MAX_DEGREE];
+    int count = polynomialRoots(f, MAX_DEGREE, roots);
+    for (int k = 0; k < count; ++k) {
+        double tau = roots[k];
+        if (tau >= 1.0 || evaluate(df, MAX_DEGREE - 1, tau) < 0.0) continue;
+        glm::dvec3 r = ((c[3] * tau + c[2]) * tau + c[1]) * tau + c[0];
+        double miss = glm::length(r);
+        if (miss > distance) continue;
+        glm::dvec3 rate = (dc[2] * tau + dc[1]) * tau + dc[0];
+        int idA = slotIDs[a], idB = slotIDs[b];
+        out.found.push_back({ std::min(idA, idB), std::max(idA, idB), times[bin] + tau * h, miss, glm::length(rate) / h });
+    }
+}
+
+void ConjunctionScreener::screenBin(size_t bin, double cell, Scratch& out) const {
+    size_t slots = slotIDs.size();
+    size_t s0 = bin * slots, s1 = s0 + slots;
+    double h = times[bin + 1] - times[bin];
+    double invCell = 1.0 / cell;
+    glm::dvec3 grow(0.5 * distance);
+
+    out.entries.clear();
+    out.orbits.resize(slots);
+    for (uint32_t s : screened) {
+        glm::dvec3 lo, hi;
+        sweptBox(positions[s0 + s], velocities[s0 + s], positions[s1 + s], velocities[s1 + s], h, lo, hi);
+        lo -= grow;
+        hi += grow;
+        if (central) out.orbits[s] = osculating(positions[s0 + s], velocities[s0 + s], mu);
+        // at most two cells per axis, as the cell is as wide as the widest box
+        int64_t x0 = gridCell(lo.x, invCell), x1 = gridCell(hi.x, invCell);
+        int64_t y0 = gridCell(lo.y, invCell), y1 = gridCell(hi.y, invCell);
+        int64_t z0 = gridCell(lo.z, invCell), z1 = gridCell(hi.z, invCell);
+        for (int64_t x = x0; x <= x1; ++x)
+            for (int64_t y = y0; y <= y1; ++y)
+                for (int64_t z = z0; z <= z1; ++z)
+                    out.entries.push_back({ gridKey(x, y, z), s, lo, hi });
+    }
+
+    out.hash.build(out.entries);
+    for (size_t bucket = 0; bucket < out.hash.bucketCount(); ++bucket) {
+        const Scratch::Entry* end = out.hash.end(bucket);
+        for (const Scratch::Entry* ea = out.hash.begin(bucket); ea != end; ++ea) {
+            for (const Scratch::Entry* eb = ea + 1; eb != end; ++eb) {
+                if (eb->key != ea->key) continue;
+                glm::dvec3 lo = glm::max(ea->lo, eb->lo);
+                glm::dvec3 hi = glm::min(ea->hi, eb->hi);
+                if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z) continue;
+                // a pair sharing several cells counts in the one holding its overlap's corner
+                if (gridKey(gridCell(lo.x, invCell), gridCell(lo.y, invCell), gridCell(lo.z, invCell)) != ea->key) continue;
+                ++out.boxPairs;
+                if (filterPair(ea->slot, eb->slot, out))
+                    refinePair(ea->slot, eb->slot, bin, out);
+            }
+        }
+    }
+}
+
+size_t ConjunctionScreener::screen(ThreadPool& workers) {
+    PROFILE_SCOPE("conjunctions");
+    auto start = std::chrono::steady_clock::now();
+    size_t bins = times.size() - 1;
+    size_t slots = slotIDs.size();
+    sieve();
+
+    scratch.resize(workers.chunkCount(bins, 1));
+    for (Scratch& s : scratch) {
+        s.found.clear();
+        s.boxPairs = s.bandPairs = s.pathPairs = 0;
+        s.maxExtent = 0.0;
+    }
+
+    // the cell is the widest swept box of the window, grown by the distance
+    workers.parallelFor(bins, 1, [&](size_t begin, size_t end, size_t chunk) {
+        for (size_t bin = begin; bin < end; ++bin) {
+            double h = times[bin + 1] - times[bin];
+            size_t s0 = bin * slots, s1 = s0 + slots;
+            for (uint32_t s : screened) {
+                glm::dvec3 lo, hi;
+                sweptBox(positions[s0 + s], velocities[s0 + s], positions[s1 + s], velocities[s1 + s], h, lo, hi);
+                glm::dvec3 extent = hi - lo;
+                scratch[chunk].maxExtent = std::max(scratch[chunk].maxExtent, std::max(extent.x, std::max(extent.y, extent.z)));
+            }
+        }
+    });
+    double cell = distance;
+    for (const Scratch& s : scratch)
+        cell = std::max(cell, s.maxExtent + distance);
+
+    workers.parallelFor(bins, 1, [&](size_t begin, size_t end, size_t chunk) {
+        for (size_t bin = begin; bin < end; ++bin)
+            screenBin(bin, cell, scratch[chunk]);
+    });
+
+    // one encounter can be refined from both sides of a bin edge
+    std::vector<Conjunction> found;
+    for (const Scratch& s : scratch) {
+        found.insert(found.end(), s.found.begin(), s.found.end());
+        stats.boxPairs += s.boxPairs;
+        stats.bandPairs += s.bandPairs;
+        stats.pathPairs += s.pathPairs;
+    }
+    std::sort(found.begin(), found.end(), [](const Conjunction& x, const Conjunction& y) {
+        if (x.idA != y.idA) return x.idA < y.idA;
+        if (x.idB != y.idB) return x.idB < y.idB;
+        return x.tca < y.tca;
+    });
+    std::vector<Conjunction> merged;
+    for (const Conjunction& c : found) {
+        Conjunction* last = merged.empty() ? nullptr : &merged.back();
+        if (last && last->idA == c.idA && last->idB == c.idB && c.tca - last->tca < TCA_MERGE) {
+            if (c.missDistance < last->missDistance) *last = c;
+            continue;
+        }
+        merged.push_back(c);
+    }
+    std::sort(merged.begin(), merged.end(), [](const Conjunction& x, const Conjunction& y) { return x.tca < y.tca; });
+    conjunctions.insert(conjunctions.end(), merged.begin(), merged.end());
+
+    stats.windows++;
+    stats.conjunctions += merged.size();
+    stats.screenedTime += times.back() - times.front();
+    stats.computeTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return merged.size();
+}
+
+void ConjunctionScreener::benchmark(int objects, double hours, double distance) {
+    Sgp4Catalog catalog;
+    double epoch = Sgp4Catalog::julianDate(std::chrono::system_clock::now());
+    catalog.addSynthetic(std::max(objects, 2), epoch);
+
+    // SGP4 states written into bodies, as the simulation does for tracked objects
+    ThreadPool workers;
+    PhysObj earth;
+    std::vector<PhysObj> bodies(catalog.size());
+    ConjunctionScreener screener(distance);
+    screener.setCentral(&earth, Sgp4Catalog::MU * 1e9);
+    for (size_t i = 0; i < bodies.size(); ++i)
+        screener.addObject((int) i, &bodies[i]);
+    printf("%zu objects, %.1f h, under %.1f km, %u threads\n", bodies.size(), hours, distance * 1e-3, workers.size() + 1);
+
+    std::vector<bool> dropped(bodies.size(), false);
+    for (double t = 0.0; t <= hours * 3600.0; t += screener.sampleInterval) {
+        catalog.propagate(epoch + t / 86400.0, workers);
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            if (dropped[i]) continue;
+            if (catalog.getStatus(i) != 0) {
+                screener.removeObject((int) i);
+                dropped[i] = true;
+                continue;
+            }
+            bodies[i].pos = catalog.getPosition(i);
+            bodies[i].vel = catalog.getVelocity(i);
+        }
+        screener.sample(t, workers);
+    }
+    screener.printStats();
+
+    std::vector<Conjunction> closest = screener.getConjunctions();
+    std::sort(closest.begin(), closest.end(), [](const Conjunction& x, const Conjunction& y) { return x.missDistance < y.missDistance; });
+    for (size_t k = 0; k < std::min<size_t>(closest.size(), 5); ++k)
+        printf("  %5d x %5d at %7.1f s: %6.0f m, %5.0f m/s\n", catalog.getElements(closest[k].idA).catalogNumber,
+               catalog.getElements(closest[k].idB).catalogNumber, closest[k].tca, closest[k].missDistance, closest[k].relativeSpeed);
+}
@@ -0,0 +1,80 @@
+#include "physics/drift_monitor.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+// throttled speed never drops under this, and recovers by this much per clean step
+constexpr float MIN_SPEED_SCALE = 1.0f / 1024.0f;
+constexpr float SPEED_RECOVERY = 1.05f;
+
+// ---------------- DriftMonitor ----------------
+
+void DriftMonitor::reset() {
+    started = false;
+    scale = 1.0f;
+    for (Series& s : series) {
+        s.history.fill(0.0f);
+        s.head = 0;
+        s.drift = s.stepDrift = 0.0;
+    }
+}
+
+void DriftMonitor::push(Series& s, double drift, double stepDrift) {
+    s.drift = drift;
+    s.stepDrift = stepDrift;
+    s.history[s.head] = (float) drift;
+    s.head = (s.head + 1) % HISTORY;
+}
+
+void DriftMonitor::record(const ConservedTotals& totals) {
+    if (!started || totals.bodies != initial.bodies) {
+        reset();
+        started = true;
+        initial = previous = totals;
+        return;
+    }
+
+    // each against the scale of the system it started as
+    double energyScale = initial.kinetic + std::abs(initial.potential);
+    auto relative = [](double change, double scale) { return scale > 0.0 ? change / scale : 0.0; };
+    push(series[0], relative(std::abs(totals.energy() - initial.energy()), energyScale),
+         relative(std::abs(totals.energy() - previous.energy()), energyScale));
+    push(series[1], relative(glm::length(totals.momentum - initial.momentum), initial.momentumScale),
+         relative(glm::length(totals.momentum - previous.momentum), initial.momentumScale));
+    push(series[2], relative(glm::length(totals.angularMomentum - initial.angularMomentum), initial.angularMomentumScale),
+         relative(glm::length(totals.angularMomentum - previous.angularMomentum), initial.angularMomentumScale));
+    previous = totals;
+
+    if (!throttle) {
+        scale = 1.0f;
+    } else {
+        double worst = std::max({ series[0].stepDrift, series[1].stepDrift, series[2].stepDrift });
+        if (worst > tolerance)
+            scale = std::max(scale * 0.5f, MIN_SPEED_SCALE);
+        else if (worst < 0.25 * tolerance)
+            scale = std::min(scale * SPEED_RECOVERY, 1.0f);
+    }
+}
+
+const DriftMonitor::Series& DriftMonitor::energy() const {
+    return series[0];
+}
+
+const DriftMonitor::Series& DriftMonitor::momentum() const {
+    return series[1];
+}
+
+const DriftMonitor::Series& DriftMonitor::angularMomentum() const {
+    return series[2];
+}
+
+float DriftMonitor::speedScale() const {
+    return scale;
+}
+
+void DriftMonitor::printStats() const {
+    if (!started) return;
+    printf("Conservation drift over %.0f s: energy %.3e, momentum %.3e, angular momentum %.3e\n",
+           previous.time - initial.time, series[0].drift, series[1].drift, series[2].drift);
+}
@@ -0,0 +1,233 @@
+#include "physics/events.h"
+#include "physics/physics_engine.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+// Brent's method for a root of f in [a, b], where fa and fb differ in sign
+template <typename F>
+static double brent(F&& f, double a, double b, double fa, double fb, double tolerance) {
+    const double eps = std::numeric_limits<double>::epsilon();
+    double c = b, fc = fb, d = b - a, e = d;
+    for (int iter = 0; iter < EventDetector::MAX_ITERATIONS; ++iter) {
+        // keep the root between b and c
+        if ((fb > 0.0) == (fc > 0.0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        // b is the best guess so far
+        if (std::abs(fc) < std::abs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        double tol = 2.0 * eps * std::abs(b) + 0.5 * tolerance;
+        double mid = 0.5 * (c - b);
+        if (std::abs(mid) <= tol || fb == 0.0) return b;
+
+        if (std::abs(e) >= tol && std::abs(fa) > std::abs(fb)) {
+            // secant when only two points are distinct, otherwise inverse quadratic
+            double s = fb / fa, p, q;
+            if (a == c) {
+                p = 2.0 * mid * s;
+                q = 1.0 - s;
+            } else {
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2.0 * mid * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0) q = -q;
+            p = std::abs(p);
+            // take the interpolation only while it converges faster than bisection
+            if (2.0 * p < std::min(3.0 * mid * q - std::abs(tol * q), std::abs(e * q))) {
+                e = d;
+                d = p / q;
+            } else {
+                d = e = mid;
+            }
+        } else {
+            d = e = mid;
+        }
+        a = b;
+        fa = fb;
+        b += std::abs(d) > tol ? d : (mid > 0.0 ? tol : -tol);
+        fb = f(b);
+    }
+    return b;
+}
+
+// whether the bodies are all integrated, and their states if so
+static bool gatherBodies(const std::vector<int>& bodies, const std::unordered_map<int, PhysObj*>& physObjs,
+                         double time, EventState& state, std::vector<glm::dvec3>& acc) {
+    state.time = time;
+    state.pos.resize(bodies.size());
+    state.vel.resize(bodies.size());
+    acc.resize(bodies.size());
+    for (size_t k = 0; k < bodies.size(); ++k) {
+        auto it = physObjs.find(bodies[k]);
+        if (it == physObjs.end()) return false;
+        state.pos[k] = it->second->pos;
+        state.vel[k] = it->second->vel;
+        acc[k] = it->second->acc;
+    }
+    return true;
+}
+
+// ---------------- EventDetector ----------------
+
+int EventDetector::addEvent(const std::vector<int>& bodies, EventFunction function,
+                            EventDirection direction, EventCallback onHit) {
+    Event event;
+    event.id = nextID++;
+    event.bodies = bodies;
+    event.function = std::move(function);
+    event.direction = direction;
+    event.onHit = std::move(onHit);
+    events.push_back(std::move(event));
+    return events.back().id;
+}
+
+void EventDetector::removeEvent(int eventID) {
+    events.erase(std::remove_if(events.begin(), events.end(), [&](const Event& e) { return e.id == eventID; }),
+                 events.end());
+}
+
+void EventDetector::removeBody(int id) {
+    events.erase(std::remove_if(events.begin(), events.end(), [&](const Event& e) {
+                     return std::find(e.bodies.begin(), e.bodies.end(), id) != e.bodies.end();
+                 }),
+                 events.end());
+}
+
+void EventDetector::clear() {
+    events.clear();
+    hits.clear();
+}
+
+size_t EventDetector::eventCount() const {
+    return events.size();
+}
+
+const std::vector<EventHit>& EventDetector::getHits() const {
+    return hits;
+}
+
+void EventDetector::beginStep(double time, const std::unordered_map<int, PhysObj*>& physObjs) {
+    for (Event& event : events) {
+        event.started = gatherBodies(event.bodies, physObjs, time, event.start, event.acc);
+        if (event.started) event.value = event.function(event.start);
+    }
+}
+
+void EventDetector::interpolate(const Event& event, const EventState& end, const std::vector<glm::dvec3>& endAcc,
+                                double time, EventState& out) const {
+    // quintic Hermite basis on s in [0, 1] and its derivative
+    double h = end.time - event.start.time;
+    double s = (time - event.start.time) / h;
+    double s2 = s * s, s3 = s2 * s, s4 = s3 * s, s5 = s4 * s;
+    double h0 = 1.0 - 10.0 * s3 + 15.0 * s4 - 6.0 * s5;
+    double h1 = s - 6.0 * s3 + 8.0 * s4 - 3.0 * s5;
+    double h2 = 0.5 * s2 - 1.5 * s3 + 1.5 * s4 - 0.5 * s5;
+    double h3 = 0.5 * s3 - s4 + 0.5 * s5;
+    double h4 = -4.0 * s3 + 7.0 * s4 - 3.0 * s5;
+    double h5 = 1.0 - h0;
+    double d0 = -30.0 * s2 + 60.0 * s3 - 30.0 * s4;
+    double d1 = 1.0 - 18.0 * s2 + 32.0 * s3 - 15.0 * s4;
+    double d2 = s - 4.5 * s2 + 6.0 * s3 - 2.5 * s4;
+    double d3 = 1.5 * s2 - 4.0 * s3 + 2.5 * s4;
+    double d4 = -12.0 * s2 + 28.0 * s3 - 15.0 * s4;
+    double d5 = -d0;
+
+    out.time = time;
+    out.pos.resize(event.bodies.size());
+    out.vel.resize(event.bodies.size());
+    for (size_t k = 0; k < event.bodies.size(); ++k) {
+        const glm::dvec3& p0 = event.start.pos[k];
+        const glm::dvec3& v0 = event.start.vel[k];
+        const glm::dvec3& a0 = event.acc[k];
+        const glm::dvec3& p1 = end.pos[k];
+        const glm::dvec3& v1 = end.vel[k];
+        const glm::dvec3& a1 = endAcc[k];
+        out.pos[k] = h0 * p0 + h5 * p1 + h * (h1 * v0 + h4 * v1) + h * h * (h2 * a0 + h3 * a1);
+        out.vel[k] = (d0 * p0 + d5 * p1) / h + d1 * v0 + d4 * v1 + h * (d2 * a0 + d3 * a1);
+    }
+}
+
+void EventDetector::endStep(double time, const std::unordered_map<int, PhysObj*>& physObjs) {
+    hits.clear();
+    if (events.empty()) return;
+    PROFILE_SCOPE("events");
+    EventState end, probe;
+    std::vector<glm::dvec3> endAcc;
+    int samples = std::max(samplesPerStep, 1);
+
+    for (const Event& event : events) {
+        if (!event.started || time <= event.start.time) continue;
+        if (!gatherBodies(event.bodies, physObjs, time, end, endAcc)) continue;
+        auto valueAt = [&](double t) {
+            interpolate(event, end, endAcc, t, probe);
+            return event.function(probe);
+        };
+
+        double t0 = event.start.time, g0 = event.value;
+        for (int k = 1; k <= samples; ++k) {
+            double t1 = k == samples ? time : event.start.time + (time - event.start.time) * k / samples;
+            double g1 = k == samples ? event.function(end) : valueAt(t1);
+            // a crossing ends on or past zero, so one landing on a sample counts once
+            bool rising = g0 < 0.0 && g1 >= 0.0;
+            bool falling = g0 > 0.0 && g1 <= 0.0;
+            bool wanted = event.direction == EventDirection::Any ||
+                          (event.direction == EventDirection::Rising ? rising : falling);
+            if ((rising || falling) && wanted) {
+                double t = g1 == 0.0 ? t1 : brent(valueAt, t0, t1, g0, g1, TIME_TOLERANCE);
+                EventHit hit;
+                hit.eventID = event.id;
+                hit.rising = rising;
+                interpolate(event, end, endAcc, t, hit.state);
+                hits.push_back(std::move(hit));
+            }
+            t0 = t1;
+            g0 = g1;
+        }
+    }
+
+    std::stable_sort(hits.begin(), hits.end(), [](const EventHit& a, const EventHit& b) {
+        return a.state.time < b.state.time;
+    });
+    // callbacks can add or remove events, so look each one up afresh
+    for (const EventHit& hit : hits) {
+        auto it = std::find_if(events.begin(), events.end(), [&](const Event& e) { return e.id == hit.eventID; });
+        if (it != events.end() && it->onHit) {
+            EventCallback onHit = it->onHit;
+            onHit(hit);
+        }
+    }
+}
+
+EventFunction EventDetector::approach() {
+    return [](const EventState& s) {
+        return glm::dot(s.pos[1] - s.pos[0], s.vel[1] - s.vel[0]);
+    };
+}
+
+EventFunction EventDetector::separation(double distance) {
+    return [distance](const EventState& s) {
+        return glm::length(s.pos[1] - s.pos[0]) - distance;
+    };
+}
+
+EventFunction EventDetector::penumbra(double occluderRadius, double sunRadius) {
+    return [occluderRadius, sunRadius](const EventState& s) {
+        glm::dvec3 toOccluder = s.pos[1] - s.pos[0];
+        glm::dvec3 toSun = s.pos[2] - s.pos[0];
+        double occluderDistance = glm::length(toOccluder), sunDistance = glm::length(toSun);
+        // apparent separation of the two discs, less their apparent radii
+        double separation = std::atan2(glm::length(glm::cross(toOccluder, toSun)), glm::dot(toOccluder, toSun));
+        double occluderSize = std::asin(std::min(occluderRadius / occluderDistance, 1.0));
+        double sunSize = std::asin(std::min(sunRadius / sunDistance, 1.0));
+        return separation - occluderSize - sunSize;
+    };
+}
@@ -0,0 +1,49 @@
+#include "physics/force_model.h"
+#include "physics/physics_engine.h"
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+
+// ---------------- BodyBatch ----------------
+
+void BodyBatch::gather(const std::unordered_map<int, PhysObj*>& physObjs) {
+    size_t n = physObjs.size();
+    ids.resize(n);
+    objs.resize(n);
+    for (std::vector<double>* v : { &x, &y, &z, &vx, &vy, &vz, &mass, &radius })
+        v->resize(n);
+    ax.assign(n, 0.0);
+    ay.assign(n, 0.0);
+    az.assign(n, 0.0);
+    indexByID.clear();
+
+    size_t i = 0;
+    for (auto& [id, obj] : physObjs) {
+        ids[i] = id;
+        objs[i] = obj;
+        x[i] = obj->pos.x;
+        y[i] = obj->pos.y;
+        z[i] = obj->pos.z;
+        vx[i] = obj->vel.x;
+        vy[i] = obj->vel.y;
+        vz[i] = obj->vel.z;
+        mass[i] = obj->mass;
+        radius[i] = obj->radius;
+        indexByID.emplace(id, (int) i);
+        ++i;
+    }
+}
+
+void BodyBatch::scatter() const {
+    for (size_t i = 0; i < objs.size(); ++i)
+        objs[i]->acc_new += glm::dvec3(ax[i], ay[i], az[i]);
+}
+
+int BodyBatch::find(int id) const {
+    auto it = indexByID.find(id);
+    return it == indexByID.end() ? -1 : it->second;
+}
+
+size_t BodyBatch::size() const {
+    return ids.size();
+}
@@ -1,18 +1,58 @@
 #include "physics/physics_engine.h"
+#include "physics/solar_irradiance.h"
+#include "physics/force_model.h"
+#include "physics/collisions.h"
+#include "physics/events.h"
+#include "physics/drift_monitor.h"
+#include "thread_pool.h"
 #include "glm/glm.hpp" 
 #define GLM_ENABLE_EXPERIMENTAL
 #include "glm/gtx/string_cast.hpp"
+#include "profiler.h"
 #include <cstdio>
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 
 constexpr double G = 6.67430e-11;
+// a cubic-spline softened mass is this many softening lengths across
+constexpr double SPLINE_RADIUS = 2.8;
+
+// the factor k of a pair's pull G m1 m2 k (r2 - r1) at squared separation
+// r2, for softening length eps: 1/r^3 when exact. phi gets the matching
+// potential per G m1 m2, -1/r when exact
+static double pairKernel(Softening softening, double r2, double eps, double& phi) {
+    if (eps <= 0.0 || softening == Softening::None) {
+        double r = std::sqrt(r2);
+        phi = -1.0 / r;
+        return 1.0 / (r2 * r);
+    }
+    if (softening == Softening::Plummer) {
+        double s2 = r2 + eps * eps;
+        double s = std::sqrt(s2);
+        phi = -1.0 / s;
+        return 1.0 / (s2 * s);
+    }
+    // Monaghan & Lattanzio spline, written as in GADGET-2
+    double h = SPLINE_RADIUS * eps;
+    double r = std::sqrt(r2);
+    if (r >= h) {
+        phi = -1.0 / r;
+        return 1.0 / (r2 * r);
+    }
+    double u = r / h, u2 = u * u, h3 = 1.0 / (h * h * h);
+    if (u < 0.5) {
+        phi = (-2.8 + u2 * (5.333333333333 + u2 * (6.4 * u - 9.6))) / h;
+        return h3 * (10.666666666667 + u2 * (32.0 * u - 38.4));
+    }
+    phi = (-3.2 + 0.066666666667 / u + u2 * (10.666666666667 + u * (-16.0 + u * (9.6 - 2.133333333333 * u)))) / h;
+    return h3 * (21.333333333333 - 48.0 * u + 38.4 * u2 - 10.666666666667 * u2 * u - 0.066666666667 / (u2 * u));
+}
 
 // ---------------- PhysObj ----------------
 
-PhysObj::PhysObj(glm::dvec3 pos, glm::dvec3 vel, double mass)
-    : pos(pos), vel(vel), acc(glm::dvec3(0.0)), acc_new(glm::dvec3(0.0)), mass(mass) {}
+PhysObj::PhysObj(glm::dvec3 pos, glm::dvec3 vel, double mass, double radius)
+    : pos(pos), vel(vel), acc(glm::dvec3(0.0)), acc_new(glm::dvec3(0.0)), mass(mass), radius(radius) {}
 
 void PhysObj::applyForce(const glm::dvec3& force) {
     if (mass > 0.0)
@@ -31,7 +71,10 @@ void PhysObj::integrateVel(double dT) {
 
 // ---------------- PhysicsEngine ----------------
 
-PhysicsEngine::PhysicsEngine() {}
+PhysicsEngine::PhysicsEngine()
+    : irradiance(std::make_unique<SolarIrradiance>()), collisions(std::make_unique<CollisionSystem>()),
+      events(std::make_unique<EventDetector>()), drift(std::make_unique<DriftMonitor>()),
+      workers(std::make_unique<ThreadPool>()) {}
 
 PhysicsEngine::~PhysicsEngine() {
     clear();
@@ -41,42 +84,184 @@ void PhysicsEngine::addPhysObj(int id, PhysObj* physObj) {
     physObjs.emplace(id, physObj);
 }
 
+void PhysicsEngine::addKinematicObj(int id, PhysObj* physObj) {
+    kinematicObjs.emplace(id, physObj);
+}
+
 void PhysicsEngine::removePhysObj(int id) {
     physObjs.erase(id);
+    kinematicObjs.erase(id);
+    collisions->clearResponse(id);
+    events->removeBody(id);
+    speciesOf.erase(id);
 }
 
 void PhysicsEngine::clear() {
     physObjs.clear();
+    kinematicObjs.clear();
+    absorbed.clear();
+    events->clear();
+    drift->reset();
+}
+
+void PhysicsEngine::setSun(int id, double luminosity) {
+    irradiance->setSun(id, luminosity);
+}
+
+void PhysicsEngine::updateIllumination() {
+    irradiance->update(physObjs, *workers);
+}
+
+SolarIrradiance* PhysicsEngine::getIrradiance() {
+    return irradiance.get();
+}
+
+CollisionSystem* PhysicsEngine::getCollisions() {
+    return collisions.get();
+}
+
+std::vector<int> PhysicsEngine::takeAbsorbed() {
+    std::vector<int> ids;
+    ids.swap(absorbed);
+    return ids;
+}
+
+EventDetector* PhysicsEngine::getEvents() {
+    return events.get();
+}
+
+const ConservedTotals& PhysicsEngine::getTotals() const {
+    return totals;
+}
+
+DriftMonitor* PhysicsEngine::getDriftMonitor() {
+    return drift.get();
+}
+
+double PhysicsEngine::getTime() const {
+    return time;
+}
+
+ThreadPool& PhysicsEngine::getWorkers() {
+    return *workers;
+}
+
+ForceModel* PhysicsEngine::addForceModel(std::unique_ptr<ForceModel> model) {
+    forceModels.push_back(std::move(model));
+    return forceModels.back().get();
+}
+
+ForceModel* PhysicsEngine::getForceModel(const std::string& name) {
+    for (auto& model : forceModels)
+        if (name == model->name()) return model.get();
+    return nullptr;
+}
+
+void PhysicsEngine::applyForceModels() {
+    bool any = false;
+    for (auto& model : forceModels)
+        any |= model->enabled;
+    if (!any) return;
+
+    PROFILE_SCOPE("perturbations");
+    batch.gather(physObjs);
+    batch.time = time;
+    for (auto& model : forceModels)
+        if (model->enabled) model->evaluate(batch, *workers);
+    batch.scatter();
+}
+
+void PhysicsEngine::setSoftening(Softening kernel) {
+    softening = kernel;
+}
+
+Softening PhysicsEngine::getSoftening() const {
+    return softening;
+}
+
+void PhysicsEngine::setSofteningLength(int species, double length) {
+    softeningLengths[species] = length;
+}
+
+void PhysicsEngine::setSpecies(int id, int species) {
+    speciesOf[id] = species;
 }
 
 void PhysicsEngine::computeForces() {
-    for (auto it1 = physObjs.begin(); it1 != physObjs.end(); ++it1) {
-        auto& [id1, obj1] = *it1;
-        auto it2 = it1;
-        ++it2;
-        for (; it2 != physObjs.end(); ++it2) {
-            auto& [id2, obj2] = *it2;
+    PROFILE_SCOPE("forces");
+    pairObjs.clear();
+    pairSoftening.clear();
+    for (auto& [id, obj] : physObjs) {
+        double eps = 0.0;
+        if (softening != Softening::None) {
+            auto species = speciesOf.find(id);
+            auto length = softeningLengths.find(species == speciesOf.end() ? 0 : species->second);
+            if (length != softeningLengths.end()) eps = length->second;
+        }
+        pairObjs.push_back(obj);
+        pairSoftening.push_back(eps);
+    }
+
+    // the pair potential rides along with the forces
+    double potential = 0.0;
+    for (size_t i = 0; i < pairObjs.size(); ++i) {
+        PhysObj* obj1 = pairObjs[i];
+        for (size_t j = i + 1; j < pairObjs.size(); ++j) {
+            PhysObj* obj2 = pairObjs[j];
 
             glm::dvec3 dir = obj2->pos - obj1->pos;
-            double r = glm::length(dir);
-            if (r < 1e-4) continue;
-            glm::dvec3 F_g = (G * obj1->mass * obj2->mass / (r * r)) * glm::normalize(dir);
+            double r2 = glm::dot(dir, dir);
+            double eps = std::max(pairSoftening[i], pairSoftening[j]);
+            if (eps <= 0.0 && r2 < 1e-8) continue;
+            double phi;
+            double Gmm = G * obj1->mass * obj2->mass;
+            glm::dvec3 F_g = (Gmm * pairKernel(softening, r2, eps, phi)) * dir;
+            potential += Gmm * phi;
 
             obj1->applyForce(F_g);
             obj2->applyForce(-F_g);
         }
     }
+    totals.potential = potential;
+    applyForceModels();
 }
 
 void PhysicsEngine::updateAll(float dT) {
+    PROFILE_SCOPE("physics");
+    events->beginStep(time, physObjs);
+
     // 1. Update positions using current acc
     for (auto& [id, obj] : physObjs)
         obj->integratePos(dT);
+    time += dT;
+
+    // 2. Resolve overlaps at the new positions; merged bodies leave here
+    collisions->update(physObjs, *workers, absorbed);
+
+    // 3. Shadowing at the new positions, for lighting and radiation pressure
+    updateIllumination();
 
-    // 2. Compute forces at new positions → acc_new
+    // 4. Compute forces at new positions → acc_new
     computeForces();
 
-    // 3. Update velocities using (acc + acc_new) / 2, then swap
-    for (auto& [id, obj] : physObjs)
+    // 5. Update velocities using (acc + acc_new) / 2, then swap, summing
+    //    the rest of the conserved totals on the way
+    totals.time = time;
+    totals.bodies = physObjs.size();
+    totals.kinetic = totals.momentumScale = totals.angularMomentumScale = 0.0;
+    totals.momentum = totals.angularMomentum = glm::dvec3(0.0);
+    for (auto& [id, obj] : physObjs) {
         obj->integrateVel(dT);
+        glm::dvec3 p = obj->mass * obj->vel;
+        glm::dvec3 L = glm::cross(obj->pos, p);
+        totals.kinetic += 0.5 * glm::dot(p, obj->vel);
+        totals.momentum += p;
+        totals.angularMomentum += L;
+        totals.momentumScale += glm::length(p);
+        totals.angularMomentumScale += glm::length(L);
+    }
+    if (dT > 0.0f) drift->record(totals);
+
+    // 6. Crossings of event functions inside the step, from both ends' states
+    events->endStep(time, physObjs);
 }
@@ -0,0 +1,1097 @@
+#include "physics/sgp4.h"
+#include "physics/simd.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double TWO_PI = 2.0 * PI;
+constexpr double DEG = PI / 180.0;
+constexpr double MINUTES_PER_DAY = 1440.0;
+
+// WGS-72 zonal terms and derived units (earth radii, minutes)
+constexpr double J2 = 0.001082616;
+constexpr double J3 = -0.00000253881;
+constexpr double J4 = -0.00000165597;
+constexpr double J3OJ2 = J3 / J2;
+constexpr double X2O3 = 2.0 / 3.0;
+static const double XKE = 60.0 / std::sqrt(Sgp4Catalog::EARTH_RADIUS * Sgp4Catalog::EARTH_RADIUS *
+                                           Sgp4Catalog::EARTH_RADIUS / Sgp4Catalog::MU);
+static const double VKMPERSEC = Sgp4Catalog::EARTH_RADIUS * XKE / 60.0;
+
+constexpr double DEEP_SPACE_PERIOD = 225.0; // min
+// object pairs per worker chunk, and deep-space objects
+constexpr size_t SGP4_GRAIN = 256;
+constexpr size_t SDP4_GRAIN = 16;
+
+struct Sgp4Catalog::Record {
+    double epoch = 0.0;   // Julian date
+    bool deepSpace = false;
+    int isimp = 0;
+
+    // mean elements, un-Kozai'd mean motion
+    double bstar = 0.0, inclo = 0.0, nodeo = 0.0, ecco = 0.0, argpo = 0.0, mo = 0.0, no = 0.0;
+
+    // near-Earth
+    double ao = 0.0, aycof = 0.0, con41 = 0.0, cc1 = 0.0, cc4 = 0.0, cc5 = 0.0, d2 = 0.0, d3 = 0.0, d4 = 0.0;
+    double delmo = 0.0, eta = 0.0, argpdot = 0.0, omgcof = 0.0, sinmao = 0.0, t2cof = 0.0, t3cof = 0.0;
+    double t4cof = 0.0, t5cof = 0.0, x1mth2 = 0.0, x7thm1 = 0.0, mdot = 0.0, nodedot = 0.0, xlcof = 0.0;
+    double xmcof = 0.0, nodecf = 0.0, sinio = 0.0, cosio = 0.0;
+
+    // deep space
+    int irez = 0;
+    double d2201 = 0.0, d2211 = 0.0, d3210 = 0.0, d3222 = 0.0, d4410 = 0.0, d4422 = 0.0;
+    double d5220 = 0.0, d5232 = 0.0, d5421 = 0.0, d5433 = 0.0;
+    double dedt = 0.0, del1 = 0.0, del2 = 0.0, del3 = 0.0, didt = 0.0, dmdt = 0.0, dnodt = 0.0, domdt = 0.0;
+    double e3 = 0.0, ee2 = 0.0, peo = 0.0, pgho = 0.0, pho = 0.0, pinco = 0.0, plo = 0.0;
+    double se2 = 0.0, se3 = 0.0, sgh2 = 0.0, sgh3 = 0.0, sgh4 = 0.0, sh2 = 0.0, sh3 = 0.0;
+    double si2 = 0.0, si3 = 0.0, sl2 = 0.0, sl3 = 0.0, sl4 = 0.0, gsto = 0.0, xfact = 0.0;
+    double xgh2 = 0.0, xgh3 = 0.0, xgh4 = 0.0, xh2 = 0.0, xh3 = 0.0, xi2 = 0.0, xi3 = 0.0;
+    double xl2 = 0.0, xl3 = 0.0, xl4 = 0.0, xlamo = 0.0, zmol = 0.0, zmos = 0.0;
+    // resonance integrator, advanced by every deep-space propagation
+    double atime = 0.0, xli = 0.0, xni = 0.0;
+};
+
+// rows of Sgp4Catalog::nearEarth
+enum NearEarthField {
+    F_EPOCH, F_MO, F_MDOT, F_ARGPO, F_ARGPDOT, F_NODEO, F_NODEDOT, F_NODECF,
+    F_CC1, F_BC4, F_BC5, F_T2COF, F_T3COF, F_T4COF, F_T5COF, F_OMGCOF, F_XMCOF,
+    F_ETA, F_DELMO, F_SINMAO, F_D2, F_D3, F_D4, F_AO, F_NO, F_ECCO, F_INCLO,
+    F_SINIO, F_COSIO, F_AYCOF, F_XLCOF, F_CON41, F_X1MTH2, F_X7THM1,
+    NEAR_EARTH_FIELDS
+};
+
+// Greenwich mean sidereal time (rad) at a UT1 Julian date, IAU-82
+static double gstime(double jdut1) {
+    double tut1 = (jdut1 - 2451545.0) / 36525.0;
+    double temp = -6.2e-6 * tut1 * tut1 * tut1 + 0.093104 * tut1 * tut1 +
+                  (876600.0 * 3600.0 + 8640184.812866) * tut1 + 67310.54841;
+    temp = std::fmod(temp * DEG / 240.0, TWO_PI);
+    return temp < 0.0 ? temp + TWO_PI : temp;
+}
+
+// ---------------- Deep space ----------------
+
+// lunar-solar terms from dscom that dsinit needs once
+struct DeepSpaceInit {
+    double sinim, cosim, emsq, em, nm;
+    double s1, s2, s3, s4, s5, ss1, ss2, ss3, ss4, ss5;
+    double sz1, sz3, sz11, sz13, sz21, sz23, sz31, sz33;
+    double z1, z3, z11, z13, z21, z23, z31, z33;
+};
+
+static void dscom(double epoch1950, double ep, double argpp, double tc, double inclp, double nodep, double np,
+                  Sgp4Catalog::Record& rec, DeepSpaceInit& out) {
+    const double zes = 0.01675, zel = 0.05490, c1ss = 2.9864797e-6, c1l = 4.7968065e-7;
+    const double zsinis = 0.39785416, zcosis = 0.91744867, zcosgs = 0.1945905, zsings = -0.98088458;
+
+    double nm = np, em = ep;
+    double snodm = std::sin(nodep), cnodm = std::cos(nodep);
+    double sinomm = std::sin(argpp), cosomm = std::cos(argpp);
+    double sinim = std::sin(inclp), cosim = std::cos(inclp);
+    double emsq = em * em;
+    double betasq = 1.0 - emsq;
+    double rtemsq = std::sqrt(betasq);
+
+    // initialize lunar solar terms
+    rec.peo = rec.pinco = rec.plo = rec.pgho = rec.pho = 0.0;
+    double day = epoch1950 + 18261.5 + tc / 1440.0;
+    double xnodce = std::fmod(4.5236020 - 9.2422029e-4 * day, TWO_PI);
+    double stem = std::sin(xnodce), ctem = std::cos(xnodce);
+    double zcosil = 0.91375164 - 0.03568096 * ctem;
+    double zsinil = std::sqrt(1.0 - zcosil * zcosil);
+    double zsinhl = 0.089683511 * stem / zsinil;
+    double zcoshl = std::sqrt(1.0 - zsinhl * zsinhl);
+    double gam = 5.8351514 + 0.0019443680 * day;
+    double zx = 0.39785416 * stem / zsinil;
+    double zy = zcoshl * ctem + 0.91744867 * zsinhl * stem;
+    zx = std::atan2(zx, zy);
+    zx = gam + zx - xnodce;
+    double zcosgl = std::cos(zx), zsingl = std::sin(zx);
+
+    // solar terms first, then lunar
+    double zcosg = zcosgs, zsing = zsings, zcosi = zcosis, zsini = zsinis;
+    double zcosh = cnodm, zsinh = snodm, cc = c1ss, xnoi = 1.0 / nm;
+    double s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0, s6 = 0, s7 = 0;
+    double ss1 = 0, ss2 = 0, ss3 = 0, ss4 = 0, ss5 = 0, ss6 = 0, ss7 = 0;
+    double z1 = 0, z2 = 0, z3 = 0, z11 = 0, z12 = 0, z13 = 0, z21 = 0, z22 = 0, z23 = 0, z31 = 0, z32 = 0, z33 = 0;
+    double sz1 = 0, sz2 = 0, sz3 = 0, sz11 = 0, sz12 = 0, sz13 = 0, sz21 = 0, sz22 = 0, sz23 = 0, sz31 = 0, sz32 = 0, sz33 = 0;
+    for (int lsflg = 1; lsflg <= 2; ++lsflg) {
+        double a1 = zcosg * zcosh + zsing * zcosi * zsinh;
+        double a3 = -zsing * zcosh + zcosg * zcosi * zsinh;
+        double a7 = -zcosg * zsinh + zsing * zcosi * zcosh;
+        double a8 = zsing * zsini;
+        double a9 = zsing * zsinh + zcosg * zcosi * zcosh;
+        double a10 = zcosg * zsini;
+        double a2 = cosim * a7 + sinim * a8;
+        double a4 = cosim * a9 + sinim * a10;
+        double a5 = -sinim * a7 + cosim * a8;
+        double a6 = -sinim * a9 + cosim * a10;
+
+        double x1 = a1 * cosomm + a2 * sinomm;
+        double x2 = a3 * cosomm + a4 * sinomm;
+        double x3 = -a1 * sinomm + a2 * cosomm;
+        double x4 = -a3 * sinomm + a4 * cosomm;
+        double x5 = a5 * sinomm;
+        double x6 = a6 * sinomm;
+        double x7 = a5 * cosomm;
+        double x8 = a6 * cosomm;
+
+        z31 = 12.0 * x1 * x1 - 3.0 * x3 * x3;
+        z32 = 24.0 * x1 * x2 - 6.0 * x3 * x4;
+        z33 = 12.0 * x2 * x2 - 3.0 * x4 * x4;
+        z1 = 3.0 * (a1 * a1 + a2 * a2) + z31 * emsq;
+        z2 = 6.0 * (a1 * a3 + a2 * a4) + z32 * emsq;
+        z3 = 3.0 * (a3 * a3 + a4 * a4) + z33 * emsq;
+        z11 = -6.0 * a1 * a5 + emsq * (-24.0 * x1 * x7 - 6.0 * x3 * x5);
+        z12 = -6.0 * (a1 * a6 + a3 * a5) + emsq * (-24.0 * (x2 * x7 + x1 * x8) - 6.0 * (x3 * x6 + x4 * x5));
+        z13 = -6.0 * a3 * a6 + emsq * (-24.0 * x2 * x8 - 6.0 * x4 * x6);
+        z21 = 6.0 * a2 * a5 + emsq * (24.0 * x1 * x5 - 6.0 * x3 * x7);
+        z22 = 6.0 * (a4 * a5 + a2 * a6) + emsq * (24.0 * (x2 * x5 + x1 * x6) - 6.0 * (x4 * x7 + x3 * x8));
+        z23 = 6.0 * a4 * a6 + emsq * (24.0 * x2 * x6 - 6.0 * x4 * x8);
+        z1 = z1 + z1 + betasq * z31;
+        z2 = z2 + z2 + betasq * z32;
+        z3 = z3 + z3 + betasq * z33;
+        s3 = cc * xnoi;
+        s2 = -0.5 * s3 / rtemsq;
+        s4 = s3 * rtemsq;
+        s1 = -15.0 * em * s4;
+        s5 = x1 * x3 + x2 * x4;
+        s6 = x2 * x3 + x1 * x4;
+        s7 = x2 * x4 - x1 * x3;
+
+        if (lsflg == 1) {
+            ss1 = s1; ss2 = s2; ss3 = s3; ss4 = s4; ss5 = s5; ss6 = s6; ss7 = s7;
+            sz1 = z1; sz2 = z2; sz3 = z3;
+            sz11 = z11; sz12 = z12; sz13 = z13;
+            sz21 = z21; sz22 = z22; sz23 = z23;
+            sz31 = z31; sz32 = z32; sz33 = z33;
+            zcosg = zcosgl;
+            zsing = zsingl;
+            zcosi = zcosil;
+            zsini = zsinil;
+            zcosh = zcoshl * cnodm + zsinhl * snodm;
+            zsinh = snodm * zcoshl - cnodm * zsinhl;
+            cc = c1l;
+        }
+    }
+
+    rec.zmol = std::fmod(4.7199672 + 0.22997150 * day - gam, TWO_PI);
+    rec.zmos = std::fmod(6.2565837 + 0.017201977 * day, TWO_PI);
+
+    // solar terms
+    rec.se2 = 2.0 * ss1 * ss6;
+    rec.se3 = 2.0 * ss1 * ss7;
+    rec.si2 = 2.0 * ss2 * sz12;
+    rec.si3 = 2.0 * ss2 * (sz13 - sz11);
+    rec.sl2 = -2.0 * ss3 * sz2;
+    rec.sl3 = -2.0 * ss3 * (sz3 - sz1);
+    rec.sl4 = -2.0 * ss3 * (-21.0 - 9.0 * emsq) * zes;
+    rec.sgh2 = 2.0 * ss4 * sz32;
+    rec.sgh3 = 2.0 * ss4 * (sz33 - sz31);
+    rec.sgh4 = -18.0 * ss4 * zes;
+    rec.sh2 = -2.0 * ss2 * sz22;
+    rec.sh3 = -2.0 * ss2 * (sz23 - sz21);
+
+    // lunar terms
+    rec.ee2 = 2.0 * s1 * s6;
+    rec.e3 = 2.0 * s1 * s7;
+    rec.xi2 = 2.0 * s2 * z12;
+    rec.xi3 = 2.0 * s2 * (z13 - z11);
+    rec.xl2 = -2.0 * s3 * z2;
+    rec.xl3 = -2.0 * s3 * (z3 - z1);
+    rec.xl4 = -2.0 * s3 * (-21.0 - 9.0 * emsq) * zel;
+    rec.xgh2 = 2.0 * s4 * z32;
+    rec.xgh3 = 2.0 * s4 * (z33 - z31);
+    rec.xgh4 = -18.0 * s4 * zel;
+    rec.xh2 = -2.0 * s2 * z22;
+    rec.xh3 = -2.0 * s2 * (z23 - z21);
+
+    out = { sinim, cosim, emsq, em, nm, s1, s2, s3, s4, s5, ss1, ss2, ss3, ss4, ss5,
+            sz1, sz3, sz11, sz13, sz21, sz23, sz31, sz33, z1, z3, z11, z13, z21, z23, z31, z33 };
+}
+
+// lunar-solar long-period periodics, applied to the mean elements at t
+static void dpper(const Sgp4Catalog::Record& rec, double t,
+                  double& ep, double& inclp, double& nodep, double& argpp, double& mp) {
+    const double zns = 1.19459e-5, zes = 0.01675, znl = 1.5835218e-4, zel = 0.05490;
+
+    double zm = rec.zmos + zns * t;
+    double zf = zm + 2.0 * zes * std::sin(zm);
+    double sinzf = std::sin(zf);
+    double f2 = 0.5 * sinzf * sinzf - 0.25;
+    double f3 = -0.5 * sinzf * std::cos(zf);
+    double ses = rec.se2 * f2 + rec.se3 * f3;
+    double sis = rec.si2 * f2 + rec.si3 * f3;
+    double sls = rec.sl2 * f2 + rec.sl3 * f3 + rec.sl4 * sinzf;
+    double sghs = rec.sgh2 * f2 + rec.sgh3 * f3 + rec.sgh4 * sinzf;
+    double shs = rec.sh2 * f2 + rec.sh3 * f3;
+
+    zm = rec.zmol + znl * t;
+    zf = zm + 2.0 * zel * std::sin(zm);
+    sinzf = std::sin(zf);
+    f2 = 0.5 * sinzf * sinzf - 0.25;
+    f3 = -0.5 * sinzf * std::cos(zf);
+    double sel = rec.ee2 * f2 + rec.e3 * f3;
+    double sil = rec.xi2 * f2 + rec.xi3 * f3;
+    double sll = rec.xl2 * f2 + rec.xl3 * f3 + rec.xl4 * sinzf;
+    double sghl = rec.xgh2 * f2 + rec.xgh3 * f3 + rec.xgh4 * sinzf;
+    double shll = rec.xh2 * f2 + rec.xh3 * f3;
+
+    double pe = ses + sel - rec.peo;
+    double pinc = sis + sil - rec.pinco;
+    double pl = sls + sll - rec.plo;
+    double pgh = sghs + sghl - rec.pgho;
+    double ph = shs + shll - rec.pho;
+
+    inclp = inclp + pinc;
+    ep = ep + pe;
+    double sinip = std::sin(inclp), cosip = std::cos(inclp);
+
+    if (inclp >= 0.2) {
+        ph = ph / sinip;
+        pgh = pgh - cosip * ph;
+        argpp = argpp + pgh;
+        nodep = nodep + ph;
+        mp = mp + pl;
+    } else {
+        // Lyddane modification for low inclinations
+        double sinop = std::sin(nodep), cosop = std::cos(nodep);
+        double alfdp = sinip * sinop + ph * cosop + pinc * cosip * sinop;
+        double betdp = sinip * cosop - ph * sinop + pinc * cosip * cosop;
+        nodep = std::fmod(nodep, TWO_PI);
+        double xls = mp + argpp + cosip * nodep;
+        double dls = pl + pgh - pinc * nodep * sinip;
+        xls = xls + dls;
+        double xnoh = nodep;
+        nodep = std::atan2(alfdp, betdp);
+        if (std::fabs(xnoh - nodep) > PI)
+            nodep += nodep < xnoh ? TWO_PI : -TWO_PI;
+        mp = mp + pl;
+        argpp = xls - mp - cosip * nodep;
+    }
+}
+
+constexpr double RPTIM = 4.37526908801129966e-3; // earth rotation, rad/min
+
+// secular lunar-solar rates and the 12 h / 24 h resonance constants
+static void dsinit(Sgp4Catalog::Record& rec, const DeepSpaceInit& c, double xpidot) {
+    const double q22 = 1.7891679e-6, q31 = 2.1460748e-6, q33 = 2.2123015e-7;
+    const double root22 = 1.7891679e-6, root44 = 7.3636953e-9, root54 = 2.1765803e-9;
+    const double root32 = 3.7393792e-7, root52 = 1.1428639e-7;
+    const double znl = 1.5835218e-4, zns = 1.19459e-5;
+
+    double nm = c.nm, em = c.em, emsq = c.emsq, inclm = rec.inclo;
+    double sinim = c.sinim, cosim = c.cosim;
+
+    rec.irez = 0;
+    if (nm < 0.0052359877 && nm > 0.0034906585) rec.irez = 1;
+    if (nm >= 8.26e-3 && nm <= 9.24e-3 && em >= 0.5) rec.irez = 2;
+
+    // solar terms
+    double ses = c.ss1 * zns * c.ss5;
+    double sis = c.ss2 * zns * (c.sz11 + c.sz13);
+    double sls = -zns * c.ss3 * (c.sz1 + c.sz3 - 14.0 - 6.0 * emsq);
+    double sghs = c.ss4 * zns * (c.sz31 + c.sz33 - 6.0);
+    double shs = -zns * c.ss2 * (c.sz21 + c.sz23);
+    bool polar = inclm < 5.2359877e-2 || inclm > PI - 5.2359877e-2;
+    if (polar) shs = 0.0;
+    if (sinim != 0.0) shs = shs / sinim;
+    double sgs = sghs - cosim * shs;
+
+    // lunar terms
+    rec.dedt = ses + c.s1 * znl * c.s5;
+    rec.didt = sis + c.s2 * znl * (c.z11 + c.z13);
+    rec.dmdt = sls - znl * c.s3 * (c.z1 + c.z3 - 14.0 - 6.0 * emsq);
+    double sghl = c.s4 * znl * (c.z31 + c.z33 - 6.0);
+    double shll = -znl * c.s2 * (c.z21 + c.z23);
+    if (polar) shll = 0.0;
+    rec.domdt = sgs + sghl;
+    rec.dnodt = shs;
+    if (sinim != 0.0) {
+        rec.domdt = rec.domdt - cosim / sinim * shll;
+        rec.dnodt = rec.dnodt + shll / sinim;
+    }
+    if (rec.irez == 0) return;
+
+    double theta = std::fmod(rec.gsto, TWO_PI);
+    double aonv = std::pow(nm / XKE, X2O3);
+
+    if (rec.irez == 2) {
+        // geopotential resonance for 12 hour orbits
+        double cosisq = cosim * cosim;
+        em = rec.ecco;
+        emsq = em * em;
+        double eoc = em * emsq;
+        double g201 = -0.306 - (em - 0.64) * 0.440;
+        double g211, g310, g322, g410, g422, g520, g521, g532, g533;
+        if (em <= 0.65) {
+            g211 = 3.616 - 13.2470 * em + 16.2900 * emsq;
+            g310 = -19.302 + 117.3900 * em - 228.4190 * emsq + 156.5910 * eoc;
+            g322 = -18.9068 + 109.7927 * em - 214.6334 * emsq + 146.5816 * eoc;
+            g410 = -41.122 + 242.6940 * em - 471.0940 * emsq + 313.9530 * eoc;
+            g422 = -146.407 + 841.8800 * em - 1629.014 * emsq + 1083.4350 * eoc;
+            g520 = -532.114 + 3017.977 * em - 5740.032 * emsq + 3708.2760 * eoc;
+        } else {
+            g211 = -72.099 + 331.819 * em - 508.738 * emsq + 266.724 * eoc;
+            g310 = -346.844 + 1582.851 * em - 2415.925 * emsq + 1246.113 * eoc;
+            g322 = -342.585 + 1554.908 * em - 2366.899 * emsq + 1215.972 * eoc;
+            g410 = -1052.797 + 4758.686 * em - 7193.992 * emsq + 3651.957 * eoc;
+            g422 = -3581.690 + 16178.110 * em - 24462.770 * emsq + 12422.520 * eoc;
+            if (em > 0.715) g520 = -5149.66 + 29936.92 * em - 54087.36 * emsq + 31324.56 * eoc;
+            else g520 = 1464.74 - 4664.75 * em + 3763.64 * emsq;
+        }
+        if (em < 0.7) {
+            g533 = -919.22770 + 4988.6100 * em - 9064.7700 * emsq + 5542.21 * eoc;
+            g521 = -822.71072 + 4568.6173 * em - 8491.4146 * emsq + 5337.524 * eoc;
+            g532 = -853.66600 + 4690.2500 * em - 8624.7700 * emsq + 5341.4 * eoc;
+        } else {
+            g533 = -37995.780 + 161616.52 * em - 229838.20 * emsq + 109377.94 * eoc;
+            g521 = -51752.104 + 218913.95 * em - 309468.16 * emsq + 146349.42 * eoc;
+            g532 = -40023.880 + 170470.89 * em - 242699.48 * emsq + 115605.82 * eoc;
+        }
+
+        double sini2 = sinim * sinim;
+        double f220 = 0.75 * (1.0 + 2.0 * cosim + cosisq);
+        double f221 = 1.5 * sini2;
+        double f321 = 1.875 * sinim * (1.0 - 2.0 * cosim - 3.0 * cosisq);
+        double f322 = -1.875 * sinim * (1.0 + 2.0 * cosim - 3.0 * cosisq);
+        double f441 = 35.0 * sini2 * f220;
+        double f442 = 39.3750 * sini2 * sini2;
+        double f522 = 9.84375 * sinim * (sini2 * (1.0 - 2.0 * cosim - 5.0 * cosisq) +
+                                         0.33333333 * (-2.0 + 4.0 * cosim + 6.0 * cosisq));
+        double f523 = sinim * (4.92187512 * sini2 * (-2.0 - 4.0 * cosim + 10.0 * cosisq) +
+                               6.56250012 * (1.0 + 2.0 * cosim - 3.0 * cosisq));
+        double f542 = 29.53125 * sinim * (2.0 - 8.0 * cosim + cosisq * (-12.0 + 8.0 * cosim + 10.0 * cosisq));
+        double f543 = 29.53125 * sinim * (-2.0 - 8.0 * cosim + cosisq * (12.0 + 8.0 * cosim - 10.0 * cosisq));
+
+        double xno2 = nm * nm;
+        double ainv2 = aonv * aonv;
+        double temp1 = 3.0 * xno2 * ainv2;
+        double temp = temp1 * root22;
+        rec.d2201 = temp * f220 * g201;
+        rec.d2211 = temp * f221 * g211;
+        temp1 = temp1 * aonv;
+        temp = temp1 * root32;
+        rec.d3210 = temp * f321 * g310;
+        rec.d3222 = temp * f322 * g322;
+        temp1 = temp1 * aonv;
+        temp = 2.0 * temp1 * root44;
+        rec.d4410 = temp * f441 * g410;
+        rec.d4422 = temp * f442 * g422;
+        temp1 = temp1 * aonv;
+        temp = temp1 * root52;
+        rec.d5220 = temp * f522 * g520;
+        rec.d5232 = temp * f523 * g532;
+        temp = 2.0 * temp1 * root54;
+        rec.d5421 = temp * f542 * g521;
+        rec.d5433 = temp * f543 * g533;
+        rec.xlamo = std::fmod(rec.mo + rec.nodeo + rec.nodeo - theta - theta, TWO_PI);
+        rec.xfact = rec.mdot + rec.dmdt + 2.0 * (rec.nodedot + rec.dnodt - RPTIM) - rec.no;
+    } else {
+        // synchronous resonance terms
+        double g200 = 1.0 + emsq * (-2.5 + 0.8125 * emsq);
+        double g310 = 1.0 + 2.0 * emsq;
+        double g300 = 1.0 + emsq * (-6.0 + 6.60937 * emsq);
+        double f220 = 0.75 * (1.0 + cosim) * (1.0 + cosim);
+        double f311 = 0.9375 * sinim * sinim * (1.0 + 3.0 * cosim) - 0.75 * (1.0 + cosim);
+        double f330 = 1.0 + cosim;
+        f330 = 1.875 * f330 * f330 * f330;
+        rec.del1 = 3.0 * nm * nm * aonv * aonv;
+        rec.del2 = 2.0 * rec.del1 * f220 * g200 * q22;
+        rec.del3 = 3.0 * rec.del1 * f330 * g300 * q33 * aonv;
+        rec.del1 = rec.del1 * f311 * g310 * q31 * aonv;
+        rec.xlamo = std::fmod(rec.mo + rec.nodeo + rec.argpo - theta, TWO_PI);
+        rec.xfact = rec.mdot + xpidot - RPTIM + rec.dmdt + rec.domdt + rec.dnodt - rec.no;
+    }
+    rec.xli = rec.xlamo;
+    rec.xni = rec.no;
+    rec.atime = 0.0;
+}
+
+// secular lunar-solar rates plus the resonance integration to t
+static void dspace(Sgp4Catalog::Record& rec, double t,
+                   double& em, double& argpm, double& inclm, double& mm, double& nodem, double& nm) {
+    const double fasx2 = 0.13130908, fasx4 = 2.8843198, fasx6 = 0.37448087;
+    const double g22 = 5.7686396, g32 = 0.95240898, g44 = 1.8014998, g52 = 1.0508330, g54 = 4.4108898;
+    const double stepp = 720.0, stepn = -720.0, step2 = 259200.0;
+
+    double theta = std::fmod(rec.gsto + t * RPTIM, TWO_PI);
+    em = em + rec.dedt * t;
+    inclm = inclm + rec.didt * t;
+    argpm = argpm + rec.domdt * t;
+    nodem = nodem + rec.dnodt * t;
+    mm = mm + rec.dmdt * t;
+    if (rec.irez == 0) return;
+
+    // restart from epoch when t moves back toward it or changes side
+    if (rec.atime == 0.0 || t * rec.atime <= 0.0 || std::fabs(t) < std::fabs(rec.atime)) {
+        rec.atime = 0.0;
+        rec.xni = rec.no;
+        rec.xli = rec.xlamo;
+    }
+    double delt = t > 0.0 ? stepp : stepn;
+    double ft = 0.0, xndt = 0.0, xldot = 0.0, xnddt = 0.0;
+    for (;;) {
+        if (rec.irez != 2) {
+            xndt = rec.del1 * std::sin(rec.xli - fasx2) + rec.del2 * std::sin(2.0 * (rec.xli - fasx4)) +
+                   rec.del3 * std::sin(3.0 * (rec.xli - fasx6));
+            xldot = rec.xni + rec.xfact;
+            xnddt = rec.del1 * std::cos(rec.xli - fasx2) + 2.0 * rec.del2 * std::cos(2.0 * (rec.xli - fasx4)) +
+                    3.0 * rec.del3 * std::cos(3.0 * (rec.xli - fasx6));
+            xnddt = xnddt * xldot;
+        } else {
+            double xomi = rec.argpo + rec.argpdot * rec.atime;
+            double x2omi = xomi + xomi;
+            double x2li = rec.xli + rec.xli;
+            xndt = rec.d2201 * std::sin(x2omi + rec.xli - g22) + rec.d2211 * std::sin(rec.xli - g22) +
+                   rec.d3210 * std::sin(xomi + rec.xli - g32) + rec.d3222 * std::sin(-xomi + rec.xli - g32) +
+                   rec.d4410 * std::sin(x2omi + x2li - g44) + rec.d4422 * std::sin(x2li - g44) +
+                   rec.d5220 * std::sin(xomi + rec.xli - g52) + rec.d5232 * std::sin(-xomi + rec.xli - g52) +
+                   rec.d5421 * std::sin(xomi + x2li - g54) + rec.d5433 * std::sin(-xomi + x2li - g54);
+            xldot = rec.xni + rec.xfact;
+            xnddt = rec.d2201 * std::cos(x2omi + rec.xli - g22) + rec.d2211 * std::cos(rec.xli - g22) +
+                    rec.d3210 * std::cos(xomi + rec.xli - g32) + rec.d3222 * std::cos(-xomi + rec.xli - g32) +
+                    rec.d5220 * std::cos(xomi + rec.xli - g52) + rec.d5232 * std::cos(-xomi + rec.xli - g52) +
+                    2.0 * (rec.d4410 * std::cos(x2omi + x2li - g44) + rec.d4422 * std::cos(x2li - g44) +
+                           rec.d5421 * std::cos(xomi + x2li - g54) + rec.d5433 * std::cos(-xomi + x2li - g54));
+            xnddt = xnddt * xldot;
+        }
+        if (std::fabs(t - rec.atime) < stepp) {
+            ft = t - rec.atime;
+            break;
+        }
+        rec.xli = rec.xli + xldot * delt + xndt * step2;
+        rec.xni = rec.xni + xndt * delt + xnddt * step2;
+        rec.atime = rec.atime + delt;
+    }
+
+    nm = rec.xni + xndt * ft + xnddt * ft * ft * 0.5;
+    double xl = rec.xli + xldot * ft + xndt * ft * ft * 0.5;
+    if (rec.irez != 1) mm = xl - 2.0 * nodem + 2.0 * theta;
+    else mm = xl - nodem - argpm + theta;
+}
+
+// ---------------- SGP4 ----------------
+
+// scalar SGP4/SDP4 at t minutes from epoch: r in km, v in km/s, returns the error code
+static int sgp4(Sgp4Catalog::Record& rec, double t, glm::dvec3& r, glm::dvec3& v) {
+    // secular gravity and atmospheric drag
+    double xmdf = rec.mo + rec.mdot * t;
+    double argpdf = rec.argpo + rec.argpdot * t;
+    double nodedf = rec.nodeo + rec.nodedot * t;
+    double argpm = argpdf, mm = xmdf;
+    double t2 = t * t;
+    double nodem = nodedf + rec.nodecf * t2;
+    double tempa = 1.0 - rec.cc1 * t;
+    double tempe = rec.bstar * rec.cc4 * t;
+    double templ = rec.t2cof * t2;
+
+    if (rec.isimp != 1) {
+        double delomg = rec.omgcof * t;
+        double delmtemp = 1.0 + rec.eta * std::cos(xmdf);
+        double delm = rec.xmcof * (delmtemp * delmtemp * delmtemp - rec.delmo);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2 * t, t4 = t3 * t;
+        tempa = tempa - rec.d2 * t2 - rec.d3 * t3 - rec.d4 * t4;
+        tempe = tempe + rec.bstar * rec.cc5 * (std::sin(mm) - rec.sinmao);
+        templ = templ + rec.t3cof * t3 + t4 * (rec.t4cof + t * rec.t5cof);
+    }
+
+    double nm = rec.no, em = rec.ecco, inclm = rec.inclo;
+    if (rec.deepSpace) dspace(rec, t, em, argpm, inclm, mm, nodem, nm);
+    if (nm <= 0.0) return 2;
+
+    double am = std::pow(XKE / nm, X2O3) * tempa * tempa;
+    nm = XKE / std::pow(am, 1.5);
+    em = em - tempe;
+    if (em >= 1.0 || em < -0.001) return 1;
+    if (em < 1.0e-6) em = 1.0e-6;
+    mm = mm + rec.no * templ;
+    double xlm = mm + argpm + nodem;
+    nodem = std::fmod(nodem, TWO_PI);
+    argpm = std::fmod(argpm, TWO_PI);
+    xlm = std::fmod(xlm, TWO_PI);
+    mm = std::fmod(xlm - argpm - nodem, TWO_PI);
+
+    double ep = em, xincp = inclm, argpp = argpm, nodep = nodem, mp = mm;
+    double sinip = std::sin(inclm), cosip = std::cos(inclm);
+    double aycof = rec.aycof, xlcof = rec.xlcof;
+    double con41 = rec.con41, x1mth2 = rec.x1mth2, x7thm1 = rec.x7thm1;
+
+    if (rec.deepSpace) {
+        dpper(rec, t, ep, xincp, nodep, argpp, mp);
+        if (xincp < 0.0) {
+            xincp = -xincp;
+            nodep = nodep + PI;
+            argpp = argpp - PI;
+        }
+        if (ep < 0.0 || ep > 1.0) return 3;
+
+        sinip = std::sin(xincp);
+        cosip = std::cos(xincp);
+        aycof = -0.5 * J3OJ2 * sinip;
+        double denom = std::fabs(cosip + 1.0) > 1.5e-12 ? 1.0 + cosip : 1.5e-12;
+        xlcof = -0.25 * J3OJ2 * sinip * (3.0 + 5.0 * cosip) / denom;
+        double cosisq = cosip * cosip;
+        con41 = 3.0 * cosisq - 1.0;
+        x1mth2 = 1.0 - cosisq;
+        x7thm1 = 7.0 * cosisq - 1.0;
+    }
+
+    // long period periodics
+    double axnl = ep * std::cos(argpp);
+    double temp = 1.0 / (am * (1.0 - ep * ep));
+    double aynl = ep * std::sin(argpp) + temp * aycof;
+    double xl = mp + argpp + nodep + temp * xlcof * axnl;
+
+    // Kepler's equation
+    double u = std::fmod(xl - nodep, TWO_PI);
+    double eo1 = u, tem5 = 9999.9, sineo1 = 0.0, coseo1 = 0.0;
+    for (int ktr = 1; std::fabs(tem5) >= 1.0e-12 && ktr <= 10; ++ktr) {
+        sineo1 = std::sin(eo1);
+        coseo1 = std::cos(eo1);
+        tem5 = 1.0 - coseo1 * axnl - sineo1 * aynl;
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        tem5 = std::clamp(tem5, -0.95, 0.95);
+        eo1 = eo1 + tem5;
+    }
+
+    // short period preliminary quantities
+    double ecose = axnl * coseo1 + aynl * sineo1;
+    double esine = axnl * sineo1 - aynl * coseo1;
+    double el2 = axnl * axnl + aynl * aynl;
+    double pl = am * (1.0 - el2);
+    if (pl < 0.0) return 4;
+
+    double rl = am * (1.0 - ecose);
+    double rdotl = std::sqrt(am) * esine / rl;
+    double rvdotl = std::sqrt(pl) / rl;
+    double betal = std::sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = std::atan2(sinu, cosu);
+    double sin2u = (cosu + cosu) * sinu;
+    double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5 * J2 * temp;
+    double temp2 = temp1 * temp;
+
+    // short period periodics
+    double mrt = rl * (1.0 - 1.5 * temp2 * betal * con41) + 0.5 * temp1 * x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * x7thm1 * sin2u;
+    double xnode = nodep + 1.5 * temp2 * cosip * sin2u;
+    double xinc = xincp + 1.5 * temp2 * cosip * sinip * cos2u;
+    double mvt = rdotl - nm * temp1 * x1mth2 * sin2u / XKE;
+    double rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + 1.5 * con41) / XKE;
+
+    // orientation vectors
+    double sinsu = std::sin(su), cossu = std::cos(su);
+    double snod = std::sin(xnode), cnod = std::cos(xnode);
+    double sini = std::sin(xinc), cosi = std::cos(xinc);
+    double xmx = -snod * cosi, xmy = cnod * cosi;
+    glm::dvec3 ux(xmx * sinsu + cnod * cossu, xmy * sinsu + snod * cossu, sini * sinsu);
+    glm::dvec3 vx(xmx * cossu - cnod * sinsu, xmy * cossu - snod * sinsu, sini * cossu);
+
+    r = mrt * ux * Sgp4Catalog::EARTH_RADIUS;
+    v = (mvt * ux + rvdot * vx) * VKMPERSEC;
+    return mrt < 1.0 ? 6 : 0;
+}
+
+// initializes rec from the elements; false when SGP4 rejects them
+static bool sgp4init(const TwoLineElements& e, Sgp4Catalog::Record& rec) {
+    const double ss = 78.0 / Sgp4Catalog::EARTH_RADIUS + 1.0;
+    const double qzms2t = std::pow((120.0 - 78.0) / Sgp4Catalog::EARTH_RADIUS, 4);
+
+    rec = Sgp4Catalog::Record();
+    rec.epoch = e.epoch;
+    rec.bstar = e.bstar;
+    rec.ecco = e.eccentricity;
+    rec.argpo = e.argPerigee;
+    rec.inclo = e.inclination;
+    rec.mo = e.meanAnomaly;
+    rec.nodeo = e.raan;
+    if (e.meanMotion <= 0.0 || rec.ecco < 0.0 || rec.ecco >= 1.0) return false;
+
+    // recover the un-Kozai'd mean motion and semi-major axis
+    double eccsq = rec.ecco * rec.ecco;
+    double omeosq = 1.0 - eccsq;
+    double rteosq = std::sqrt(omeosq);
+    double cosio = std::cos(rec.inclo);
+    double cosio2 = cosio * cosio;
+    double ak = std::pow(XKE / e.meanMotion, X2O3);
+    double d1 = 0.75 * J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+    double del = d1 / (ak * ak);
+    double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+    del = d1 / (adel * adel);
+    rec.no = e.meanMotion / (1.0 + del);
+    double ao = std::pow(XKE / rec.no, X2O3);
+    double sinio = std::sin(rec.inclo);
+    double po = ao * omeosq;
+    double con42 = 1.0 - 5.0 * cosio2;
+    rec.con41 = -con42 - cosio2 - cosio2;
+    double posq = po * po;
+    double rp = ao * (1.0 - rec.ecco);
+    rec.ao = ao;
+    rec.sinio = sinio;
+    rec.cosio = cosio;
+    rec.gsto = gstime(rec.epoch);
+
+    rec.isimp = rp < 220.0 / Sgp4Catalog::EARTH_RADIUS + 1.0 ? 1 : 0;
+    double sfour = ss, qzms24 = qzms2t;
+    double perige = (rp - 1.0) * Sgp4Catalog::EARTH_RADIUS;
+    // for perigees below 156 km, s and qoms2t are altered
+    if (perige < 156.0) {
+        sfour = perige < 98.0 ? 20.0 : perige - 78.0;
+        qzms24 = std::pow((120.0 - sfour) / Sgp4Catalog::EARTH_RADIUS, 4);
+        sfour = sfour / Sgp4Catalog::EARTH_RADIUS + 1.0;
+    }
+    double pinvsq = 1.0 / posq;
+    double tsi = 1.0 / (ao - sfour);
+    rec.eta = ao * rec.ecco * tsi;
+    double etasq = rec.eta * rec.eta;
+    double eeta = rec.ecco * rec.eta;
+    double psisq = std::fabs(1.0 - etasq);
+    double coef = qzms24 * std::pow(tsi, 4);
+    double coef1 = coef / std::pow(psisq, 3.5);
+    double cc2 = coef1 * rec.no * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                                   0.375 * J2 * tsi / psisq * rec.con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+    rec.cc1 = rec.bstar * cc2;
+    double cc3 = rec.ecco > 1.0e-4 ? -2.0 * coef * tsi * J3OJ2 * rec.no * sinio / rec.ecco : 0.0;
+    rec.x1mth2 = 1.0 - cosio2;
+    rec.cc4 = 2.0 * rec.no * coef1 * ao * omeosq *
+              (rec.eta * (2.0 + 0.5 * etasq) + rec.ecco * (0.5 + 2.0 * etasq) -
+               J2 * tsi / (ao * psisq) * (-3.0 * rec.con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+                                          0.75 * rec.x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * std::cos(2.0 * rec.argpo)));
+    rec.cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+    double cosio4 = cosio2 * cosio2;
+    double temp1 = 1.5 * J2 * pinvsq * rec.no;
+    double temp2 = 0.5 * temp1 * J2 * pinvsq;
+    double temp3 = -0.46875 * J4 * pinvsq * pinvsq * rec.no;
+    rec.mdot = rec.no + 0.5 * temp1 * rteosq * rec.con41 + 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+    rec.argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+                  temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+    double xhdot1 = -temp1 * cosio;
+    rec.nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+    double xpidot = rec.argpdot + rec.nodedot;
+    rec.omgcof = rec.bstar * cc3 * std::cos(rec.argpo);
+    rec.xmcof = rec.ecco > 1.0e-4 ? -X2O3 * coef * rec.bstar / eeta : 0.0;
+    rec.nodecf = 3.5 * omeosq * xhdot1 * rec.cc1;
+    rec.t2cof = 1.5 * rec.cc1;
+    double denom = std::fabs(cosio + 1.0) > 1.5e-12 ? 1.0 + cosio : 1.5e-12;
+    rec.xlcof = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / denom;
+    rec.aycof = -0.5 * J3OJ2 * sinio;
+    double delmotemp = 1.0 + rec.eta * std::cos(rec.mo);
+    rec.delmo = delmotemp * delmotemp * delmotemp;
+    rec.sinmao = std::sin(rec.mo);
+    rec.x7thm1 = 7.0 * cosio2 - 1.0;
+
+    if (TWO_PI / rec.no >= DEEP_SPACE_PERIOD) {
+        rec.deepSpace = true;
+        rec.isimp = 1;
+        DeepSpaceInit c;
+        dscom(rec.epoch - 2433281.5, rec.ecco, rec.argpo, 0.0, rec.inclo, rec.nodeo, rec.no, rec, c);
+        dsinit(rec, c, xpidot);
+    }
+
+    if (rec.isimp != 1) {
+        double cc1sq = rec.cc1 * rec.cc1;
+        rec.d2 = 4.0 * ao * tsi * cc1sq;
+        double temp = rec.d2 * tsi * rec.cc1 / 3.0;
+        rec.d3 = (17.0 * ao + sfour) * temp;
+        rec.d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * rec.cc1;
+        rec.t3cof = rec.d2 + 2.0 * cc1sq;
+        rec.t4cof = 0.25 * (3.0 * rec.d3 + rec.cc1 * (12.0 * rec.d2 + 10.0 * cc1sq));
+        rec.t5cof = 0.2 * (3.0 * rec.d4 + 12.0 * rec.cc1 * rec.d3 + 6.0 * rec.d2 * rec.d2 +
+                           15.0 * cc1sq * (2.0 * rec.d2 + cc1sq));
+    }
+
+    glm::dvec3 r, v;
+    return sgp4(rec, 0.0, r, v) == 0;
+}
+
+// ---------------- TwoLineElements ----------------
+
+static bool checksumValid(const std::string& line) {
+    if (line.size() < 69 || line[68] < '0' || line[68] > '9') return true; // no checksum given
+    int sum = 0;
+    for (int i = 0; i < 68; ++i) {
+        if (line[i] >= '0' && line[i] <= '9') sum += line[i] - '0';
+        else if (line[i] == '-') sum += 1;
+    }
+    return sum % 10 == line[68] - '0';
+}
+
+// " 12345-3" style field: sign, implied-decimal mantissa, exponent
+static double impliedDecimal(const std::string& field) {
+    size_t split = field.find_last_of("+-");
+    if (split == std::string::npos || split == 0 || field.find_first_not_of(' ') == split) split = field.size();
+    std::string mantissa = field.substr(0, split);
+    double sign = 1.0;
+    size_t digits = mantissa.find_first_not_of(" +-");
+    if (mantissa.find('-') != std::string::npos && mantissa.find('-') < digits) sign = -1.0;
+    double value = digits == std::string::npos ? 0.0 : std::atof(("0." + mantissa.substr(digits)).c_str());
+    int exponent = split < field.size() ? std::atoi(field.substr(split).c_str()) : 0;
+    return sign * value * std::pow(10.0, exponent);
+}
+
+bool TwoLineElements::parse(const std::string& line1, const std::string& line2, TwoLineElements& out) {
+    if (line1.size() < 68 || line2.size() < 68 || line1[0] != '1' || line2[0] != '2') return false;
+    if (!checksumValid(line1) || !checksumValid(line2)) return false;
+
+    out.catalogNumber = std::atoi(line1.substr(2, 5).c_str());
+    int year = std::atoi(line1.substr(18, 2).c_str());
+    year += year < 57 ? 2000 : 1900;
+    double day = std::atof(line1.substr(20, 12).c_str());
+    // Julian date of January 0.0 of the year, then the day of year
+    double jan1 = 367.0 * year - std::floor(7.0 * year / 4.0) + 30.0 + 1.0 + 1721013.5;
+    out.epoch = jan1 + day - 1.0;
+    out.bstar = impliedDecimal(line1.substr(53, 8));
+
+    out.inclination = std::atof(line2.substr(8, 8).c_str()) * DEG;
+    out.raan = std::atof(line2.substr(17, 8).c_str()) * DEG;
+    out.eccentricity = std::atof(("0." + line2.substr(26, 7)).c_str());
+    out.argPerigee = std::atof(line2.substr(34, 8).c_str()) * DEG;
+    out.meanAnomaly = std::atof(line2.substr(43, 8).c_str()) * DEG;
+    out.meanMotion = std::atof(line2.substr(52, 11).c_str()) * TWO_PI / MINUTES_PER_DAY;
+    return out.meanMotion > 0.0;
+}
+
+// ---------------- Sgp4Catalog ----------------
+
+Sgp4Catalog::Sgp4Catalog() = default;
+Sgp4Catalog::~Sgp4Catalog() = default;
+
+static std::string trimmed(std::string s) {
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n' || s.back() == ' ')) s.pop_back();
+    return s;
+}
+
+size_t Sgp4Catalog::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "TLE catalog %s not found\n", path.c_str());
+        return 0;
+    }
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);)
+        lines.push_back(trimmed(line));
+
+    size_t added = 0, rejected = 0;
+    for (size_t i = 0; i + 1 < lines.size(); ++i) {
+        if (lines[i].empty() || lines[i + 1].empty() || lines[i][0] != '1' || lines[i + 1][0] != '2') continue;
+        TwoLineElements tle;
+        if (i > 0 && !lines[i - 1].empty() && lines[i - 1][0] != '2') {
+            // three-line sets name the object, sometimes behind a "0 "
+            tle.name = lines[i - 1].compare(0, 2, "0 ") == 0 ? lines[i - 1].substr(2) : lines[i - 1];
+        }
+        if (TwoLineElements::parse(lines[i], lines[i + 1], tle) && add(tle)) ++added;
+        else ++rejected;
+        ++i;
+    }
+    if (rejected > 0)
+        fprintf(stderr, "TLE catalog %s: %zu element sets could not be used\n", path.c_str(), rejected);
+    printf("TLE catalog %s: %zu objects (%zu deep space)\n", path.c_str(), added,
+           (size_t) std::count_if(records.begin(), records.end(), [](const Record& r) { return r.deepSpace; }));
+    return added;
+}
+
+bool Sgp4Catalog::add(const TwoLineElements& tle) {
+    Record rec;
+    if (!sgp4init(tle, rec)) return false;
+    elements.push_back(tle);
+    records.push_back(rec);
+    packed = false;
+    return true;
+}
+
+size_t Sgp4Catalog::size() const {
+    return records.size();
+}
+
+const TwoLineElements& Sgp4Catalog::getElements(size_t i) const {
+    return elements[i];
+}
+
+glm::dvec3 Sgp4Catalog::getPosition(size_t i) const {
+    return glm::dvec3(px[i], py[i], pz[i]);
+}
+
+glm::dvec3 Sgp4Catalog::getVelocity(size_t i) const {
+    return glm::dvec3(pvx[i], pvy[i], pvz[i]);
+}
+
+int Sgp4Catalog::getStatus(size_t i) const {
+    return status[i];
+}
+
+double Sgp4Catalog::julianDate(std::chrono::system_clock::time_point time) {
+    double seconds = std::chrono::duration<double>(time.time_since_epoch()).count();
+    return seconds / 86400.0 + 2440587.5;
+}
+
+void Sgp4Catalog::pack() {
+    nearIndex.clear();
+    deepIndex.clear();
+    for (size_t i = 0; i < records.size(); ++i)
+        (records[i].deepSpace ? deepIndex : nearIndex).push_back(i);
+
+    // the pad slot repeats the last object and is never written back
+    stride = (nearIndex.size() + 1) & ~size_t(1);
+    nearEarth.assign(NEAR_EARTH_FIELDS * stride, 0.0);
+    for (size_t k = 0; k < stride; ++k) {
+        const Record& r = records[nearIndex[std::min(k, nearIndex.size() - 1)]];
+        // simplified-drag objects drop the higher-order terms by zeroing them
+        bool full = r.isimp != 1;
+        const double values[NEAR_EARTH_FIELDS] = {
+            r.epoch, r.mo, r.mdot, r.argpo, r.argpdot, r.nodeo, r.nodedot, r.nodecf,
+            r.cc1, r.bstar * r.cc4, full ? r.bstar * r.cc5 : 0.0, r.t2cof,
+            full ? r.t3cof : 0.0, full ? r.t4cof : 0.0, full ? r.t5cof : 0.0,
+            full ? r.omgcof : 0.0, full ? r.xmcof : 0.0, r.eta, r.delmo, r.sinmao,
+            full ? r.d2 : 0.0, full ? r.d3 : 0.0, full ? r.d4 : 0.0,
+            r.ao, r.no, r.ecco, r.inclo, r.sinio, r.cosio, r.aycof, r.xlcof,
+            r.con41, r.x1mth2, r.x7thm1
+        };
+        for (int f = 0; f < NEAR_EARTH_FIELDS; ++f)
+            nearEarth[f * stride + k] = values[f];
+    }
+
+    size_t n = records.size();
+    for (std::vector<double>* v : { &px, &py, &pz, &pvx, &pvy, &pvz })
+        v->assign(n, 0.0);
+    status.assign(n, 0);
+    packed = true;
+}
+
+void Sgp4Catalog::store(size_t i, const glm::dvec3& position, const glm::dvec3& velocity, int code) {
+    px[i] = position.x * 1e3;
+    py[i] = position.y * 1e3;
+    pz[i] = position.z * 1e3;
+    pvx[i] = velocity.x * 1e3;
+    pvy[i] = velocity.y * 1e3;
+    pvz[i] = velocity.z * 1e3;
+    status[i] = code;
+}
+
+void Sgp4Catalog::nearEarthKernel(size_t begin, size_t end, double jd) {
+    const double* base = nearEarth.data();
+    auto at = [&](int field, size_t k) { return Double2::load(base + field * stride + k); };
+    const Double2 one(1.0), half(0.5), onePointFive(1.5), twoPi(TWO_PI), invTwoPi(1.0 / TWO_PI);
+    const Double2 xke(XKE), j2(J2), maxStep(0.95), tolerance(1.0e-12);
+
+    for (size_t k = begin; k < end; k += 2) {
+        Double2 t = (Double2(jd) - at(F_EPOCH, k)) * Double2(MINUTES_PER_DAY);
+        Double2 t2 = t * t, t3 = t2 * t, t4 = t3 * t;
+
+        // secular gravity and atmospheric drag
+        Double2 xmdf = at(F_MO, k) + at(F_MDOT, k) * t;
+        Double2 argpdf = at(F_ARGPO, k) + at(F_ARGPDOT, k) * t;
+        Double2 nodem = at(F_NODEO, k) + at(F_NODEDOT, k) * t + at(F_NODECF, k) * t2;
+        Double2 sinX, cosX;
+        sincos(xmdf, sinX, cosX);
+        Double2 delmtemp = one + at(F_ETA, k) * cosX;
+        Double2 delm = at(F_XMCOF, k) * (delmtemp * delmtemp * delmtemp - at(F_DELMO, k));
+        Double2 temp = at(F_OMGCOF, k) * t + delm;
+        Double2 mm = xmdf + temp;
+        Double2 argpm = argpdf - temp;
+        Double2 sinM, cosM;
+        sincos(mm, sinM, cosM);
+        Double2 tempa = one - at(F_CC1, k) * t - at(F_D2, k) * t2 - at(F_D3, k) * t3 - at(F_D4, k) * t4;
+        Double2 tempe = at(F_BC4, k) * t + at(F_BC5, k) * (sinM - at(F_SINMAO, k));
+        Double2 templ = at(F_T2COF, k) * t2 + at(F_T3COF, k) * t3 + t4 * (at(F_T4COF, k) + t * at(F_T5COF, k));
+
+        Double2 am = at(F_AO, k) * tempa * tempa;
+        Double2 nm = xke / (am * sqrt(am));
+        Double2 em = at(F_ECCO, k) - tempe;
+        Double2 eccentricityError = (em >= one) | (em < Double2(-0.001));
+        em = max(em, Double2(1.0e-6));
+        mm = mm + at(F_NO, k) * templ;
+
+        // long period periodics
+        Double2 sinArgp, cosArgp;
+        sincos(argpm, sinArgp, cosArgp);
+        Double2 axnl = em * cosArgp;
+        temp = one / (am * (one - em * em));
+        Double2 aynl = em * sinArgp + temp * at(F_AYCOF, k);
+        Double2 xl = mm + argpm + nodem + temp * at(F_XLCOF, k) * axnl;
+
+        // Kepler's equation, iterated until both lanes converge
+        Double2 u = xl - nodem;
+        u = u - twoPi * rint(u * invTwoPi);
+        Double2 eo1 = u, sinE, cosE;
+        for (int ktr = 0; ktr < 10; ++ktr) {
+            sincos(eo1, sinE, cosE);
+            Double2 tem5 = (u - aynl * cosE + axnl * sinE - eo1) / (one - cosE * axnl - sinE * aynl);
+            tem5 = min(max(tem5, -maxStep), maxStep);
+            eo1 += tem5;
+            if ((abs(tem5) >= tolerance).mask() == 0) break;
+        }
+
+        // short period preliminary quantities
+        Double2 ecose = axnl * cosE + aynl * sinE;
+        Double2 esine = axnl * sinE - aynl * cosE;
+        Double2 el2 = axnl * axnl + aynl * aynl;
+        Double2 pl = am * (one - el2);
+        Double2 semiLatusError = pl < Double2(0.0);
+        pl = max(pl, Double2(1.0e-12));
+        Double2 rl = am * (one - ecose);
+        Double2 rdotl = sqrt(am) * esine / rl;
+        Double2 rvdotl = sqrt(pl) / rl;
+        Double2 betal = sqrt(one - el2);
+        temp = esine / (one + betal);
+        Double2 sinu = am / rl * (sinE - aynl - axnl * temp);
+        Double2 cosu = am / rl * (cosE - axnl + aynl * temp);
+        Double2 sin2u = (cosu + cosu) * sinu;
+        Double2 cos2u = one - Double2(2.0) * sinu * sinu;
+        temp = one / pl;
+        Double2 temp1 = half * j2 * temp;
+        Double2 temp2 = temp1 * temp;
+
+        // short period periodics; su is shifted through its sine and cosine
+        Double2 con41 = at(F_CON41, k), x1mth2 = at(F_X1MTH2, k), cosio = at(F_COSIO, k);
+        Double2 mrt = rl * (one - onePointFive * temp2 * betal * con41) + half * temp1 * x1mth2 * cos2u;
+        Double2 dsu = Double2(-0.25) * temp2 * at(F_X7THM1, k) * sin2u;
+        Double2 xnode = nodem + onePointFive * temp2 * cosio * sin2u;
+        Double2 xinc = at(F_INCLO, k) + onePointFive * temp2 * cosio * at(F_SINIO, k) * cos2u;
+        Double2 mvt = rdotl - nm * temp1 * x1mth2 * sin2u / xke;
+        Double2 rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + onePointFive * con41) / xke;
+
+        // orientation vectors
+        Double2 sinD, cosD, snod, cnod, sini, cosi;
+        sincos(dsu, sinD, cosD);
+        sincos(xnode, snod, cnod);
+        sincos(xinc, sini, cosi);
+        Double2 sinsu = sinu * cosD + cosu * sinD;
+        Double2 cossu = cosu * cosD - sinu * sinD;
+        Double2 xmx = -snod * cosi, xmy = cnod * cosi;
+        Double2 ux = xmx * sinsu + cnod * cossu, uy = xmy * sinsu + snod * cossu, uz = sini * sinsu;
+        Double2 vx = xmx * cossu - cnod * sinsu, vy = xmy * cossu - snod * sinsu, vz = sini * cossu;
+
+        Double2 rScale = mrt * Double2(EARTH_RADIUS * 1e3);
+        Double2 vScale = Double2(VKMPERSEC * 1e3);
+        double out[6][2];
+        (rScale * ux).store(out[0]);
+        (rScale * uy).store(out[1]);
+        (rScale * uz).store(out[2]);
+        ((mvt * ux + rvdot * vx) * vScale).store(out[3]);
+        ((mvt * uy + rvdot * vy) * vScale).store(out[4]);
+        ((mvt * uz + rvdot * vz) * vScale).store(out[5]);
+        int eccentricityLanes = eccentricityError.mask();
+        int semiLatusLanes = semiLatusError.mask();
+        int decayedLanes = (mrt < one).mask();
+
+        for (int lane = 0; lane < 2 && k + lane < nearIndex.size(); ++lane) {
+            size_t i = nearIndex[k + lane];
+            px[i] = out[0][lane];
+            py[i] = out[1][lane];
+            pz[i] = out[2][lane];
+            pvx[i] = out[3][lane];
+            pvy[i] = out[4][lane];
+            pvz[i] = out[5][lane];
+            int bit = 1 << lane;
+            status[i] = eccentricityLanes & bit ? 1 : semiLatusLanes & bit ? 4 : decayedLanes & bit ? 6 : 0;
+        }
+    }
+}
+
+void Sgp4Catalog::propagate(double jd, ThreadPool& workers) {
+    PROFILE_SCOPE("sgp4");
+    if (records.empty()) return;
+    if (!packed) pack();
+
+    if (!nearIndex.empty()) {
+        workers.parallelFor(stride / 2, SGP4_GRAIN, [&](size_t begin, size_t end, size_t) {
+            nearEarthKernel(2 * begin, 2 * end, jd);
+        });
+    }
+    workers.parallelFor(deepIndex.size(), SDP4_GRAIN, [&](size_t begin, size_t end, size_t) {
+        for (size_t d = begin; d < end; ++d) {
+            size_t i = deepIndex[d];
+            glm::dvec3 r(0.0), v(0.0);
+            int code = sgp4(records[i], (jd - records[i].epoch) * MINUTES_PER_DAY, r, v);
+            store(i, r, v, code);
+        }
+    });
+}
+
+int Sgp4Catalog::propagate(size_t i, double minutes, glm::dvec3& position, glm::dvec3& velocity) {
+    return sgp4(records[i], minutes, position, velocity);
+}
+
+void Sgp4Catalog::addSynthetic(size_t objects, double epoch, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    // a catalog-like mix: LEO, then GPS, Molniya and geostationary objects
+    size_t target = size() + objects;
+    while (size() < target) {
+        TwoLineElements tle;
+        double pick = unit(rng);
+        double revsPerDay, ecc, incl;
+        if (pick < 0.9) {
+            revsPerDay = 12.0 + 4.0 * unit(rng);
+            ecc = 0.02 * unit(rng) * unit(rng);
+            incl = 100.0 * unit(rng);
+        } else if (pick < 0.95) {
+            revsPerDay = 2.0056;
+            ecc = 0.01 * unit(rng);
+            incl = 55.0;
+        } else if (pick < 0.97) {
+            revsPerDay = 2.0060;
+            ecc = 0.70 + 0.03 * unit(rng);
+            incl = 63.4;
+        } else {
+            revsPerDay = 1.0027;
+            ecc = 0.0005 * unit(rng);
+            incl = 0.1 * unit(rng);
+        }
+        tle.catalogNumber = (int) size() + 1;
+        tle.epoch = epoch - 5.0 * unit(rng);
+        tle.bstar = 1e-4 * unit(rng);
+        tle.inclination = incl * DEG;
+        tle.raan = TWO_PI * unit(rng);
+        tle.eccentricity = ecc;
+        tle.argPerigee = TWO_PI * unit(rng);
+        tle.meanAnomaly = TWO_PI * unit(rng);
+        tle.meanMotion = revsPerDay * TWO_PI / MINUTES_PER_DAY;
+        add(tle);
+    }
+}
+
+void Sgp4Catalog::benchmark(int objects) {
+    Sgp4Catalog catalog;
+    double epoch = julianDate(std::chrono::system_clock::now());
+    catalog.addSynthetic(std::max(objects, 1), epoch);
+
+    ThreadPool workers;
+    catalog.propagate(epoch, workers); // warm up and pack
+    printf("%zu objects, %zu deep space, %u threads\n", catalog.size(), catalog.deepIndex.size(), workers.size() + 1);
+
+    // the SIMD path against the scalar one
+    double worst = 0.0;
+    for (size_t i : catalog.nearIndex) {
+        glm::dvec3 r, v;
+        catalog.propagate(i, (epoch - catalog.records[i].epoch) * MINUTES_PER_DAY, r, v);
+        worst = std::max(worst, glm::length(r * 1e3 - catalog.getPosition(i)));
+    }
+    printf("max SIMD / scalar difference: %.3g m\n", worst);
+
+    const int reps = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r)
+        catalog.propagate(epoch + r / MINUTES_PER_DAY, workers);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / reps;
+    printf("%.2f ms per propagation, %.1f ns per object\n", ms, ms * 1e6 / catalog.size());
+}
@@ -0,0 +1,140 @@
+#include "physics/solar_irradiance.h"
+#include "physics/physics_engine.h"
+#include "physics/sphere_bvh.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <bit>
+#include <cmath>
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double GOLDEN_ANGLE = 2.399963229728653; // pi * (3 - sqrt(5))
+
+// bodies shaded per worker chunk
+constexpr size_t SHADE_GRAIN = 64;
+
+// any orthonormal pair across w will do; start from the axis least aligned with it
+static void perpendicularBasis(const glm::dvec3& w, glm::dvec3& u, glm::dvec3& v) {
+    glm::dvec3 axis = std::abs(w.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+    u = glm::normalize(glm::cross(w, axis));
+    v = glm::cross(w, u);
+}
+
+// ---------------- SolarIrradiance ----------------
+
+SolarIrradiance::SolarIrradiance() {
+    // Vogel spiral: equal-area samples with no clumping at the center
+    for (int k = 0; k < DISC_SAMPLES; ++k) {
+        double r = std::sqrt((k + 0.5) / DISC_SAMPLES);
+        double theta = k * GOLDEN_ANGLE;
+        disc[k] = glm::vec2(r * std::cos(theta), r * std::sin(theta));
+    }
+}
+
+void SolarIrradiance::setSun(int id, double luminosity) {
+    sunID = id;
+    this->luminosity = luminosity;
+}
+
+int SolarIrradiance::getSun() const {
+    return sunID;
+}
+
+const SphereBVH& SolarIrradiance::getBVH() const {
+    return bvh;
+}
+
+void SolarIrradiance::update(const std::unordered_map<int, PhysObj*>& physObjs, ThreadPool& workers) {
+    PROFILE_SCOPE("irradiance");
+    auto sunIt = physObjs.find(sunID);
+    if (sunIt == physObjs.end()) return;
+    PhysObj* sun = sunIt->second;
+    sun->illumination = Illumination();
+
+    // the Sun is the light, not an occluder, so it stays out of the tree
+    bodies.clear();
+    centers.clear();
+    radii.clear();
+    for (auto& [id, obj] : physObjs) {
+        if (id == sunID) continue;
+        bodies.push_back(obj);
+        centers.push_back(obj->pos);
+        radii.push_back(obj->radius);
+    }
+    bvh.update(centers, radii);
+
+    glm::dvec3 sunPos = sun->pos;
+    double sunRadius = sun->radius;
+    workers.parallelFor(bodies.size(), SHADE_GRAIN, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            shade((int) i, sunPos, sunRadius);
+    });
+}
+
+float SolarIrradiance::discVisibility(const glm::dvec3& point, const glm::dvec3& sunPos, double sunRadius, int skip) const {
+    glm::dvec3 u, v;
+    perpendicularBasis(glm::normalize(sunPos - point), u, v);
+
+    int blocked = 0;
+    for (int p = 0; p < DISC_SAMPLES; p += SphereBVH::PACKET_SIZE) {
+        SphereBVH::RayPacket packet;
+        packet.origin = point;
+        for (int k = 0; k < SphereBVH::PACKET_SIZE; ++k) {
+            glm::dvec3 target = sunPos + sunRadius * (double(disc[p + k].x) * u + double(disc[p + k].y) * v);
+            glm::dvec3 dir = target - point;
+            double length = glm::length(dir);
+            dir /= length;
+            packet.dx[k] = (float) dir.x;
+            packet.dy[k] = (float) dir.y;
+            packet.dz[k] = (float) dir.z;
+            packet.tMax[k] = (float) length;
+        }
+        blocked += std::popcount((unsigned) bvh.occluded(packet, skip));
+    }
+    return 1.0f - float(blocked) / DISC_SAMPLES;
+}
+
+void SolarIrradiance::shade(int index, const glm::dvec3& sunPos, double sunRadius) const {
+    PhysObj* obj = bodies[index];
+    Illumination& light = obj->illumination;
+    glm::dvec3 toSun = sunPos - obj->pos;
+    double distance = glm::length(toSun);
+    if (distance <= sunRadius) {
+        light = Illumination();
+        return;
+    }
+    light.sunDir = toSun / distance;
+
+    float visible = 0.0f;
+    int samples = 0, dark = 0, partial = 0;
+    auto sample = [&](const glm::dvec3& point) {
+        float v = discVisibility(point, sunPos, sunRadius, index);
+        visible += v;
+        dark += v == 0.0f;
+        partial += v > 0.0f && v < 1.0f;
+        ++samples;
+    };
+
+    double r = radii[index];
+    if (r <= 0.0) {
+        sample(obj->pos);
+    } else {
+        // the sunward hemisphere is what can be shadowed; the receiver itself is skipped
+        sample(obj->pos + r * light.sunDir);
+        glm::dvec3 u, v;
+        perpendicularBasis(light.sunDir, u, v);
+        for (int i = 0; i < RING_SAMPLES; ++i) {
+            double phi = 2.0 * PI * i / RING_SAMPLES;
+            glm::dvec3 normal = std::cos(RING_ANGLE) * light.sunDir
+                              + std::sin(RING_ANGLE) * (std::cos(phi) * u + std::sin(phi) * v);
+            sample(obj->pos + r * normal);
+        }
+    }
+
+    light.litFraction = visible / samples;
+    light.umbra = float(dark) / samples;
+    light.penumbra = float(partial) / samples;
+    light.irradiance = luminosity / (4.0 * PI * distance * distance) * light.litFraction;
+}
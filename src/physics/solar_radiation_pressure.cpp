@@ -0,0 +1,238 @@
+#include "physics/solar_radiation_pressure.h"
+#include "physics/physics_engine.h"
+#include "physics/force_model.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SRP_SSE2
+#endif
+
+constexpr double PI = 3.14159265358979323846;
+
+// participant pairs per worker chunk
+constexpr size_t SRP_GRAIN = 512;
+
+// Visible share of the Sun's disc from point with one occluder in the way,
+// from the overlap of the two apparent discs (Montenbruck & Gill 3.4.2)
+static double occluderVisibility(const glm::dvec3& point, const glm::dvec3& sunPos, double sunRadius,
+                                 const glm::dvec3& occluder, double occluderRadius) {
+    glm::dvec3 s = sunPos - point, p = occluder - point;
+    double ds = glm::length(s), dp = glm::length(p);
+    if (dp <= occluderRadius) return 0.0;
+    if (dp >= ds) return 1.0;
+
+    double a = std::asin(std::min(sunRadius / ds, 1.0));
+    double b = std::asin(occluderRadius / dp);
+    double c = std::acos(std::clamp(glm::dot(s, p) / (ds * dp), -1.0, 1.0));
+    if (c >= a + b) return 1.0;
+    if (c <= b - a) return 0.0;                   // umbra
+    if (c <= a - b) return 1.0 - b * b / (a * a); // annular
+
+    double x = (c * c + a * a - b * b) / (2.0 * c);
+    double y = std::sqrt(std::max(a * a - x * x, 0.0));
+    double area = a * a * std::acos(std::clamp(x / a, -1.0, 1.0))
+                + b * b * std::acos(std::clamp((c - x) / b, -1.0, 1.0)) - c * y;
+    return std::clamp(1.0 - area / (PI * a * a), 0.0, 1.0);
+}
+
+// ---------------- SolarRadiationPressure ----------------
+
+SolarRadiationPressure::SolarRadiationPressure(int sunID, double luminosity)
+    : sunID(sunID), luminosity(luminosity) {}
+
+const char* SolarRadiationPressure::name() const {
+    return "srp";
+}
+
+void SolarRadiationPressure::setBody(int id, const SrpProperties& p) {
+    properties[id] = p;
+}
+
+void SolarRadiationPressure::removeBody(int id) {
+    properties.erase(id);
+}
+
+size_t SolarRadiationPressure::bodyCount() const {
+    return properties.size();
+}
+
+void SolarRadiationPressure::pack(const BodyBatch& batch) {
+    batchIndex.clear();
+    for (auto& [id, p] : properties) {
+        int i = batch.find(id);
+        if (i >= 0 && batch.mass[i] > 0.0 && p.area > 0.0 && id != sunID)
+            batchIndex.push_back(i);
+    }
+    count = batchIndex.size();
+    size_t padded = (count + 1) & ~size_t(1);
+    for (std::vector<double>* v : { &px, &py, &pz, &cannon, &plateS, &plateN1, &plateN0, &nx, &ny, &nz,
+                                    &lit, &outX, &outY, &outZ })
+        v->assign(padded, 0.0);
+
+    for (size_t k = 0; k < count; ++k) {
+        int i = batchIndex[k];
+        const SrpProperties& p = properties.at(batch.ids[i]);
+        double areaToMass = p.area / batch.mass[i];
+        px[k] = batch.x[i];
+        py[k] = batch.y[i];
+        pz[k] = batch.z[i];
+        if (p.shape == SrpShape::Cannonball) {
+            cannon[k] = p.reflectivity * areaToMass;
+        } else {
+            glm::dvec3 n = glm::normalize(p.normal);
+            plateS[k] = areaToMass * (1.0 - p.specular);
+            plateN1[k] = areaToMass * 2.0 * p.specular;
+            plateN0[k] = areaToMass * 2.0 / 3.0 * p.diffuse;
+            nx[k] = n.x;
+            ny[k] = n.y;
+            nz[k] = n.z;
+        }
+        lit[k] = shadows == ShadowModel::Traced ? batch.objs[i]->illumination.litFraction : 1.0;
+    }
+    // the pad lane sits 1 m from the origin so it never divides by zero
+    if (padded > count) px[count] = 1.0;
+
+    occluderIndex.clear();
+    ox.clear();
+    oy.clear();
+    oz.clear();
+    oRadius.clear();
+    if (shadows != ShadowModel::Conical) return;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch.ids[i] == sunID || batch.radius[i] < minOccluderRadius) continue;
+        occluderIndex.push_back((int) i);
+        ox.push_back(batch.x[i]);
+        oy.push_back(batch.y[i]);
+        oz.push_back(batch.z[i]);
+        oRadius.push_back(batch.radius[i]);
+    }
+}
+
+double SolarRadiationPressure::conicalShadow(size_t k, const glm::dvec3& sunPos, double sunRadius) const {
+    glm::dvec3 point(px[k], py[k], pz[k]);
+    double visible = 1.0;
+    for (size_t j = 0; j < occluderIndex.size() && visible > 0.0; ++j) {
+        if (occluderIndex[j] == batchIndex[k]) continue;
+        visible *= occluderVisibility(point, sunPos, sunRadius, glm::dvec3(ox[j], oy[j], oz[j]), oRadius[j]);
+    }
+    return visible;
+}
+
+void SolarRadiationPressure::kernel(size_t begin, size_t end, const glm::dvec3& sunPos, double sunRadius) {
+    // L / (4 pi c): pressure at distance r is this over r^2
+    const double k0 = luminosity / (4.0 * PI * SPEED_OF_LIGHT);
+#ifdef SRP_SSE2
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d sx = _mm_set1_pd(sunPos.x), sy = _mm_set1_pd(sunPos.y), sz = _mm_set1_pd(sunPos.z);
+    for (size_t k = begin; k < end; k += 2) {
+        __m128d x = _mm_loadu_pd(&px[k]), y = _mm_loadu_pd(&py[k]), z = _mm_loadu_pd(&pz[k]);
+        __m128d dx = _mm_sub_pd(sx, x), dy = _mm_sub_pd(sy, y), dz = _mm_sub_pd(sz, z);
+        __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+        __m128d invR = _mm_div_pd(one, _mm_sqrt_pd(r2));
+        __m128d ux = _mm_mul_pd(dx, invR), uy = _mm_mul_pd(dy, invR), uz = _mm_mul_pd(dz, invR);
+
+        __m128d nu = _mm_loadu_pd(&lit[k]);
+        if (!occluderIndex.empty()) {
+            // cone screen: the discs can only overlap if the angle c between the
+            // Sun and occluder is below a + b, i.e. t > |p| cos(a + b)
+            __m128d sinA = _mm_mul_pd(_mm_set1_pd(sunRadius), invR);
+            __m128d cosA = _mm_sqrt_pd(_mm_max_pd(_mm_sub_pd(one, _mm_mul_pd(sinA, sinA)), zero));
+            double shade[2];
+            _mm_storeu_pd(shade, nu);
+            for (size_t j = 0; j < occluderIndex.size(); ++j) {
+                __m128d qx = _mm_sub_pd(_mm_set1_pd(ox[j]), x);
+                __m128d qy = _mm_sub_pd(_mm_set1_pd(oy[j]), y);
+                __m128d qz = _mm_sub_pd(_mm_set1_pd(oz[j]), z);
+                __m128d q2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(qx, qx), _mm_mul_pd(qy, qy)), _mm_mul_pd(qz, qz));
+                __m128d t = _mm_add_pd(_mm_add_pd(_mm_mul_pd(qx, ux), _mm_mul_pd(qy, uy)), _mm_mul_pd(qz, uz));
+                __m128d q = _mm_sqrt_pd(q2);
+                __m128d rad = _mm_set1_pd(oRadius[j]);
+                __m128d sinB = _mm_div_pd(rad, q);
+                __m128d cosB = _mm_sqrt_pd(_mm_max_pd(_mm_sub_pd(one, _mm_mul_pd(sinB, sinB)), zero));
+                __m128d cosAB = _mm_sub_pd(_mm_mul_pd(cosA, cosB), _mm_mul_pd(sinA, sinB));
+                __m128d overlaps = _mm_or_pd(_mm_cmpgt_pd(t, _mm_mul_pd(q, cosAB)), _mm_cmple_pd(q2, _mm_mul_pd(rad, rad)));
+                int mask = _mm_movemask_pd(overlaps);
+                if (mask == 0) continue;
+                for (int lane = 0; lane < 2; ++lane) {
+                    size_t m = k + lane;
+                    if (!((mask >> lane) & 1) || m >= count || occluderIndex[j] == batchIndex[m]) continue;
+                    shade[lane] *= occluderVisibility(glm::dvec3(px[m], py[m], pz[m]), sunPos, sunRadius,
+                                                      glm::dvec3(ox[j], oy[j], oz[j]), oRadius[j]);
+                }
+            }
+            nu = _mm_loadu_pd(shade);
+        }
+        __m128d flux = _mm_div_pd(_mm_mul_pd(_mm_set1_pd(k0), nu), r2);
+
+        // plate normal flipped toward the Sun; cannonballs have zero plate terms
+        __m128d cosT = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&nx[k]), ux),
+                                             _mm_mul_pd(_mm_loadu_pd(&ny[k]), uy)),
+                                  _mm_mul_pd(_mm_loadu_pd(&nz[k]), uz));
+        __m128d flip = _mm_and_pd(cosT, signMask);
+        cosT = _mm_andnot_pd(signMask, cosT);
+        __m128d fx = _mm_xor_pd(_mm_loadu_pd(&nx[k]), flip);
+        __m128d fy = _mm_xor_pd(_mm_loadu_pd(&ny[k]), flip);
+        __m128d fz = _mm_xor_pd(_mm_loadu_pd(&nz[k]), flip);
+        __m128d alongSun = _mm_add_pd(_mm_loadu_pd(&cannon[k]), _mm_mul_pd(_mm_loadu_pd(&plateS[k]), cosT));
+        __m128d alongNormal = _mm_mul_pd(cosT, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&plateN1[k]), cosT),
+                                                          _mm_loadu_pd(&plateN0[k])));
+
+        // pushes away from the Sun
+        __m128d negFlux = _mm_xor_pd(flux, signMask);
+        _mm_storeu_pd(&outX[k], _mm_mul_pd(negFlux, _mm_add_pd(_mm_mul_pd(alongSun, ux), _mm_mul_pd(alongNormal, fx))));
+        _mm_storeu_pd(&outY[k], _mm_mul_pd(negFlux, _mm_add_pd(_mm_mul_pd(alongSun, uy), _mm_mul_pd(alongNormal, fy))));
+        _mm_storeu_pd(&outZ[k], _mm_mul_pd(negFlux, _mm_add_pd(_mm_mul_pd(alongSun, uz), _mm_mul_pd(alongNormal, fz))));
+    }
+#else
+    for (size_t k = begin; k < end && k < count; ++k) {
+        glm::dvec3 d = sunPos - glm::dvec3(px[k], py[k], pz[k]);
+        double r2 = glm::dot(d, d);
+        glm::dvec3 u = d / std::sqrt(r2);
+        double nu = lit[k];
+        if (!occluderIndex.empty()) nu *= conicalShadow(k, sunPos, sunRadius);
+        double flux = k0 * nu / r2;
+
+        glm::dvec3 n(nx[k], ny[k], nz[k]);
+        double cosT = glm::dot(n, u);
+        if (cosT < 0.0) {
+            n = -n;
+            cosT = -cosT;
+        }
+        double alongSun = cannon[k] + plateS[k] * cosT;
+        double alongNormal = cosT * (plateN1[k] * cosT + plateN0[k]);
+        glm::dvec3 a = -flux * (alongSun * u + alongNormal * n);
+        outX[k] = a.x;
+        outY[k] = a.y;
+        outZ[k] = a.z;
+    }
+#endif
+}
+
+void SolarRadiationPressure::evaluate(BodyBatch& batch, ThreadPool& workers) {
+    PROFILE_SCOPE("srp");
+    int sun = batch.find(sunID);
+    if (sun < 0) return;
+    pack(batch);
+    if (count == 0) return;
+
+    glm::dvec3 sunPos(batch.x[sun], batch.y[sun], batch.z[sun]);
+    double sunRadius = batch.radius[sun];
+    size_t pairs = (count + 1) / 2;
+    workers.parallelFor(pairs, SRP_GRAIN, [&](size_t begin, size_t end, size_t) {
+        kernel(2 * begin, 2 * end, sunPos, sunRadius);
+    });
+
+    for (size_t k = 0; k < count; ++k) {
+        int i = batchIndex[k];
+        batch.ax[i] += outX[k];
+        batch.ay[i] += outY[k];
+        batch.az[i] += outZ[k];
+    }
+}
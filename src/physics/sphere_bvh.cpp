@@ -0,0 +1,231 @@
+#include "physics/sphere_bvh.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SPHERE_BVH_SSE
+#endif
+
+// enough for any tree: each level leaves at most one extra node on the stack
+constexpr int MAX_STACK = 64;
+
+// packet directions splatted once per query
+struct PacketLanes {
+#ifdef SPHERE_BVH_SSE
+    __m128 dx, dy, dz, invX, invY, invZ, tMax;
+#else
+    float dx[4], dy[4], dz[4], invX[4], invY[4], invZ[4], tMax[4];
+#endif
+};
+
+static PacketLanes splat(const SphereBVH::RayPacket& p) {
+    PacketLanes l;
+#ifdef SPHERE_BVH_SSE
+    __m128 one = _mm_set1_ps(1.0f);
+    l.dx = _mm_loadu_ps(p.dx);
+    l.dy = _mm_loadu_ps(p.dy);
+    l.dz = _mm_loadu_ps(p.dz);
+    l.invX = _mm_div_ps(one, l.dx);
+    l.invY = _mm_div_ps(one, l.dy);
+    l.invZ = _mm_div_ps(one, l.dz);
+    l.tMax = _mm_loadu_ps(p.tMax);
+#else
+    for (int k = 0; k < 4; ++k) {
+        l.dx[k] = p.dx[k];
+        l.dy[k] = p.dy[k];
+        l.dz[k] = p.dz[k];
+        l.invX[k] = 1.0f / p.dx[k];
+        l.invY[k] = 1.0f / p.dy[k];
+        l.invZ[k] = 1.0f / p.dz[k];
+        l.tMax[k] = p.tMax[k];
+    }
+#endif
+    return l;
+}
+
+// slab test of an origin-relative box, bit k set if ray k enters it before tMax
+static int boxMask(const PacketLanes& l, const glm::vec3& lo, const glm::vec3& hi) {
+#ifdef SPHERE_BVH_SSE
+    __m128 x0 = _mm_mul_ps(_mm_set1_ps(lo.x), l.invX), x1 = _mm_mul_ps(_mm_set1_ps(hi.x), l.invX);
+    __m128 y0 = _mm_mul_ps(_mm_set1_ps(lo.y), l.invY), y1 = _mm_mul_ps(_mm_set1_ps(hi.y), l.invY);
+    __m128 z0 = _mm_mul_ps(_mm_set1_ps(lo.z), l.invZ), z1 = _mm_mul_ps(_mm_set1_ps(hi.z), l.invZ);
+    __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_min_ps(z0, z1));
+    __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_max_ps(z0, z1));
+    __m128 enters = _mm_and_ps(_mm_cmple_ps(_mm_max_ps(tNear, _mm_setzero_ps()), tFar),
+                               _mm_cmple_ps(tNear, l.tMax));
+    return _mm_movemask_ps(enters);
+#else
+    int mask = 0;
+    for (int k = 0; k < 4; ++k) {
+        float x0 = lo.x * l.invX[k], x1 = hi.x * l.invX[k];
+        float y0 = lo.y * l.invY[k], y1 = hi.y * l.invY[k];
+        float z0 = lo.z * l.invZ[k], z1 = hi.z * l.invZ[k];
+        float tNear = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::min(z0, z1));
+        float tFar = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::max(z0, z1));
+        mask |= int(std::max(tNear, 0.0f) <= tFar && tNear <= l.tMax[k]) << k;
+    }
+    return mask;
+#endif
+}
+
+// bit k set if ray k crosses the sphere inside (0, tMax). The closest approach
+// is taken from the perpendicular offset rather than |oc|^2 - r^2, which
+// would cancel catastrophically in float for spheres far from the origin
+static int sphereMask(const PacketLanes& l, const glm::vec3& oc, float radius) {
+#ifdef SPHERE_BVH_SSE
+    __m128 cx = _mm_set1_ps(oc.x), cy = _mm_set1_ps(oc.y), cz = _mm_set1_ps(oc.z);
+    __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, l.dx), _mm_mul_ps(cy, l.dy)), _mm_mul_ps(cz, l.dz));
+    __m128 hx = _mm_sub_ps(cx, _mm_mul_ps(b, l.dx));
+    __m128 hy = _mm_sub_ps(cy, _mm_mul_ps(b, l.dy));
+    __m128 hz = _mm_sub_ps(cz, _mm_mul_ps(b, l.dz));
+    __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, hx), _mm_mul_ps(hy, hy)), _mm_mul_ps(hz, hz));
+    __m128 r2 = _mm_set1_ps(radius * radius);
+    __m128 s = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(r2, d2), _mm_setzero_ps()));
+    __m128 hits = _mm_and_ps(_mm_cmple_ps(d2, r2),
+                  _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(b, s), _mm_setzero_ps()),
+                             _mm_cmplt_ps(_mm_sub_ps(b, s), l.tMax)));
+    return _mm_movemask_ps(hits);
+#else
+    int mask = 0;
+    for (int k = 0; k < 4; ++k) {
+        float b = oc.x * l.dx[k] + oc.y * l.dy[k] + oc.z * l.dz[k];
+        glm::vec3 h = oc - b * glm::vec3(l.dx[k], l.dy[k], l.dz[k]);
+        float d2 = glm::dot(h, h), r2 = radius * radius;
+        float s = std::sqrt(std::max(r2 - d2, 0.0f));
+        mask |= int(d2 <= r2 && b + s > 0.0f && b - s < l.tMax[k]) << k;
+    }
+    return mask;
+#endif
+}
+
+static double surfaceArea(const glm::dvec3& lo, const glm::dvec3& hi) {
+    glm::dvec3 e = hi - lo;
+    return 2.0 * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// ---------------- SphereBVH ----------------
+
+void SphereBVH::build(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii) {
+    int count = (int) centers.size();
+    nodes.clear();
+    indices.resize(count);
+    for (int i = 0; i < count; ++i)
+        indices[i] = i;
+    leafCenters.resize(count);
+    leafRadii.resize(count);
+    builtArea = 0.0;
+    if (count == 0) return;
+
+    nodes.reserve(2 * count);
+    nodes.push_back({});
+    buildNode(centers, 0, 0, count);
+    builtArea = refitBounds(centers, radii);
+}
+
+void SphereBVH::buildNode(const std::vector<glm::dvec3>& centers, int index, int begin, int end) {
+    if (end - begin <= LEAF_SIZE) {
+        nodes[index].first = begin;
+        nodes[index].count = end - begin;
+        return;
+    }
+
+    // split at the median along the widest spread of centers
+    glm::dvec3 lo(std::numeric_limits<double>::max()), hi(-std::numeric_limits<double>::max());
+    for (int i = begin; i < end; ++i) {
+        lo = glm::min(lo, centers[indices[i]]);
+        hi = glm::max(hi, centers[indices[i]]);
+    }
+    glm::dvec3 extent = hi - lo;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    int mid = (begin + end) / 2;
+    std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end,
+                     [&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+
+    // children go in as a pair, after their parent
+    int left = (int) nodes.size();
+    nodes.push_back({});
+    nodes.push_back({});
+    nodes[index].first = left;
+    nodes[index].count = 0;
+    buildNode(centers, left, begin, mid);
+    buildNode(centers, left + 1, mid, end);
+}
+
+double SphereBVH::refitBounds(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii) {
+    for (size_t s = 0; s < indices.size(); ++s) {
+        leafCenters[s] = centers[indices[s]];
+        leafRadii[s] = radii[indices[s]];
+    }
+
+    // children always follow their parent, so one reverse sweep is bottom-up
+    double area = 0.0;
+    for (size_t n = nodes.size(); n-- > 0;) {
+        Node& node = nodes[n];
+        if (node.count > 0) {
+            node.lo = glm::dvec3(std::numeric_limits<double>::max());
+            node.hi = glm::dvec3(-std::numeric_limits<double>::max());
+            for (int s = node.first; s < node.first + node.count; ++s) {
+                node.lo = glm::min(node.lo, leafCenters[s] - leafRadii[s]);
+                node.hi = glm::max(node.hi, leafCenters[s] + leafRadii[s]);
+            }
+        } else {
+            node.lo = glm::min(nodes[node.first].lo, nodes[node.first + 1].lo);
+            node.hi = glm::max(nodes[node.first].hi, nodes[node.first + 1].hi);
+        }
+        area += surfaceArea(node.lo, node.hi);
+    }
+    return area;
+}
+
+void SphereBVH::refit(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii) {
+    refitBounds(centers, radii);
+}
+
+bool SphereBVH::update(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii) {
+    if (centers.size() != indices.size() || nodes.empty()) {
+        build(centers, radii);
+        return true;
+    }
+    if (refitBounds(centers, radii) > builtArea * REBUILD_GROWTH) {
+        build(centers, radii);
+        return true;
+    }
+    return false;
+}
+
+int SphereBVH::occluded(const RayPacket& packet, int skip) const {
+    if (nodes.empty()) return 0;
+    PacketLanes lanes = splat(packet);
+    const int all = (1 << PACKET_SIZE) - 1;
+
+    int hit = 0;
+    int stack[MAX_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0 && hit != all) {
+        const Node& node = nodes[stack[--top]];
+        // relative to the origin in double first, then narrowed for the SIMD tests
+        glm::vec3 lo(node.lo - packet.origin), hi(node.hi - packet.origin);
+        if ((boxMask(lanes, lo, hi) & ~hit) == 0) continue;
+
+        if (node.count == 0) {
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+            continue;
+        }
+        for (int s = node.first; s < node.first + node.count; ++s) {
+            if (indices[s] == skip) continue;
+            hit |= sphereMask(lanes, glm::vec3(leafCenters[s] - packet.origin), (float) leafRadii[s]);
+        }
+    }
+    return hit;
+}
+
+size_t SphereBVH::size() const {
+    return indices.size();
+}
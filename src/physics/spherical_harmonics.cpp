@@ -0,0 +1,346 @@
+#include "physics/spherical_harmonics.h"
+#include "physics/physics_engine.h"
+#include "physics/force_model.h"
+#include "physics/simd.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+
+constexpr double G = 6.67430e-11;
+
+// particle pairs per worker chunk; each pair runs the full recursion
+constexpr size_t HARMONICS_GRAIN = 64;
+constexpr double DEFAULT_INFLUENCE = 1000.0; // reference radii
+
+static inline size_t tri(int n, int m) {
+    return size_t(n) * (n + 1) / 2 + m;
+}
+
+// ---------------- SphericalHarmonicGravity ----------------
+
+const char* SphericalHarmonicGravity::name() const {
+    return "harmonics";
+}
+
+void SphericalHarmonicGravity::resize(Field& field, int degree) {
+    field.loadedDegree = degree;
+    field.degree = field.order = degree;
+    field.C.assign(tri(degree + 1, 0), 0.0);
+    field.S.assign(tri(degree + 1, 0), 0.0);
+}
+
+void SphericalHarmonicGravity::cacheRecursion(Field& field) {
+    int N = field.degree;
+    size_t size = tri(N + 1, 0);
+    field.a.assign(size, 0.0);
+    field.b.assign(size, 0.0);
+    field.dp.assign(size, 0.0);
+    field.sectoral.assign(N + 1, 0.0);
+
+    for (int m = 1; m <= N; ++m)
+        field.sectoral[m] = m == 1 ? std::sqrt(3.0) : std::sqrt((2.0 * m + 1.0) / (2.0 * m));
+    for (int n = 1; n <= N; ++n) {
+        for (int m = 0; m <= n; ++m) {
+            double nm = double(n - m) * (n + m);
+            if (m < n) {
+                field.a[tri(n, m)] = std::sqrt((2.0 * n - 1.0) * (2.0 * n + 1.0) / nm);
+                if (n - m - 1 > 0)
+                    field.b[tri(n, m)] = std::sqrt((2.0 * n + 1.0) * (n + m - 1.0) * (n - m - 1.0) / (nm * (2.0 * n - 3.0)));
+            }
+            // dP_nm/dphi = dp * P_n,m+1 - m tan(phi) P_nm
+            field.dp[tri(n, m)] = m == 0 ? std::sqrt(n * (n + 1.0) / 2.0) : std::sqrt((n - m) * (n + m + 1.0));
+        }
+    }
+}
+
+bool SphericalHarmonicGravity::load(int centralID, const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "Gravity field %s not found\n", path.c_str());
+        return false;
+    }
+
+    struct Term { int n, m; double C, S; };
+    std::vector<Term> terms;
+    double mu = 0.0, radius = 0.0;
+    int maxDegree = 0;
+    bool header = true;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        if (!(fields >> key)) continue;
+
+        if (header) {
+            if (key == "earth_gravity_constant" || key == "gravity_constant") fields >> mu;
+            else if (key == "radius") fields >> radius;
+            else if (key == "norm") {
+                std::string norm;
+                fields >> norm;
+                if (norm == "unnormalized") {
+                    fprintf(stderr, "Gravity field %s: only fully normalized coefficients are supported\n", path.c_str());
+                    return false;
+                }
+            } else if (key == "end_of_head") {
+                header = false;
+            }
+            continue;
+        }
+        if (key != "gfc" && key != "gfct") continue;
+        // Fortran exponents (1.0D-06) appear in older files
+        std::string rest;
+        std::getline(fields, rest);
+        std::replace(rest.begin(), rest.end(), 'D', 'e');
+        std::replace(rest.begin(), rest.end(), 'd', 'e');
+        std::istringstream values(rest);
+        Term t;
+        if (!(values >> t.n >> t.m >> t.C >> t.S)) continue;
+        if (t.n < 2 || t.m < 0 || t.m > t.n || t.n > MAX_DEGREE) continue;
+        terms.push_back(t);
+        maxDegree = std::max(maxDegree, t.n);
+    }
+    if (terms.empty() || mu <= 0.0 || radius <= 0.0) {
+        fprintf(stderr, "Gravity field %s: missing coefficients, gravity constant or radius\n", path.c_str());
+        return false;
+    }
+
+    Field& field = fields[centralID];
+    field.mu = mu;
+    field.radius = radius;
+    if (field.maxDistance <= 0.0) field.maxDistance = DEFAULT_INFLUENCE * radius;
+    resize(field, maxDegree);
+    for (const Term& t : terms) {
+        field.C[tri(t.n, t.m)] = t.C;
+        field.S[tri(t.n, t.m)] = t.S;
+    }
+    cacheRecursion(field);
+    printf("Gravity field %s: degree %d\n", path.c_str(), maxDegree);
+    return true;
+}
+
+void SphericalHarmonicGravity::setZonal(int centralID, double mu, double radius, const std::vector<double>& J) {
+    Field& field = fields[centralID];
+    field.mu = mu;
+    field.radius = radius;
+    if (field.maxDistance <= 0.0) field.maxDistance = DEFAULT_INFLUENCE * radius;
+    int degree = std::min((int) J.size() + 1, MAX_DEGREE);
+    resize(field, degree);
+    // C_n0 = -J_n / sqrt(2n + 1) once normalized
+    for (int n = 2; n <= degree; ++n)
+        field.C[tri(n, 0)] = -J[n - 2] / std::sqrt(2.0 * n + 1.0);
+    cacheRecursion(field);
+}
+
+void SphericalHarmonicGravity::setDegreeOrder(int centralID, int degree, int order) {
+    auto it = fields.find(centralID);
+    if (it == fields.end()) return;
+    Field& field = it->second;
+    field.degree = std::clamp(degree, 0, field.loadedDegree);
+    field.order = std::clamp(order, 0, field.degree);
+    cacheRecursion(field);
+}
+
+void SphericalHarmonicGravity::setRotation(int centralID, const glm::dmat3& equatorialToInertial, double rate, double angleAtEpoch) {
+    Field& field = fields[centralID];
+    field.equatorialToInertial = equatorialToInertial;
+    field.rate = rate;
+    field.angleAtEpoch = angleAtEpoch;
+}
+
+void SphericalHarmonicGravity::setInfluence(int centralID, double maxDistance) {
+    fields[centralID].maxDistance = maxDistance;
+}
+
+void SphericalHarmonicGravity::removeField(int centralID) {
+    fields.erase(centralID);
+}
+
+void SphericalHarmonicGravity::kernel(const Field& field, double mu, size_t begin, size_t end) {
+    const int N = field.degree, M = field.order;
+    const int columns = std::min(M + 1, N);
+    std::vector<Double2> P(tri(N + 1, 0), Double2(0.0));
+    std::vector<Double2> qn(N + 1);
+
+    for (size_t k = begin; k < end; k += 2) {
+        Double2 x = Double2::load(&px[k]), y = Double2::load(&py[k]), z = Double2::load(&pz[k]);
+        Double2 r2 = x * x + y * y + z * z;
+        Double2 r = sqrt(r2);
+        // keep the longitude terms finite on the spin axis
+        Double2 rho2 = max(x * x + y * y, r2 * 1e-24);
+        Double2 rho = sqrt(rho2);
+        Double2 t = z / r, u = rho / r;     // sin and cos of latitude
+        Double2 cl = x / rho, sl = y / rho; // cos and sin of longitude
+        Double2 tanPhi = t / u;
+
+        Double2 q = Double2(field.radius) / r;
+        qn[0] = 1.0;
+        for (int n = 1; n <= N; ++n)
+            qn[n] = qn[n - 1] * q;
+
+        // fully normalized P_nm(sin phi), columns 0 .. order + 1
+        P[0] = 1.0;
+        for (int m = 0; m <= columns; ++m) {
+            if (m > 0)
+                P[tri(m, m)] = (m == 1 ? u : u * P[tri(m - 1, m - 1)]) * field.sectoral[m];
+            for (int n = m + 1; n <= N; ++n) {
+                Double2 p = Double2(field.a[tri(n, m)]) * t * P[tri(n - 1, m)];
+                if (n - 2 >= m) p -= Double2(field.b[tri(n, m)]) * P[tri(n - 2, m)];
+                P[tri(n, m)] = p;
+            }
+        }
+
+        Double2 sumR(0.0), sumPhi(0.0), sumLambda(0.0);
+        Double2 cm(1.0), sm(0.0);  // cos(m lambda), sin(m lambda)
+        for (int m = 0; m <= M; ++m) {
+            for (int n = std::max(2, m); n <= N; ++n) {
+                size_t i = tri(n, m);
+                Double2 C(field.C[i]), S(field.S[i]);
+                Double2 Pnm = P[i];
+                Double2 Pnm1 = m + 1 <= n ? P[tri(n, m + 1)] : Double2(0.0);
+                Double2 cosTerm = C * cm + S * sm;
+                sumR += Double2(n + 1.0) * qn[n] * Pnm * cosTerm;
+                sumPhi += qn[n] * (Double2(field.dp[i]) * Pnm1 - Double2(double(m)) * tanPhi * Pnm) * cosTerm;
+                if (m > 0)
+                    sumLambda += qn[n] * Double2(double(m)) * Pnm * (S * cm - C * sm);
+            }
+            Double2 c = cm * cl - sm * sl;
+            sm = sm * cl + cm * sl;
+            cm = c;
+        }
+
+        // spherical gradient to body-fixed Cartesian
+        Double2 dUdr = -Double2(mu) / r2 * sumR;
+        Double2 dUdPhi = Double2(mu) / r * sumPhi;
+        Double2 dUdLambda = Double2(mu) / r * sumLambda;
+        Double2 radial = dUdr / r - z / (r2 * rho) * dUdPhi;
+        Double2 around = dUdLambda / rho2;
+        (radial * x - around * y).store(&outX[k]);
+        (radial * y + around * x).store(&outY[k]);
+        (dUdr / r * z + rho / r2 * dUdPhi).store(&outZ[k]);
+    }
+}
+
+void SphericalHarmonicGravity::evaluate(BodyBatch& batch, ThreadPool& workers) {
+    PROFILE_SCOPE("harmonics");
+    for (auto& [centralID, field] : fields) {
+        int c = batch.find(centralID);
+        if (c < 0 || field.degree < 2) continue;
+        double mu = field.mu > 0.0 ? field.mu : G * batch.mass[c];
+
+        // one spin angle per body per step, shared by every particle
+        double theta = field.angleAtEpoch + field.rate * batch.time;
+        double cosT = std::cos(theta), sinT = std::sin(theta);
+        glm::dmat3 spin(cosT, sinT, 0.0, -sinT, cosT, 0.0, 0.0, 0.0, 1.0);
+        glm::dmat3 toInertial = field.equatorialToInertial * spin;
+        glm::dmat3 toBody = glm::transpose(toInertial);
+        glm::dvec3 center(batch.x[c], batch.y[c], batch.z[c]);
+
+        particles.clear();
+        px.clear();
+        py.clear();
+        pz.clear();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if ((int) i == c) continue;
+            glm::dvec3 rel = glm::dvec3(batch.x[i], batch.y[i], batch.z[i]) - center;
+            double d = glm::length(rel);
+            if (d < 1.0 || (field.maxDistance > 0.0 && d > field.maxDistance)) continue;
+            glm::dvec3 body = toBody * rel;
+            particles.push_back((int) i);
+            px.push_back(body.x);
+            py.push_back(body.y);
+            pz.push_back(body.z);
+        }
+        size_t count = particles.size();
+        if (count == 0) continue;
+        // pad with a copy of the last particle so both lanes stay finite
+        if (count % 2) {
+            px.push_back(px.back());
+            py.push_back(py.back());
+            pz.push_back(pz.back());
+        }
+        outX.resize(px.size());
+        outY.resize(px.size());
+        outZ.resize(px.size());
+
+        workers.parallelFor(px.size() / 2, HARMONICS_GRAIN, [&](size_t begin, size_t end, size_t) {
+            kernel(field, mu, 2 * begin, 2 * end);
+        });
+
+        // the central body takes the equal and opposite force, so massive
+        // neighbours like a moon leave the system's momentum alone
+        glm::dvec3 reaction(0.0);
+        for (size_t k = 0; k < count; ++k) {
+            glm::dvec3 a = toInertial * glm::dvec3(outX[k], outY[k], outZ[k]);
+            int i = particles[k];
+            batch.ax[i] += a.x;
+            batch.ay[i] += a.y;
+            batch.az[i] += a.z;
+            reaction -= batch.mass[i] * a;
+        }
+        if (batch.mass[c] > 0.0) {
+            batch.ax[c] += reaction.x / batch.mass[c];
+            batch.ay[c] += reaction.y / batch.mass[c];
+            batch.az[c] += reaction.z / batch.mass[c];
+        }
+    }
+}
+
+void SphericalHarmonicGravity::benchmark(int maxDegree, int satellites) {
+    maxDegree = std::clamp(maxDegree, 2, MAX_DEGREE);
+    const double mu = 3.986004418e14, radius = 6378137.0;
+
+    // synthetic field with Kaula-rule magnitudes
+    SphericalHarmonicGravity model;
+    Field& field = model.fields[0];
+    field.mu = mu;
+    field.radius = radius;
+    field.maxDistance = DEFAULT_INFLUENCE * radius;
+    resize(field, maxDegree);
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> gauss;
+    for (int n = 2; n <= maxDegree; ++n)
+        for (int m = 0; m <= n; ++m) {
+            field.C[tri(n, m)] = 1e-5 / (n * n) * gauss(rng);
+            field.S[tri(n, m)] = m ? 1e-5 / (n * n) * gauss(rng) : 0.0;
+        }
+    cacheRecursion(field);
+
+    // a shell of satellites between 300 and 2000 km altitude
+    std::vector<PhysObj> objs;
+    objs.reserve(satellites + 1);
+    std::unordered_map<int, PhysObj*> physObjs;
+    objs.emplace_back(glm::dvec3(0.0), glm::dvec3(0.0), 5.972e24, radius);
+    physObjs.emplace(0, &objs.back());
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0), altitude(3e5, 2e6);
+    for (int i = 0; i < satellites; ++i) {
+        glm::dvec3 dir(uniform(rng), uniform(rng), uniform(rng));
+        objs.emplace_back(glm::normalize(dir) * (radius + altitude(rng)), glm::dvec3(0.0), 1000.0);
+        physObjs.emplace(i + 1, &objs.back());
+    }
+
+    ThreadPool workers;
+    BodyBatch batch;
+    batch.gather(physObjs);
+    printf("Spherical harmonics, %d satellites, %u threads\n", satellites, workers.size() + 1);
+    printf("degree   ms/step   us/satellite\n");
+    for (int degree = 2; degree <= maxDegree; degree = degree < maxDegree && degree * 2 > maxDegree ? maxDegree : degree * 2) {
+        model.setDegreeOrder(0, degree, degree);
+        model.evaluate(batch, workers); // warm up
+        const int reps = 5;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r)
+            model.evaluate(batch, workers);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / reps;
+        printf("%6d %9.2f %14.3f\n", degree, ms, ms * 1000.0 / satellites);
+        if (degree == maxDegree) break;
+    }
+}
@@ -0,0 +1,169 @@
+#include "profiler.h"
+#include "opengl_includes.h"
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+static const auto PROFILER_EPOCH = std::chrono::steady_clock::now();
+
+// ---------------- Stage ----------------
+
+float Profiler::Stage::last() const {
+    return history[(head + HISTORY - 1) % HISTORY];
+}
+
+// ---------------- Profiler ----------------
+
+Profiler::Profiler() {}
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+int64_t Profiler::nowUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - PROFILER_EPOCH).count();
+}
+
+int Profiler::stageIndex(const char* name, bool gpu) {
+    for (size_t i = 0; i < stages.size(); ++i)
+        if (stages[i].gpu == gpu && stages[i].name == name) return (int) i;
+    Stage stage;
+    stage.name = name;
+    stage.gpu = gpu;
+    stages.push_back(stage);
+    return (int) stages.size() - 1;
+}
+
+void Profiler::beginFrame() {
+    frameStartUs = nowUs();
+}
+
+void Profiler::endFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // last frame's queries have had a full frame to finish
+    int previous = 1 - parity;
+    for (GPUPass& pass : gpuPasses) {
+        if (!pass.issued[previous]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(pass.queries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(pass.queries[previous], GL_QUERY_RESULT, &ns);
+        pass.issued[previous] = false;
+        stages[pass.stage].accumMs += ns * 1e-6;
+        if (tracing) 
+            traceEvents.push_back({ pass.stage, frameStartUs, int64_t(ns / 1000), -1 });
+    }
+    parity = previous;
+
+    for (Stage& stage : stages) {
+        stage.history[stage.head] = (float) stage.accumMs;
+        stage.head = (stage.head + 1) % HISTORY;
+        stage.accumMs = 0.0;
+    }
+}
+
+void Profiler::addSample(const char* name, int64_t startUs, int64_t durationUs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int index = stageIndex(name, false);
+    stages[index].accumMs += durationUs * 1e-3;
+    if (!tracing) return;
+
+    auto [it, inserted] = threadIDs.emplace(std::this_thread::get_id(), (int) threadIDs.size());
+    traceEvents.push_back({ index, startUs, durationUs, it->second });
+}
+
+void Profiler::beginGPU(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (activeGPUPass >= 0) return;
+    int stage = stageIndex(name, true);
+
+    int passIndex = -1;
+    for (size_t i = 0; i < gpuPasses.size(); ++i)
+        if (gpuPasses[i].stage == stage) passIndex = (int) i;
+    if (passIndex < 0) {
+        GPUPass pass;
+        pass.stage = stage;
+        glGenQueries(2, pass.queries);
+        gpuPasses.push_back(pass);
+        passIndex = (int) gpuPasses.size() - 1;
+    }
+
+    GPUPass& pass = gpuPasses[passIndex];
+    if (pass.issued[parity]) return; // one query per pass per frame
+    glBeginQuery(GL_TIME_ELAPSED, pass.queries[parity]);
+    activeGPUPass = passIndex;
+}
+
+void Profiler::endGPU() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (activeGPUPass < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuPasses[activeGPUPass].issued[parity] = true;
+    activeGPUPass = -1;
+}
+
+void Profiler::startTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tracePath = path;
+    traceEvents.clear();
+    tracing = true;
+}
+
+void Profiler::stopTrace() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!tracing) return;
+    tracing = false;
+    writeTrace();
+    traceEvents.clear();
+}
+
+bool Profiler::isTracing() const {
+    return tracing;
+}
+
+void Profiler::writeTrace() {
+    std::ofstream file(tracePath);
+    if (!file) {
+        fprintf(stderr, "Failed to write trace %s\n", tracePath.c_str());
+        return;
+    }
+    // GPU passes go on their own track; their start is the frame start
+    file << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < traceEvents.size(); ++i) {
+        const TraceEvent& e = traceEvents[i];
+        file << "{\"name\":\"" << stages[e.stage].name << "\",\"ph\":\"X\",\"pid\":1"
+             << ",\"tid\":" << (e.thread < 0 ? 1000 : e.thread)
+             << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs << "}"
+             << (i + 1 < traceEvents.size() ? ",\n" : "\n");
+    }
+    file << "],\"displayTimeUnit\":\"ms\"}\n";
+    printf("Wrote %zu trace events to %s\n", traceEvents.size(), tracePath.c_str());
+}
+
+const std::vector<Profiler::Stage>& Profiler::getStages() const {
+    return stages;
+}
+
+void Profiler::cleanup() {
+    stopTrace();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (GPUPass& pass : gpuPasses)
+        glDeleteQueries(2, pass.queries);
+    gpuPasses.clear();
+    activeGPUPass = -1;
+}
+
+// ---------------- ScopedTimer ----------------
+
+ScopedTimer::ScopedTimer(const char* stage)
+    : stage(stage), startUs(Profiler::get().nowUs()) {}
+
+ScopedTimer::~ScopedTimer() {
+    Profiler& profiler = Profiler::get();
+    profiler.addSample(stage, startUs, profiler.nowUs() - startUs);
+}
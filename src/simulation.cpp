@@ -3,16 +3,29 @@
 #include "graphics/graphics_engine.h"
 #include "graphics/renderable.h"
 #include "physics/physics_engine.h"
+#include "physics/solar_radiation_pressure.h"
+#include "physics/spherical_harmonics.h"
+#include "physics/atmospheric_drag.h"
+#include "physics/sgp4.h"
+#include "physics/conjunction.h"
 #include "utils.h"
+#include "profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <chrono>
+#include <cstdio>
 
 SimObj::SimObj(int id, std::unique_ptr<Renderable> renderable, std::unique_ptr<PhysObj> physObj)
     : id(id), renderable(std::move(renderable)), physObj(std::move(physObj)) {}
 
-void SimObj::syncPhysicsToRender() {
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), toRender(physObj->pos));
-    renderable->setModel(model);
+void SimObj::syncPhysicsToRender(const glm::dvec3& origin, glm::vec3* offsets) {
+    // subtract in double first so distant bodies keep their precision
+    offsets[renderable->getInstanceSlot()] = toRender(physObj->pos - origin);
+    renderable->setSunVisibility(physObj->illumination.litFraction);
 }
 
 int SimObj::getID() const {
@@ -29,23 +42,91 @@ PhysObj* SimObj::getPhysObj() const {
 
 // ---------------- SIMULATION -----------------
 
+constexpr double SUN_LUMINOSITY = 3.828e26; // W
+constexpr double EARTH_OBLIQUITY = 23.4392911 * M_PI / 180.0; // J2000
+constexpr double EARTH_ROTATION_RATE = 7.2921159e-5; // rad/s
+constexpr double EARTH_MU = 3.986004418e14; // m^3/s^2
+static const char* EARTH_GRAVITY_FIELD = "resources/gravity/earth.gfc";
+
+constexpr int SUN_ID = 0;
+constexpr int EARTH_ID = 1;
+constexpr int MOON_ID = 2;
+constexpr int TRACKED_ID_BASE = 1000000;          // catalog entry i is SimObj TRACKED_ID_BASE + i
+constexpr double SATELLITE_MARKER_RADIUS = 2.0e4;  // m, drawn oversized so they show at orbit scale
+constexpr size_t REPORTED_CONJUNCTIONS = 10;        // closest printed per screened window
+
+// Earth's equator frame (TEME for SGP4) -> the ecliptic simulation frame
+static glm::dmat3 equatorToEcliptic() {
+    double c = cos(EARTH_OBLIQUITY), s = sin(EARTH_OBLIQUITY);
+    return glm::dmat3(1.0, 0.0, 0.0, 0.0, c, -s, 0.0, s, c);
+}
+
+// Earth's harmonics: a coefficient file when present, otherwise J2-J4 (EGM2008)
+static std::unique_ptr<SphericalHarmonicGravity> earthGravity(int earthID) {
+    auto model = std::make_unique<SphericalHarmonicGravity>();
+    if (!std::filesystem::exists(EARTH_GRAVITY_FIELD) || !model->load(earthID, EARTH_GRAVITY_FIELD))
+        model->setZonal(earthID, EARTH_MU, 6378137.0, { 1.08262668e-3, -2.53265649e-6, -1.61962159e-6 });
+    model->setRotation(earthID, equatorToEcliptic(), EARTH_ROTATION_RATE, 0.0);
+    return model;
+}
+
+// Earth's air: the exponential reference densities of Vallado (table 8-4), 0-1000 km
+static std::unique_ptr<AtmosphericDrag> earthAtmosphere(int earthID) {
+    auto model = std::make_unique<AtmosphericDrag>();
+    std::vector<double> km = { 0, 25, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120, 130, 140, 150, 180, 200,
+                               250, 300, 350, 400, 450, 500, 600, 700, 800, 900, 1000 };
+    std::vector<double> density = { 1.225, 3.899e-2, 1.774e-2, 3.972e-3, 1.057e-3, 3.206e-4, 8.770e-5, 1.905e-5,
+                                    3.396e-6, 5.297e-7, 9.661e-8, 2.438e-8, 8.484e-9, 3.845e-9, 2.070e-9, 5.464e-10,
+                                    2.789e-10, 7.248e-11, 2.418e-11, 9.518e-12, 3.725e-12, 1.585e-12, 6.967e-13,
+                                    1.454e-13, 3.614e-14, 1.170e-14, 5.245e-15, 3.019e-15 };
+    for (double& h : km) h *= 1e3;
+    model->setTable(earthID, 6378137.0, km, density);
+    model->setRotation(earthID, equatorToEcliptic()[2], EARTH_ROTATION_RATE);
+    return model;
+}
+
+// surface maps are optional; bodies keep their flat color without one.
+// a baked virtual texture (resources/vt/<name>) wins over a plain image
+static void applyTexture(const SimObj* obj, const std::string& name) {
+    if (!obj) return;
+    std::string vtDir = "resources/vt/" + name;
+    std::string path = "resources/textures/" + name + ".jpg";
+    if (std::filesystem::exists(vtDir + "/vt.info"))
+        obj->getRenderable()->setVirtualTexture(vtDir);
+    else if (std::filesystem::exists(path))
+        obj->getRenderable()->setTexture(path);
+}
+
 Simulation::Simulation(std::shared_ptr<GraphicsEngine> gEng, std::shared_ptr<PhysicsEngine> pEng)
-    : gEng(gEng), pEng(pEng) {
+    : gEng(gEng), pEng(pEng), epochJD(Sgp4Catalog::julianDate(std::chrono::system_clock::now())) {
     addSimObj(0, // Sun 
         std::make_unique<Sphere>(gEng, glm::vec3(1, 1, 0), 6.957e8),
-        std::make_unique<PhysObj>(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), 1.989e30)
+        std::make_unique<PhysObj>(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), 1.989e30, 6.957e8)
     );
 
     addSimObj(1, // Earth 
         std::make_unique<Sphere>(gEng, glm::vec3(0, 0, 1), 6.371e6),
-        std::make_unique<PhysObj>(glm::vec3(1.496e11, 0, 0), glm::vec3(0, 3.0e4, 0), 5.972e24)
+        std::make_unique<PhysObj>(glm::vec3(1.496e11, 0, 0), glm::vec3(0, 3.0e4, 0), 5.972e24, 6.371e6)
     );
     
     addSimObj(2, // Moon
         std::make_unique<Sphere>(gEng, glm::vec3(1, 1, 1), 1.7375e6),
-        std::make_unique<PhysObj>(glm::vec3(1.496e11 + 3.84e8, 0, 0), glm::vec3(0, 3.0e4 + 1.022e3, 0), 7.35e22)
+        std::make_unique<PhysObj>(glm::vec3(1.496e11 + 3.84e8, 0, 0), glm::vec3(0, 3.0e4 + 1.022e3, 0), 7.35e22, 1.7375e6)
     );
 
+    applyTexture(getSimObj(0), "sun");
+    applyTexture(getSimObj(1), "earth");
+    applyTexture(getSimObj(2), "moon");
+
+    pEng->setSun(0, SUN_LUMINOSITY);
+    // satellites opt in with SolarRadiationPressure::setBody
+    pEng->addForceModel(std::make_unique<SolarRadiationPressure>(0, SUN_LUMINOSITY));
+    pEng->addForceModel(earthGravity(EARTH_ID));
+    // satellites opt in with AtmosphericDrag::setBody
+    pEng->addForceModel(earthAtmosphere(EARTH_ID));
+    getSimObj(0)->getRenderable()->setEmissive(true);
+
+    pEng->updateIllumination();
     pEng->computeForces();
     for (auto& [id, simObj] : simObjs)
         simObj.getPhysObj()->acc = simObj.getPhysObj()->acc_new;
@@ -60,13 +141,23 @@ Simulation::~Simulation() {
 void Simulation::addSimObj(int id, std::unique_ptr<Renderable> renderable, std::unique_ptr<PhysObj> physObj) {
     SimObj obj(id, std::move(renderable), std::move(physObj));
     gEng->addRenderable(id, obj.getRenderable());
+    gEng->getOrbitTrails()->addTrail(id);
     pEng->addPhysObj(id, obj.getPhysObj());
     simObjs.emplace(id, std::move(obj));
 }
 
+void Simulation::addKinematicSimObj(int id, std::unique_ptr<Renderable> renderable, std::unique_ptr<PhysObj> physObj) {
+    SimObj obj(id, std::move(renderable), std::move(physObj));
+    gEng->addRenderable(id, obj.getRenderable());
+    pEng->addKinematicObj(id, obj.getPhysObj());
+    simObjs.emplace(id, std::move(obj));
+}
+
 void Simulation::removeSimObj(int id) {
+    if (screener) screener->removeObject(id);
     pEng->removePhysObj(id);
     gEng->removeRenderable(id);
+    gEng->getOrbitTrails()->removeTrail(id);
     simObjs.erase(id);
 }
 
@@ -80,14 +171,145 @@ const SimObj* Simulation::getSimObj(int id) const {
 void Simulation::clear() {
     pEng->clear();
     gEng->clear();
+    gEng->getOrbitTrails()->clear();
     simObjs.clear();
+    screener.reset();
+    catalog.reset();
+    trackedIDs.clear();
+}
+
+size_t Simulation::loadTleCatalog(const std::string& path) {
+    auto loaded = std::make_unique<Sgp4Catalog>();
+    if (loaded->load(path) == 0) return 0;
+    for (int id : trackedIDs)
+        if (id >= 0) removeSimObj(id);
+
+    catalog = std::move(loaded);
+    trackedIDs.resize(catalog->size());
+    for (size_t i = 0; i < catalog->size(); ++i) {
+        trackedIDs[i] = TRACKED_ID_BASE + (int) i;
+        addKinematicSimObj(trackedIDs[i],
+            std::make_unique<Sphere>(gEng, glm::vec3(0.8f, 0.8f, 0.8f), SATELLITE_MARKER_RADIUS),
+            std::make_unique<PhysObj>(glm::dvec3(0.0), glm::dvec3(0.0), 0.0)
+        );
+        if (screener) screener->addObject(trackedIDs[i], getSimObj(trackedIDs[i])->getPhysObj());
+    }
+    updateTracked(pEng->getTime());
+    return catalog->size();
+}
+
+void Simulation::enableConjunctionScreening(double distance) {
+    const SimObj* earth = getSimObj(EARTH_ID);
+    if (!earth) return;
+    screener = std::make_unique<ConjunctionScreener>(distance);
+    screener->setCentral(earth->getPhysObj(), EARTH_MU);
+    for (int id : trackedIDs)
+        if (id >= 0) screener->addObject(id, getSimObj(id)->getPhysObj());
+}
+
+const ConjunctionScreener* Simulation::getConjunctionScreener() const {
+    return screener.get();
+}
+
+void Simulation::logLunarEvents() {
+    const SimObj* sun = getSimObj(SUN_ID);
+    const SimObj* earth = getSimObj(EARTH_ID);
+    if (!sun || !earth || !getSimObj(MOON_ID)) return;
+    EventDetector* events = pEng->getEvents();
+    events->addEvent({ EARTH_ID, MOON_ID }, EventDetector::approach(), EventDirection::Any, [](const EventHit& hit) {
+        double km = glm::length(hit.state.pos[1] - hit.state.pos[0]) / 1e3;
+        printf("t = %.3f s: Moon at %s, %.0f km\n", hit.state.time, hit.rising ? "perigee" : "apogee", km);
+    });
+    events->addEvent({ MOON_ID, EARTH_ID, SUN_ID },
+                     EventDetector::penumbra(earth->getPhysObj()->radius, sun->getPhysObj()->radius),
+                     EventDirection::Any, [](const EventHit& hit) {
+        printf("t = %.3f s: Moon %s Earth's penumbra\n", hit.state.time, hit.rising ? "leaves" : "enters");
+    });
+}
+
+void Simulation::reportConjunctions(size_t count) const {
+    const std::vector<Conjunction>& all = screener->getConjunctions();
+    std::vector<Conjunction> closest(all.end() - count, all.end());
+    size_t shown = std::min(count, REPORTED_CONJUNCTIONS);
+    std::partial_sort(closest.begin(), closest.begin() + shown, closest.end(),
+                      [](const Conjunction& a, const Conjunction& b) { return a.missDistance < b.missDistance; });
+
+    auto catalogNumber = [&](int id) { return catalog ? catalog->getElements(id - TRACKED_ID_BASE).catalogNumber : id; };
+    printf("%zu conjunctions in the last window (%.0f per hour of compute)\n", count, screener->conjunctionsPerComputeHour());
+    for (size_t k = 0; k < shown; ++k)
+        printf("  %05d x %05d at t = %.0f s: %.0f m at %.0f m/s\n", catalogNumber(closest[k].idA), catalogNumber(closest[k].idB),
+               closest[k].tca, closest[k].missDistance, closest[k].relativeSpeed);
+}
+
+void Simulation::sampleConjunctions() {
+    if (!screener || !catalog) return;
+    // under time warp one step spans many sample intervals; SGP4 reaches any
+    // time, so the bins stay one interval long
+    double now = pEng->getTime();
+    for (double t = screener->nextSampleTime(); t < now; t = screener->nextSampleTime()) {
+        updateTracked(t);
+        size_t found = screener->sample(t, pEng->getWorkers());
+        if (found > 0) reportConjunctions(found);
+    }
+}
+
+void Simulation::updateTracked(double time) {
+    const SimObj* earth = getSimObj(EARTH_ID);
+    if (!catalog || !earth) return;
+    PROFILE_SCOPE("tracked");
+    catalog->propagate(epochJD + time / 86400.0, pEng->getWorkers());
+
+    // TEME about Earth's moving center, in the simulation frame
+    glm::dmat3 toSim = equatorToEcliptic();
+    const PhysObj* center = earth->getPhysObj();
+    size_t dropped = 0;
+    for (size_t i = 0; i < trackedIDs.size(); ++i) {
+        int id = trackedIDs[i];
+        if (id < 0) continue;
+        if (catalog->getStatus(i) != 0) {
+            removeSimObj(id);
+            trackedIDs[i] = -1;
+            ++dropped;
+            continue;
+        }
+        PhysObj* obj = getSimObj(id)->getPhysObj();
+        obj->pos = center->pos + toSim * catalog->getPosition(i);
+        obj->vel = center->vel + toSim * catalog->getVelocity(i);
+    }
+    if (dropped > 0)
+        printf("%zu tracked objects decayed or failed to propagate\n", dropped);
+}
+
+void Simulation::syncPhysicsToRender(const Camera& cam) {
+    PROFILE_SCOPE("sync");
+    glm::vec3* offsets = gEng->getInstanceBuffer().data();
+    if (const SimObj* sun = getSimObj(pEng->getIrradiance()->getSun()))
+        gEng->setSunPosition(sun->getPhysObj()->pos);
+    for (auto& [id, simObj] : simObjs) {
+        simObj.syncPhysicsToRender(cam.realPosition, offsets);
+    }
+}
+
+void Simulation::pushTrailSamples() {
+    OrbitTrails* trails = gEng->getOrbitTrails();
+    for (auto& [id, simObj] : simObjs) {
+        trails->push(id, simObj.getPhysObj()->pos);
+    }
 }
 
 void Simulation::update(OrbitalCamera& cam, float deltaTime) {
     pEng->updateAll(deltaTime);
-    for (auto& [id, simObj] : simObjs) {
-        simObj.syncPhysicsToRender();
+    for (int id : pEng->takeAbsorbed())
+        removeSimObj(id);
+    sampleConjunctions();
+    updateTracked(pEng->getTime());
+    if (screener) {
+        size_t found = screener->sample(pEng->getTime(), pEng->getWorkers());
+        if (found > 0) reportConjunctions(found);
     }
-    cam.update(getSimObj(1)->getPhysObj()->pos);
+    if (deltaTime > 0) 
+        pushTrailSamples();
+    cam.update(getSimObj(EARTH_ID)->getPhysObj()->pos);
+    syncPhysicsToRender(cam);
     gEng->renderScene(cam);
 }
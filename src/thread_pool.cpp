@@ -0,0 +1,96 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        threadCount = hw > 1 ? hw - 1 : 1;
+    }
+    for (unsigned i = 0; i < threadCount; ++i)
+        threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskCV.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+}
+
+unsigned ThreadPool::size() const {
+    return (unsigned) threads.size();
+}
+
+size_t ThreadPool::chunkCount(size_t count, size_t grain) const {
+    if (count == 0) return 1;
+    size_t chunks = (count + grain - 1) / std::max<size_t>(grain, 1);
+    return std::clamp<size_t>(chunks, 1, threads.size() + 1);
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskCV.notify_one();
+}
+
+bool ThreadPool::runOne() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskCV.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, size_t)>& fn) {
+    size_t chunks = chunkCount(count, grain);
+    if (chunks == 1) {
+        fn(0, count, 0);
+        return;
+    }
+
+    std::atomic<size_t> remaining(chunks - 1);
+    auto range = [count, chunks](size_t chunk) {
+        return std::make_pair(count * chunk / chunks, count * (chunk + 1) / chunks);
+    };
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        enqueue([&fn, &remaining, range, chunk] {
+            auto [begin, end] = range(chunk);
+            fn(begin, end, chunk);
+            remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    auto [begin, end] = range(0);
+    fn(begin, end, 0);
+    // help out instead of sleeping; the tasks above reference this frame
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOne()) std::this_thread::yield();
+    }
+}
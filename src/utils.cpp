@@ -11,3 +11,7 @@ glm::vec3 toRender(glm::dvec3 physicsPos) {
 float toRender(double realDist) {
     return (float) (realDist * RENDER_SCALE);
 }
+
+double toReal(float renderDist) {
+    return renderDist / RENDER_SCALE;
+}